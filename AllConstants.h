@@ -18,6 +18,15 @@
 #define TITLE_MAX_SIZE 52
 #define ITEM_NUMS_MIN_SIZE 0
 #define ITEM_NUMS_MAX_SIZE 99
+#define PATRON_MAX_ITEMS_OUT 5
+
+// Number of distinct encoded PIDs, 26 letters each with 10000 numbers
+#define PID_DIGITS_KEY_COUNT 10000
+#define PID_KEY_COUNT ( 26 * PID_DIGITS_KEY_COUNT )
+
+// Number of distinct encoded CIDs, each half of a CID gets 10 bits
+#define CID_HALF_BITS 10
+#define CID_KEY_COUNT ( 1 << ( 2 * CID_HALF_BITS ) )
 
 #define DEFAULT_WORD_SEPARATORS " \t\n"
 #define QUOTE_WORD_SEPARATOR "\""
@@ -31,5 +40,9 @@
 #define DISCARD_ITEM_COMMAND "discard"
 #define OUT_COMMAND "out"
 #define AVAILABLE_ITEM_COMMAND "available"
+#define SAVE_COMMAND "save"
+#define LOAD_COMMAND "load"
+#define CHECKPOINT_COMMAND "checkpoint"
+#define STATS_COMMAND "stats"
 
 #endif
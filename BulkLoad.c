@@ -0,0 +1,959 @@
+/*
+* This file contains methods which load the initial
+* patron and item files. Records are created and indexed
+* as they are read but only linked into their ordered lists
+* once per batch, after the batch has been sorted.
+* The files are mapped into memory when possible and split into
+* line aligned chunks. Worker threads tokenize and validate the
+* chunks of every file at once, then the parsed lines are turned
+* into records in input order so errors come out exactly as they
+* would from processInput. Batches are sorted by the workers too.
+*
+*
+* @author Greg Mojonnier
+*/
+
+// mmap, fileno, sysconf and pthreads are POSIX, not part of c99
+#define _POSIX_C_SOURCE 200809L
+
+#include "BulkLoad.h"
+#include "SanitizeInput.h"
+#include "ExecuteCommands.h"
+#include "LinkedDataNodeOperations.h"
+#include "Tokenizer.h"
+#include "OutputWriter.h"
+#include <allocate.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AllConstants.h"
+
+extern OrderedList g_PatronsList;
+extern OrderedList g_ItemsList;
+
+// Kinds of ParsedLine
+#define PARSED_PATRON 0
+#define PARSED_ITEM 1
+#define PARSED_OTHER 2
+
+/*
+* Data Structure: ParsedLine
+* ----------------------------------
+*
+* A line of input that a worker has already tokenized and validated.
+*
+* @line ------------------> Whole line, only kept for other commands.
+* @name ------------------> Patron's name or item's author, already truncated.
+* @title -----------------> Item's title, already truncated.
+* @key -------------------> Encoded PID or CID.
+* @kind ------------------> PARSED_PATRON, PARSED_ITEM or PARSED_OTHER.
+* @numCopies -------------> Item's number of copies.
+*
+*/
+typedef struct {
+	StringView line;
+	StringView name;
+	StringView title;
+	uint_least32_t key;
+	uint_least8_t kind;
+	uint_least8_t numCopies;
+} ParsedLine;
+
+/*
+* Data Structure: InputChunk
+* ----------------------------------
+*
+* Line aligned piece of an input file and the lines parsed from it.
+*
+* @start -----------------> First char of chunk.
+* @end -------------------> One past the last char of chunk.
+* @numLines --------------> Number of lines in chunk.
+* @lines -----------------> Parsed lines, NULL if there was no room for them.
+* @numParsed -------------> Number of lines that parsed into something.
+*
+*/
+typedef struct {
+	const char* start;
+	const char* end;
+	size_t numLines;
+	ParsedLine* lines;
+	size_t numParsed;
+} InputChunk;
+
+/*
+* Data Structure: InputText
+* ----------------------------------
+*
+* Whole contents of an input file.
+*
+* @text ------------------> Chars of the file.
+* @size ------------------> Number of chars.
+* @isMapped --------------> Whether text is mapped, rather than allocated.
+*
+*/
+typedef struct {
+	const char* text;
+	size_t size;
+	_Bool isMapped;
+} InputText;
+
+/*
+* Data Structure: NodeBatch
+* ----------------------------------
+*
+* Growable flat array of nodes waiting to be linked into a list.
+*
+* @nodes -----------------> Array of unlinked nodes.
+* @numNodes --------------> Number of nodes in array.
+* @capacity --------------> Number of nodes array has room for.
+* @kind ------------------> PARSED_PATRON or PARSED_ITEM, which list the nodes belong in.
+*
+*/
+typedef struct {
+	ListNode** nodes;
+	size_t numNodes;
+	size_t capacity;
+	uint_least8_t kind;
+} NodeBatch;
+
+/*
+* Data Structure: MergeTask
+* ----------------------------------
+*
+* Part of a sort handed to a worker. With numSecond 0 it sorts first
+* in place, otherwise it merges first and second into merged.
+*
+* @first -----------------> First run of nodes.
+* @numFirst --------------> Number of nodes in first.
+* @second ----------------> Second run of nodes.
+* @numSecond -------------> Number of nodes in second.
+* @merged ----------------> Where merged nodes go, or scratch space when sorting.
+* @kind ------------------> PARSED_PATRON or PARSED_ITEM, which list the nodes belong in.
+*
+*/
+typedef struct {
+	ListNode** first;
+	size_t numFirst;
+	ListNode** second;
+	size_t numSecond;
+	ListNode** merged;
+	uint_least8_t kind;
+} MergeTask;
+
+/*
+* Data Structure: TaskQueue
+* ----------------------------------
+*
+* Array of tasks shared by the workers, each worker takes
+* the next task until none are left.
+*
+* @tasks -----------------> Array of tasks.
+* @taskSize --------------> Size of a single task.
+* @numTasks --------------> Number of tasks.
+* @nextTask --------------> Index of next task to be taken.
+* @lock ------------------> Guards nextTask.
+* @runTask ---------------> Function that runs a single task.
+*
+*/
+typedef struct {
+	char* tasks;
+	size_t taskSize;
+	size_t numTasks;
+	size_t nextTask;
+	pthread_mutex_t lock;
+	void(*runTask)(void* task);
+} TaskQueue;
+
+/*
+* getNumWorkers
+* ----------------------------------
+*
+* Determines how many threads to split work between,
+* one per online processor up to BULK_LOAD_MAX_WORKERS.
+*
+*
+* @return ------------------> Number of workers, at least 1.
+*
+*/
+static size_t getNumWorkers(){
+
+	static size_t numWorkers = 0;
+
+	if( numWorkers == 0 ){
+		long numProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+
+		numWorkers = ( numProcessors < 1 ) ? 1 : (size_t)numProcessors;
+		if( numWorkers > BULK_LOAD_MAX_WORKERS ){
+			numWorkers = BULK_LOAD_MAX_WORKERS;
+		}
+	}
+	return numWorkers;
+}
+
+/*
+* runQueuedTasks
+* ----------------------------------
+*
+* Worker thread body, runs tasks from the queue until it is empty.
+*
+* @_queue ------------------> TaskQueue* to take tasks from.
+*
+* @return ------------------> NULL.
+*
+*/
+static void* runQueuedTasks( void* _queue ){
+
+	TaskQueue* queue = (TaskQueue*)_queue;
+
+	while( 1 ){
+		pthread_mutex_lock( &queue->lock );
+		size_t taskIndex = queue->nextTask++;
+		pthread_mutex_unlock( &queue->lock );
+
+		if( taskIndex >= queue->numTasks ){
+			return NULL;
+		}
+		queue->runTask( queue->tasks + taskIndex * queue->taskSize );
+	}
+}
+
+/*
+* runTasksInParallel
+* ----------------------------------
+*
+* Runs every task in an array, spread across the workers. The
+* calling thread works too, so if no thread can be started the
+* tasks still all run. Returns once every task is done.
+*
+* @tasks -------------------> Array of tasks.
+* @taskSize ----------------> Size of a single task.
+* @numTasks ----------------> Number of tasks.
+* @runTask -----------------> Function that runs a single task.
+*
+* @return ------------------> None.
+*
+*/
+static void runTasksInParallel( void* tasks, size_t taskSize, size_t numTasks, void(*runTask)(void* task) ){
+
+	TaskQueue queue = { (char*)tasks, taskSize, numTasks, 0, PTHREAD_MUTEX_INITIALIZER, runTask };
+	pthread_t threads[ BULK_LOAD_MAX_WORKERS ];
+	size_t numThreads = 0;
+	size_t numWanted = ( numTasks < getNumWorkers() ) ? numTasks : getNumWorkers();
+
+	// the calling thread is one of the workers
+	while( numThreads + 1 < numWanted && pthread_create( &threads[ numThreads ], NULL, runQueuedTasks, &queue ) == 0 ){
+		++numThreads;
+	}
+
+	runQueuedTasks( &queue );
+
+	for( size_t i = 0; i < numThreads; ++i ){
+		pthread_join( threads[ i ], NULL );
+	}
+	pthread_mutex_destroy( &queue.lock );
+}
+
+/*
+* readInputText
+* ----------------------------------
+*
+* Gets the whole contents of a file. Regular files are mapped
+* read only, anything that cannot be mapped(pipes) is read
+* into an allocated buffer instead. If that runs out of
+* memory the contents are left empty.
+*
+* @file --------------------> File to read.
+* @input -------------------> Set to the file's contents.
+*
+* @return ------------------> None.
+*
+*/
+static void readInputText( FILE* file, InputText* input ){
+
+	struct stat fileInfo;
+
+	input->text = NULL;
+	input->size = 0;
+	input->isMapped = 0;
+
+	if( fstat( fileno( file ), &fileInfo ) == 0 && S_ISREG( fileInfo.st_mode ) ){
+		if( fileInfo.st_size == 0 ){
+			return;
+		}
+		void* mapped = mmap( NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileno( file ), 0 );
+		if( mapped != MAP_FAILED ){
+			input->text = (const char*)mapped;
+			input->size = fileInfo.st_size;
+			input->isMapped = 1;
+			return;
+		}
+	}
+
+	size_t capacity = 0;
+	char* buffer = NULL;
+
+	while( 1 ){
+		if( input->size == capacity ){
+			size_t newCapacity = ( capacity == 0 ) ? BULK_LOAD_CHUNK_SIZE : capacity * 2;
+			char* newBuffer = (char*) allocate( newCapacity );
+
+			if( newBuffer == NULL ){
+				writeOutputString( "Memory allocation failed!\n" );
+				if( buffer != NULL ){
+					unallocate( buffer );
+				}
+				input->size = 0;
+				return;
+			}
+			if( buffer != NULL ){
+				memcpy( newBuffer, buffer, input->size );
+				unallocate( buffer );
+			}
+			buffer = newBuffer;
+			capacity = newCapacity;
+		}
+
+		size_t numRead = fread( buffer + input->size, 1, capacity - input->size, file );
+		if( numRead == 0 ){
+			break;
+		}
+		input->size += numRead;
+	}
+	input->text = buffer;
+}
+
+/*
+* freeInputText
+* ----------------------------------
+*
+* Gives back the contents read by readInputText.
+*
+* @input -------------------> Contents to give back.
+*
+* @return ------------------> None.
+*
+*/
+static void freeInputText( InputText* input ){
+
+	if( input->text == NULL ){
+		return;
+	}
+	if( input->isMapped ){
+		munmap( (void*)input->text, input->size );
+	}
+	else{
+		unallocate( (void*)input->text );
+	}
+	input->text = NULL;
+}
+
+/*
+* countChunks
+* ----------------------------------
+*
+* Determines how many chunks splitIntoChunks will make of input.
+*
+* @input -------------------> Contents to split.
+*
+* @return ------------------> Number of chunks.
+*
+*/
+static size_t countChunks( const InputText* input ){
+	return ( input->size + BULK_LOAD_CHUNK_SIZE - 1 ) / BULK_LOAD_CHUNK_SIZE;
+}
+
+/*
+* splitIntoChunks
+* ----------------------------------
+*
+* Splits input into chunks of about BULK_LOAD_CHUNK_SIZE chars,
+* each ending just after a newline so no line is split. Chunks
+* that a very long line runs all the way past are left empty.
+*
+* @input -------------------> Contents to split.
+* @chunks ------------------> Array with room for countChunks( input ) chunks.
+*
+* @return ------------------> None.
+*
+*/
+static void splitIntoChunks( const InputText* input, InputChunk* chunks ){
+
+	size_t chunkStart = 0;
+	size_t numChunks = countChunks( input );
+
+	for( size_t i = 0; i < numChunks; ++i ){
+		size_t chunkEnd = ( i + 1 ) * BULK_LOAD_CHUNK_SIZE;
+
+		if( chunkEnd >= input->size ){
+			chunkEnd = input->size;
+		}
+		else if( chunkEnd <= chunkStart ){
+			// the last chunk's last line ran past all of this one
+			chunkEnd = chunkStart;
+		}
+		else{
+			const char* newLine = memchr( input->text + chunkEnd - 1, '\n', input->size - chunkEnd + 1 );
+			chunkEnd = ( newLine == NULL ) ? input->size : (size_t)( newLine + 1 - input->text );
+		}
+
+		chunks[ i ].start = input->text + chunkStart;
+		chunks[ i ].end = input->text + chunkEnd;
+		chunks[ i ].numLines = 0;
+		chunks[ i ].lines = NULL;
+		chunks[ i ].numParsed = 0;
+		chunkStart = chunkEnd;
+	}
+}
+
+/*
+* countChunkLines
+* ----------------------------------
+*
+* Worker task that counts the lines of a chunk, so
+* its parsed lines can be allocated up front.
+*
+* @_chunk ------------------> InputChunk* to count lines of.
+*
+* @return ------------------> None.
+*
+*/
+static void countChunkLines( void* _chunk ){
+
+	InputChunk* chunk = (InputChunk*)_chunk;
+	const char* line = chunk->start;
+
+	chunk->numLines = 0;
+	while( line != chunk->end ){
+		const char* newLine = memchr( line, '\n', chunk->end - line );
+		line = ( newLine == NULL ) ? chunk->end : newLine + 1;
+		++chunk->numLines;
+	}
+}
+
+/*
+* parseLine
+* ----------------------------------
+*
+* Tokenizes and validates one line without touching any
+* shared state, so any number of lines may be parsed at once.
+*
+* @line --------------------> Chars of the line, need not be \0 terminated.
+* @length ------------------> Number of chars in line.
+* @parsed ------------------> Set to what the line holds.
+*
+* @return ------------------> _Bool indicating if the line holds anything to load.
+*
+*/
+static _Bool parseLine( const char* line, size_t length, ParsedLine* parsed ){
+
+	Tokenizer tokens;
+	StringView parsedCommand;
+
+	initTokenizer( &tokens, line, length );
+
+	if( !nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &parsedCommand ) ){
+		return 0;
+	}
+
+	if( viewEquals( parsedCommand, ADD_PATRON_COMMAND ) ){
+		parsed->kind = PARSED_PATRON;
+		return parsePatronCommand( &tokens, &parsed->key, &parsed->name );
+	}
+	else if( viewEquals( parsedCommand, ADD_ITEM_COMMAND ) ){
+		parsed->kind = PARSED_ITEM;
+		return parseItemCommand( &tokens, &parsed->numCopies, &parsed->key, &parsed->name, &parsed->title );
+	}
+
+	parsed->kind = PARSED_OTHER;
+	parsed->line.start = line;
+	parsed->line.length = length;
+	return 1;
+}
+
+/*
+* parseChunk
+* ----------------------------------
+*
+* Worker task that parses every line of a chunk into its lines array.
+* Chunks left without a lines array are skipped, they are parsed
+* later as they are loaded.
+*
+* @_chunk ------------------> InputChunk* to parse.
+*
+* @return ------------------> None.
+*
+*/
+static void parseChunk( void* _chunk ){
+
+	InputChunk* chunk = (InputChunk*)_chunk;
+	const char* line = chunk->start;
+
+	if( chunk->lines == NULL ){
+		return;
+	}
+
+	chunk->numParsed = 0;
+	while( line != chunk->end ){
+		const char* newLine = memchr( line, '\n', chunk->end - line );
+		const char* lineEnd = ( newLine == NULL ) ? chunk->end : newLine + 1;
+
+		if( parseLine( line, lineEnd - line, &chunk->lines[ chunk->numParsed ] ) ){
+			++chunk->numParsed;
+		}
+		line = lineEnd;
+	}
+}
+
+/*
+* appendToBatch
+* ----------------------------------
+*
+* Adds a node to the end of the batch, doubling the
+* batch's array when it is full.
+*
+* @batch -------------------> Batch to add node to.
+* @node --------------------> Node to add.
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool appendToBatch( NodeBatch* batch, ListNode* node ){
+
+	if( batch->numNodes == batch->capacity ){
+		size_t newCapacity = ( batch->capacity == 0 ) ? 1024 : batch->capacity * 2;
+
+		ListNode** newNodes = (ListNode**) allocate( sizeof( ListNode* ) * newCapacity );
+		if( newNodes == NULL ){
+			writeOutputString( "Memory allocation failed!\n" );
+			return 0;
+		}
+		if( batch->nodes != NULL ){
+			memcpy( newNodes, batch->nodes, sizeof( ListNode* ) * batch->numNodes );
+			unallocate( batch->nodes );
+		}
+		batch->nodes = newNodes;
+		batch->capacity = newCapacity;
+	}
+	batch->nodes[ batch->numNodes++ ] = node;
+	return 1;
+}
+
+/*
+* addToBatch
+* ----------------------------------
+*
+* Queues a freshly created node to be linked with the rest of
+* its batch. If the batch cannot grow the node is linked right away.
+*
+* @batch -------------------> Batch to add node to.
+* @node --------------------> Node to add, NULL is ignored.
+*
+* @return ------------------> None.
+*
+*/
+static void addToBatch( NodeBatch* batch, ListNode* node ){
+
+	if( node == NULL ){
+		return;
+	}
+	if( !appendToBatch( batch, node ) ){
+		if( batch->kind == PARSED_PATRON ){
+			linkPatronNodeInOrder( &g_PatronsList, node );
+		}
+		else{
+			linkItemNodeInOrder( &g_ItemsList, node );
+		}
+	}
+}
+
+/*
+* runMergeTask
+* ----------------------------------
+*
+* Worker task that sorts or merges one part of a batch.
+*
+* @_task -------------------> MergeTask* to run.
+*
+* @return ------------------> None.
+*
+*/
+static void runMergeTask( void* _task ){
+
+	MergeTask* task = (MergeTask*)_task;
+
+	if( task->kind == PARSED_PATRON ){
+		if( task->numSecond == 0 ){
+			sortPatronNodes( task->first, task->merged, task->numFirst );
+		}
+		else{
+			mergeSortedPatronNodes( task->first, task->numFirst, task->second, task->numSecond, task->merged );
+		}
+	}
+	else{
+		if( task->numSecond == 0 ){
+			sortItemNodes( task->first, task->merged, task->numFirst );
+		}
+		else{
+			mergeSortedItemNodes( task->first, task->numFirst, task->second, task->numSecond, task->merged );
+		}
+	}
+}
+
+/*
+* findMergeSplit
+* ----------------------------------
+*
+* Finds how many of the first numMerged nodes of the merge
+* of first and second come from first, so a single merge can
+* be split into parts that are merged independently.
+*
+* @first -------------------> First sorted run.
+* @numFirst ----------------> Number of nodes in first.
+* @second ------------------> Second sorted run.
+* @numSecond ---------------> Number of nodes in second.
+* @numMerged ---------------> Number of merged nodes to split after.
+* @kind --------------------> PARSED_PATRON or PARSED_ITEM, which list the nodes belong in.
+*
+* @return ------------------> Number of nodes taken from first.
+*
+*/
+static size_t findMergeSplit( ListNode** first, size_t numFirst, ListNode** second, size_t numSecond, size_t numMerged, uint_least8_t kind ){
+
+	size_t low = ( numMerged > numSecond ) ? numMerged - numSecond : 0;
+	size_t high = ( numMerged < numFirst ) ? numMerged : numFirst;
+
+	while( low < high ){
+		size_t middle = low + ( high - low ) / 2;
+
+		// merging takes first[ middle ] ahead of second[ numMerged - middle - 1 ] unless it has lower precedence
+		RecordHandle firstRecord = first[ middle ]->record;
+		RecordHandle secondRecord = second[ numMerged - middle - 1 ]->record;
+		_Bool hasLowerPrecedence = ( kind == PARSED_PATRON ) ? newPatronHasLowerPrecedence( firstRecord, secondRecord ) : newItemHasLowerPrecedence( firstRecord, secondRecord );
+
+		if( hasLowerPrecedence ){
+			high = middle;
+		}
+		else{
+			low = middle + 1;
+		}
+	}
+	return low;
+}
+
+/*
+* sortBatchInParallel
+* ----------------------------------
+*
+* Sorts a batch into list order. The batch is cut into one run per
+* worker and the runs are sorted at once, then pairs of runs are
+* merged until one is left. Each merge is split into parts with
+* findMergeSplit so every worker keeps busy even on the last merge.
+*
+* @batch -------------------> Batch to sort.
+* @scratch -----------------> Array with room for the batch's nodes.
+*
+* @return ------------------> None.
+*
+*/
+static void sortBatchInParallel( NodeBatch* batch, ListNode** scratch ){
+
+	size_t numNodes = batch->numNodes;
+	size_t numRuns = getNumWorkers();
+
+	if( numNodes < BULK_LOAD_MIN_PARALLEL_SORT || numRuns == 1 ){
+		MergeTask sortTask = { batch->nodes, numNodes, NULL, 0, scratch, batch->kind };
+		runMergeTask( &sortTask );
+		return;
+	}
+
+	// every run ends where the next starts, runStarts[ numRuns ] is the end of the batch
+	size_t runStarts[ BULK_LOAD_MAX_WORKERS + 1 ];
+	MergeTask tasks[ BULK_LOAD_MAX_WORKERS ];
+	size_t numTasks = 0;
+
+	for( size_t i = 0; i <= numRuns; ++i ){
+		runStarts[ i ] = numNodes * i / numRuns;
+	}
+
+	for( size_t i = 0; i < numRuns; ++i ){
+		MergeTask sortTask = { batch->nodes + runStarts[ i ], runStarts[ i + 1 ] - runStarts[ i ], NULL, 0, scratch + runStarts[ i ], batch->kind };
+		tasks[ numTasks++ ] = sortTask;
+	}
+	runTasksInParallel( tasks, sizeof( MergeTask ), numTasks, runMergeTask );
+
+	ListNode** source = batch->nodes;
+	ListNode** destination = scratch;
+
+	while( numRuns > 1 ){
+		size_t numPairs = numRuns / 2;
+		size_t partsPerPair = getNumWorkers() / numPairs;
+		numTasks = 0;
+
+		for( size_t pair = 0; pair < numPairs; ++pair ){
+			ListNode** first = source + runStarts[ 2 * pair ];
+			size_t numFirst = runStarts[ 2 * pair + 1 ] - runStarts[ 2 * pair ];
+			ListNode** second = source + runStarts[ 2 * pair + 1 ];
+			size_t numSecond = runStarts[ 2 * pair + 2 ] - runStarts[ 2 * pair + 1 ];
+			ListNode** merged = destination + runStarts[ 2 * pair ];
+			size_t partStart = 0;
+			size_t partFirstStart = 0;
+
+			for( size_t part = 1; part <= partsPerPair; ++part ){
+				size_t partEnd = ( numFirst + numSecond ) * part / partsPerPair;
+				size_t partFirstEnd = findMergeSplit( first, numFirst, second, numSecond, partEnd, batch->kind );
+				size_t partSecondStart = partStart - partFirstStart;
+				size_t partSecondEnd = partEnd - partFirstEnd;
+
+				// a part taken all from one run is already in order
+				if( partSecondStart == partSecondEnd ){
+					memcpy( merged + partStart, first + partFirstStart, sizeof( ListNode* ) * ( partFirstEnd - partFirstStart ) );
+				}
+				else if( partFirstStart == partFirstEnd ){
+					memcpy( merged + partStart, second + partSecondStart, sizeof( ListNode* ) * ( partSecondEnd - partSecondStart ) );
+				}
+				else{
+					MergeTask mergeTask = { first + partFirstStart, partFirstEnd - partFirstStart, second + partSecondStart, partSecondEnd - partSecondStart, merged + partStart, batch->kind };
+					tasks[ numTasks++ ] = mergeTask;
+				}
+				partStart = partEnd;
+				partFirstStart = partFirstEnd;
+			}
+		}
+
+		// an odd run out has nothing to merge with this time round
+		if( numRuns % 2 == 1 ){
+			memcpy( destination + runStarts[ numRuns - 1 ], source + runStarts[ numRuns - 1 ], sizeof( ListNode* ) * ( runStarts[ numRuns ] - runStarts[ numRuns - 1 ] ) );
+		}
+
+		runTasksInParallel( tasks, sizeof( MergeTask ), numTasks, runMergeTask );
+
+		for( size_t i = 0; i <= numPairs; ++i ){
+			runStarts[ i ] = runStarts[ 2 * i ];
+		}
+		if( numRuns % 2 == 1 ){
+			runStarts[ numPairs + 1 ] = runStarts[ numRuns ];
+		}
+		numRuns = ( numRuns + 1 ) / 2;
+
+		ListNode** swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	if( source != batch->nodes ){
+		memcpy( batch->nodes, source, sizeof( ListNode* ) * numNodes );
+	}
+}
+
+/*
+* linkBatch
+* ----------------------------------
+*
+* Sorts a batch with sortBatchInParallel, links it
+* into its list and empties the batch. If there is
+* no room to sort in, linkPatronNodesInOrder or
+* linkItemNodesInOrder is left to it.
+*
+* @batch -------------------> Batch to link.
+*
+* @return ------------------> None.
+*
+*/
+static void linkBatch( NodeBatch* batch ){
+
+	if( batch->numNodes == 0 ){
+		return;
+	}
+
+	ListNode** scratch = (ListNode**) allocate( sizeof( ListNode* ) * batch->numNodes );
+	if( scratch == NULL ){
+		if( batch->kind == PARSED_PATRON ){
+			linkPatronNodesInOrder( &g_PatronsList, batch->nodes, batch->numNodes );
+		}
+		else{
+			linkItemNodesInOrder( &g_ItemsList, batch->nodes, batch->numNodes );
+		}
+	}
+	else{
+		sortBatchInParallel( batch, scratch );
+		unallocate( scratch );
+
+		if( batch->kind == PARSED_PATRON ){
+			linkSortedPatronNodesInOrder( &g_PatronsList, batch->nodes, batch->numNodes );
+		}
+		else{
+			linkSortedItemNodesInOrder( &g_ItemsList, batch->nodes, batch->numNodes );
+		}
+	}
+	batch->numNodes = 0;
+}
+
+/*
+* loadParsedLine
+* ----------------------------------
+*
+* Loads one parsed line. Patron and item records are created and
+* indexed right away, so duplicate IDs are reported in input order
+* exactly as addPatron/addItem would. Their nodes are collected to be
+* linked into the lists all at once. Any other command first links
+* what has been collected so far and is then processed normally.
+*
+* @parsed ------------------> Line to load.
+* @patrons -----------------> Batch of patron nodes waiting to be linked.
+* @items -------------------> Batch of item nodes waiting to be linked.
+*
+* @return ------------------> None.
+*
+*/
+static void loadParsedLine( const ParsedLine* parsed, NodeBatch* patrons, NodeBatch* items ){
+
+	switch( parsed->kind ){
+		case PARSED_PATRON:
+		  {
+			addToBatch( patrons, createPatronNode( parsed->key, parsed->name ) );
+			break;
+		  }
+		case PARSED_ITEM:
+		  {
+			addToBatch( items, createItemNode( parsed->numCopies, parsed->key, parsed->name, parsed->title ) );
+			break;
+		  }
+		default:
+		  {
+			// commands like discard expect every record to be in its list
+			linkBatch( patrons );
+			linkBatch( items );
+
+			processLine( parsed->line.start, parsed->line.length );
+			break;
+		  }
+	}
+}
+
+/*
+* loadChunk
+* ----------------------------------
+*
+* Loads every line of a chunk in order. Chunks that could not be
+* given a lines array are parsed here, one line at a time.
+*
+* @chunk -------------------> Chunk to load.
+* @patrons -----------------> Batch of patron nodes waiting to be linked.
+* @items -------------------> Batch of item nodes waiting to be linked.
+*
+* @return ------------------> None.
+*
+*/
+static void loadChunk( const InputChunk* chunk, NodeBatch* patrons, NodeBatch* items ){
+
+	if( chunk->lines != NULL ){
+		for( size_t i = 0; i < chunk->numParsed; ++i ){
+			loadParsedLine( &chunk->lines[ i ], patrons, items );
+		}
+		return;
+	}
+
+	const char* line = chunk->start;
+
+	while( line != chunk->end ){
+		const char* newLine = memchr( line, '\n', chunk->end - line );
+		const char* lineEnd = ( newLine == NULL ) ? chunk->end : newLine + 1;
+		ParsedLine parsed;
+
+		if( parseLine( line, lineEnd - line, &parsed ) ){
+			loadParsedLine( &parsed, patrons, items );
+		}
+		line = lineEnd;
+	}
+}
+
+/*
+* bulkLoadFiles
+* ----------------------------------
+*
+* Loads every line of every file, in order, as processInput
+* would. All the files are read and split into chunks first.
+* Workers then parse BULK_LOAD_CHUNKS_PER_WORKER chunks each
+* at a time, no matter which file they come from, and those chunks
+* are loaded in order before the next ones are parsed. Whatever is
+* left in the batches is sorted in parallel and linked at the end.
+*
+* @files -------------------> Files to load, in order.
+* @numFiles ----------------> Number of files.
+*
+* @return ------------------> None.
+*
+*/
+void bulkLoadFiles( FILE** files, size_t numFiles ){
+
+	NodeBatch patrons = { NULL, 0, 0, PARSED_PATRON };
+	NodeBatch items = { NULL, 0, 0, PARSED_ITEM };
+	InputText inputs[ BULK_LOAD_MAX_FILES ];
+	size_t numChunks = 0;
+
+	if( numFiles > BULK_LOAD_MAX_FILES ){
+		numFiles = BULK_LOAD_MAX_FILES;
+	}
+
+	for( size_t i = 0; i < numFiles; ++i ){
+		readInputText( files[ i ], &inputs[ i ] );
+		numChunks += countChunks( &inputs[ i ] );
+	}
+
+	InputChunk* chunks = ( numChunks == 0 ) ? NULL : (InputChunk*) allocate( sizeof( InputChunk ) * numChunks );
+
+	if( numChunks > 0 && chunks == NULL ){
+		writeOutputString( "Memory allocation failed!\n" );
+	}
+
+	numChunks = 0;
+	for( size_t i = 0; chunks != NULL && i < numFiles; ++i ){
+		splitIntoChunks( &inputs[ i ], chunks + numChunks );
+		numChunks += countChunks( &inputs[ i ] );
+	}
+
+	size_t chunksPerRound = getNumWorkers() * BULK_LOAD_CHUNKS_PER_WORKER;
+
+	for( size_t roundStart = 0; roundStart < numChunks; roundStart += chunksPerRound ){
+		size_t numRoundChunks = ( numChunks - roundStart < chunksPerRound ) ? numChunks - roundStart : chunksPerRound;
+		InputChunk* roundChunks = chunks + roundStart;
+
+		runTasksInParallel( roundChunks, sizeof( InputChunk ), numRoundChunks, countChunkLines );
+
+		// workers never allocate, so every chunk's lines are allocated here
+		for( size_t i = 0; i < numRoundChunks; ++i ){
+			if( roundChunks[ i ].numLines > 0 ){
+				roundChunks[ i ].lines = (ParsedLine*) allocate( sizeof( ParsedLine ) * roundChunks[ i ].numLines );
+			}
+		}
+
+		runTasksInParallel( roundChunks, sizeof( InputChunk ), numRoundChunks, parseChunk );
+
+		for( size_t i = 0; i < numRoundChunks; ++i ){
+			loadChunk( &roundChunks[ i ], &patrons, &items );
+
+			if( roundChunks[ i ].lines != NULL ){
+				unallocate( roundChunks[ i ].lines );
+			}
+		}
+	}
+
+	if( chunks != NULL ){
+		unallocate( chunks );
+	}
+
+	linkBatch( &patrons );
+	linkBatch( &items );
+
+	if( patrons.nodes != NULL ){
+		unallocate( patrons.nodes );
+	}
+	if( items.nodes != NULL ){
+		unallocate( items.nodes );
+	}
+	for( size_t i = 0; i < numFiles; ++i ){
+		freeInputText( &inputs[ i ] );
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef BULK_LOAD_H
+#define BULK_LOAD_H
+/*
+* This file contains methods which load the initial
+* patron and item files. Records are created and indexed
+* as they are read but only linked into their ordered lists
+* once per batch, after the batch has been sorted.
+* Parsing and sorting are spread across worker threads.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include <stdio.h>
+
+// Files are split into chunks of about this many chars for the workers to parse
+#define BULK_LOAD_CHUNK_SIZE ( 1 << 20 )
+#define BULK_LOAD_CHUNKS_PER_WORKER 4
+
+// Upper bounds on how many threads work at once and how many files load at once
+#define BULK_LOAD_MAX_WORKERS 16
+#define BULK_LOAD_MAX_FILES 8
+
+// Batches smaller than this are sorted on the calling thread
+#define BULK_LOAD_MIN_PARALLEL_SORT 16384
+
+// Loads the files in order the way processInput would, but in parallel batches
+void bulkLoadFiles( FILE** files, size_t numFiles );
+#endif
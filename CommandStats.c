@@ -0,0 +1,327 @@
+/*
+* This file contains methods which count every command that
+* processCommand runs and time it into per-thread histograms.
+*
+*
+* @author Greg Mojonnier
+*/
+
+// clock_gettime is POSIX, not part of c99
+#define _POSIX_C_SOURCE 200809L
+
+#include "CommandStats.h"
+#include "LatencyHistogram.h"
+#include "LibraryLocks.h"
+#include "OutputWriter.h"
+#include <allocate.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "AllConstants.h"
+
+#define NANOSECONDS_PER_SECOND 1000000000ULL
+
+// Room for one row of the table
+#define STATS_ROW_MAX_SIZE 160
+
+/*
+* Data Structure: CommandStatsSlot
+* ----------------------------------
+*
+* One thread's histograms. Slots are only ever added to the
+* front of s_Slots and are kept until freeCommandStats.
+*
+* @histograms ------------> Histogram of each command and how it ended, NULL until first counted.
+* @next ------------------> Slot of the thread that started counting before this one.
+*
+*/
+typedef struct CommandStatsSlot {
+	LatencyHistogram* histograms[ COMMAND_TYPES ][ COMMAND_STATUSES ];
+	struct CommandStatsSlot* next;
+} CommandStatsSlot;
+
+static CommandStatsSlot* s_Slots = NULL;
+static _Thread_local CommandStatsSlot* s_ThreadSlot = NULL;
+
+// Dump interval and when the next dump is due, 0 for never
+static uint_least64_t s_DumpInterval = 0;
+static uint_least64_t s_NextDumpTime = 0;
+
+static const char* const s_TypeNames[ COMMAND_TYPES ] = {
+	ADD_PATRON_COMMAND,
+	ADD_ITEM_COMMAND,
+	BORROW_ITEM_COMMAND,
+	RETURN_ITEM_COMMAND,
+	DISCARD_ITEM_COMMAND,
+	OUT_COMMAND,
+	AVAILABLE_ITEM_COMMAND
+};
+
+static const char* const s_StatusNames[ COMMAND_STATUSES ] = {
+	"ok",
+	"malformed",
+	"no such patron",
+	"no such item",
+	"no copies left",
+	"too many items out",
+	"already checked out",
+	"not checked out",
+	"too few copies",
+	"already exists",
+	"out of memory"
+};
+
+/*
+* getCommandClock
+* ----------------------------------
+*  
+* Reads the monotonic clock.
+*
+*
+* @return ------------------> Nanoseconds since some fixed point in the past.
+*
+*/
+uint_least64_t getCommandClock(){
+
+	struct timespec now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (uint_least64_t)now.tv_sec * NANOSECONDS_PER_SECOND + (uint_least64_t)now.tv_nsec;
+}
+
+/*
+* allocateZeroed
+* ----------------------------------
+*  
+* Allocates and zeroes memory. The library's lock is taken
+* around it since allocate may not be called by two threads
+* at once.
+*
+* @size --------------------> Bytes to allocate.
+*
+* @return ------------------> The memory, NULL if it could not be allocated.
+*
+*/
+static void* allocateZeroed( size_t size ){
+
+	lockLibrary();
+	void* memory = allocate( size );
+	unlockLibrary();
+
+	if( memory == NULL ){
+		writeOutputString( "Memory allocation failed!\n" );
+		return NULL;
+	}
+	memset( memory, 0, size );
+	return memory;
+}
+
+/*
+* recordCommand
+* ----------------------------------
+*  
+* Counts a command in the calling thread's histogram for its
+* kind and outcome, making the slot and histogram the first
+* time they are needed.
+*
+* @type --------------------> Which command ran.
+* @status ------------------> How it ended.
+* @startTime ---------------> getCommandClock from when it started.
+*
+* @return ------------------> None.
+*
+*/
+void recordCommand( CommandType type, CommandStatus status, uint_least64_t startTime ){
+
+	uint_least64_t latency = getCommandClock() - startTime;
+	CommandStatsSlot* slot = s_ThreadSlot;
+
+	if( slot == NULL ){
+		slot = (CommandStatsSlot*) allocateZeroed( sizeof( CommandStatsSlot ) );
+		if( slot == NULL ){
+			return;
+		}
+
+		// slots are pushed under the library's lock so no two race
+		lockLibrary();
+		slot->next = s_Slots;
+		__atomic_store_n( &s_Slots, slot, __ATOMIC_RELEASE );
+		unlockLibrary();
+		s_ThreadSlot = slot;
+	}
+
+	LatencyHistogram* histogram = slot->histograms[ type ][ status ];
+	if( histogram == NULL ){
+		histogram = (LatencyHistogram*) allocateZeroed( sizeof( LatencyHistogram ) );
+		if( histogram == NULL ){
+			return;
+		}
+		__atomic_store_n( &slot->histograms[ type ][ status ], histogram, __ATOMIC_RELEASE );
+	}
+	recordLatency( histogram, latency );
+}
+
+/*
+* writeStatsRow
+* ----------------------------------
+*  
+* Writes one row of the table.
+*
+* @row ---------------------> \0 terminated row.
+* @file --------------------> Where to write it, NULL for the output.
+*
+* @return ------------------> None.
+*
+*/
+static void writeStatsRow( const char* row, FILE* file ){
+
+	if( file == NULL ){
+		writeOutputString( row );
+	}
+	else{
+		fputs( row, file );
+	}
+}
+
+/*
+* writeCommandStatsTo
+* ----------------------------------
+*  
+* Adds up every thread's histograms for each command and
+* outcome and writes a row for each that was counted, with
+* the latencies in nanoseconds.
+*
+* @file --------------------> Where to write the table, NULL for the output.
+*
+* @return ------------------> None.
+*
+*/
+static void writeCommandStatsTo( FILE* file ){
+
+	char row[ STATS_ROW_MAX_SIZE ];
+	LatencyHistogram merged;
+
+	snprintf( row, sizeof( row ), "%-10s %-20s %10s %10s %10s %10s %10s %10s\n",
+	          "command", "outcome", "count", "mean_ns", "p50_ns", "p99_ns", "p99.9_ns", "max_ns" );
+	writeStatsRow( row, file );
+
+	CommandStatsSlot* firstSlot = __atomic_load_n( &s_Slots, __ATOMIC_ACQUIRE );
+
+	for( unsigned int type = 0; type < COMMAND_TYPES; ++type ){
+		for( unsigned int status = 0; status < COMMAND_STATUSES; ++status ){
+			memset( &merged, 0, sizeof( merged ) );
+
+			for( CommandStatsSlot* slot = firstSlot; slot != NULL; slot = slot->next ){
+				const LatencyHistogram* histogram = __atomic_load_n( &slot->histograms[ type ][ status ], __ATOMIC_ACQUIRE );
+				if( histogram != NULL ){
+					mergeLatencyHistogram( &merged, histogram );
+				}
+			}
+
+			if( merged.count == 0 ){
+				continue;
+			}
+			snprintf( row, sizeof( row ), "%-10s %-20s %10" PRIuLEAST64 " %10" PRIuLEAST64 " %10" PRIuLEAST64
+			          " %10" PRIuLEAST64 " %10" PRIuLEAST64 " %10" PRIuLEAST64 "\n",
+			          s_TypeNames[ type ], s_StatusNames[ status ], merged.count,
+			          getLatencyMean( &merged ), getLatencyPercentile( &merged, 50.0 ),
+			          getLatencyPercentile( &merged, 99.0 ), getLatencyPercentile( &merged, 99.9 ), merged.max );
+			writeStatsRow( row, file );
+		}
+	}
+}
+
+/*
+* writeCommandStats
+* ----------------------------------
+*  
+* Writes the stats table to the output, see writeCommandStatsTo.
+*
+*
+* @return ------------------> None.
+*
+*/
+void writeCommandStats(){
+	writeCommandStatsTo( NULL );
+}
+
+/*
+* setCommandStatsInterval
+* ----------------------------------
+*  
+* Sets how often pollCommandStats dumps the stats, the
+* first dump is one interval from now.
+*
+* @intervalSeconds ---------> Seconds between dumps, 0 for never.
+*
+* @return ------------------> None.
+*
+*/
+void setCommandStatsInterval( uint_least32_t intervalSeconds ){
+
+	uint_least64_t interval = (uint_least64_t)intervalSeconds * NANOSECONDS_PER_SECOND;
+
+	__atomic_store_n( &s_NextDumpTime, ( interval == 0 ) ? 0 : getCommandClock() + interval, __ATOMIC_RELAXED );
+	__atomic_store_n( &s_DumpInterval, interval, __ATOMIC_RELAXED );
+}
+
+/*
+* pollCommandStats
+* ----------------------------------
+*  
+* Dumps the stats to stderr once the interval has passed. When
+* several threads poll at once only the one that moves the next
+* dump time on writes them.
+*
+*
+* @return ------------------> None.
+*
+*/
+void pollCommandStats(){
+
+	uint_least64_t interval = __atomic_load_n( &s_DumpInterval, __ATOMIC_RELAXED );
+	if( interval == 0 ){
+		return;
+	}
+
+	uint_least64_t now = getCommandClock();
+	uint_least64_t nextDumpTime = __atomic_load_n( &s_NextDumpTime, __ATOMIC_RELAXED );
+
+	if( now >= nextDumpTime && __atomic_compare_exchange_n( &s_NextDumpTime, &nextDumpTime, now + interval, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ){
+		writeCommandStatsTo( stderr );
+		fflush( stderr );
+	}
+}
+
+/*
+* freeCommandStats
+* ----------------------------------
+*  
+* Frees every slot and histogram. Only the calling thread
+* may count again afterwards.
+*
+*
+* @return ------------------> None.
+*
+*/
+void freeCommandStats(){
+
+	CommandStatsSlot* slot = s_Slots;
+
+	while( slot != NULL ){
+		CommandStatsSlot* next = slot->next;
+
+		for( unsigned int type = 0; type < COMMAND_TYPES; ++type ){
+			for( unsigned int status = 0; status < COMMAND_STATUSES; ++status ){
+				if( slot->histograms[ type ][ status ] != NULL ){
+					unallocate( slot->histograms[ type ][ status ] );
+				}
+			}
+		}
+		unallocate( slot );
+		slot = next;
+	}
+	s_Slots = NULL;
+	s_ThreadSlot = NULL;
+}
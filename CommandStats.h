@@ -0,0 +1,46 @@
+#ifndef COMMAND_STATS_H
+#define COMMAND_STATS_H
+/*
+* This file contains methods which count every command that
+* processCommand runs, by command and by how it ended, and keep
+* a LatencyHistogram of how long each kind took. Each thread
+* counts into histograms only it writes, so counting takes no
+* lock, and the stats command adds every thread's up when asked.
+* The same table can also be dumped to stderr every so often.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "ExecuteCommands.h"
+#include <stdint.h>
+
+typedef enum {
+	COMMAND_TYPE_PATRON,
+	COMMAND_TYPE_ITEM,
+	COMMAND_TYPE_BORROW,
+	COMMAND_TYPE_RETURN,
+	COMMAND_TYPE_DISCARD,
+	COMMAND_TYPE_OUT,
+	COMMAND_TYPE_AVAILABLE,
+	COMMAND_TYPES
+} CommandType;
+
+// Nanoseconds on a clock that only moves forward
+uint_least64_t getCommandClock( );
+
+// Counts a command that started at startTime, call it holding none of the library's locks
+void recordCommand( CommandType type, CommandStatus status, uint_least64_t startTime );
+
+// Writes a row for every kind of command counted so far to the output
+void writeCommandStats( );
+
+// Dumps the stats to stderr every intervalSeconds from pollCommandStats, 0 never does
+void setCommandStatsInterval( uint_least32_t intervalSeconds );
+
+// Called between commands, dumps the stats if the interval has passed
+void pollCommandStats( );
+
+// Only once no thread is counting any more
+void freeCommandStats( );
+#endif
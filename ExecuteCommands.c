@@ -2,7 +2,7 @@
 * This file contains methods which each map to a legal command.
 * These methods in general are specifing how the more generic
 * functions from LinkedDataNodeOperations.h should interpret
-* ListNode*'s void* data.
+* the patron and item records their ListNodes hold.
 *
 *
 * @author Greg Mojonnier
@@ -10,38 +10,88 @@
 
 #include "ExecuteCommands.h"
 #include "LinkedDataNodeOperations.h"
+#include "UIDIndex.h"
+#include "RecordStore.h"
+#include "OutputWriter.h"
+#include "Journal.h"
+#include "LibraryLocks.h"
 #include <string.h>
-#include <allocate.h>
 #include <stdio.h>
 #include "AllConstants.h"
 
-extern ListNode* g_PatronsHead;
-extern ListNode* g_ItemsHead;
+extern OrderedList g_PatronsList;
+extern OrderedList g_ItemsList;
+extern UIDIndex g_PatronsIndex;
+extern UIDIndex g_ItemsIndex;
+
+/*
+* writeItemDescription
+* ----------------------------------
+*  
+* Writes an item as "CID (author/title)".
+*
+* @item --------------------> Item to describe.
+*
+* @return ------------------> None.
+*/
+static void writeItemDescription( RecordHandle item ){
+	writeOutputCID( g_ItemRecords.cids[ item ] );
+	writeOutputString( " (" );
+	writeOutputString( ITEM_AUTHOR( item ) );
+	writeOutputChar( '/' );
+	writeOutputString( ITEM_TITLE( item ) );
+	writeOutputChar( ')' );
+}
+
+/*
+* writePatronDescription
+* ----------------------------------
+*  
+* Writes a patron as "PID (name)".
+*
+* @patron ------------------> Patron to describe.
+*
+* @return ------------------> None.
+*/
+static void writePatronDescription( RecordHandle patron ){
+	writeOutputPID( g_PatronRecords.pids[ patron ] );
+	writeOutputString( " (" );
+	writeOutputString( PATRON_NAME( patron ) );
+	writeOutputChar( ')' );
+}
 
 /*
 * getCopiesAvailable
 * ----------------------------------
 *  
 * Prints how many copies of an item with the specified CID
-* are available to be checked out.
+* are available to be checked out. numCopies only changes with
+* the library held exclusively, numCopiesOut is one atomic load.
 *
-* @cid ---------------------> cid to match node from.
+* @cid ---------------------> Encoded cid to match item from.
 *
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 */
-void getCopiesAvailable( const char* cid ){
+CommandStatus getCopiesAvailable( ItemKey cid ){
 
-	ListNode* itemNode = findNodeWithUID( g_ItemsHead, cid, 0 );
-	if( itemNode == NULL ){
-		fprintf( stderr, "%s does not exist\n", cid );
-		return;
+	RecordHandle item = findItem( cid );
+	if( item == NO_RECORD ){
+		writeErrorMessage( CID_FORMAT " does not exist\n", CID_FORMAT_ARGS( cid ) );
+		return COMMAND_NO_SUCH_ITEM;
 	}	
 	
-	ItemData* item = (ItemData*)itemNode->data;
-	uint_least8_t copiesAvailable = item->numCopies - getListSize( item->patronsCurrentlyRenting );
-
-	printf("Item %s (%s/%s): %i of %i copies available\n", cid, item->author, item->title, copiesAvailable, item->numCopies );
+	uint_least8_t numCopies = g_ItemRecords.numCopies[ item ];
+	uint_least8_t copiesAvailable = numCopies - LOAD_SHARED( g_ItemRecords.numCopiesOut[ item ] );
+
+	writeOutputString( "Item " );
+	writeItemDescription( item );
+	writeOutputString( ": " );
+	writeOutputInt( copiesAvailable );
+	writeOutputString( " of " );
+	writeOutputInt( numCopies );
+	writeOutputString( " copies available\n" );
+	return COMMAND_SUCCEEDED;
 }
 
 /*
@@ -49,49 +99,49 @@ void getCopiesAvailable( const char* cid ){
 * ----------------------------------
 *  
 * Borrows the item specified by CID for the patron
-* specified by PID. A node containing a pointer to one another is
-* inserted into the CID & PID's sublists.(patronsCurrentlyRenting, itemsCurrentlyRenting)
+* specified by PID. One loan record is linked into both the
+* CID & PID's loan lists.(patronsCurrentlyRenting, itemsCurrentlyRenting)
 *
 *
-* @pid ---------------------> pid who will be borrowing an item.
-* @cid ---------------------> cid of the item to borrow.
+* @pid ---------------------> Encoded pid who will be borrowing an item.
+* @cid ---------------------> Encoded cid of the item to borrow.
 *
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 */
-void borrowItem( const char* pid, const char* cid ){
-	ListNode* patronNode = findNodeWithUID( g_PatronsHead, pid, 1 );
-	if( patronNode == NULL ){
-		fprintf( stderr, "%s does not exist\n", pid);
-		return;
+CommandStatus borrowItem( PatronKey pid, ItemKey cid ){
+	RecordHandle patron = findPatron( pid );
+	if( patron == NO_RECORD ){
+		writeErrorMessage( PID_FORMAT " does not exist\n", PID_FORMAT_ARGS( pid ) );
+		return COMMAND_NO_SUCH_PATRON;
 	}
-	ListNode* itemNode = findNodeWithUID( g_ItemsHead, cid, 0 );
+	RecordHandle item = findItem( cid );
 	
-	if( itemNode == NULL ){
-		fprintf( stderr, "%s does not exist\n", cid );
-		return;
+	if( item == NO_RECORD ){
+		writeErrorMessage( CID_FORMAT " does not exist\n", CID_FORMAT_ARGS( cid ) );
+		return COMMAND_NO_SUCH_ITEM;
 	}
 
-	ItemData* item = (ItemData*)itemNode->data;
-	
-	if( getListSize( item->patronsCurrentlyRenting ) == item->numCopies ){
-		fprintf( stderr, "No more copies of %s are available\n", cid );
-		return;
+	if( g_ItemRecords.numCopiesOut[ item ] == g_ItemRecords.numCopies[ item ] ){
+		writeErrorMessage( "No more copies of " CID_FORMAT " are available\n", CID_FORMAT_ARGS( cid ) );
+		return COMMAND_NO_COPIES_LEFT;
 	}
 
-	PatronData* patron = (PatronData*) patronNode->data;
-	if( getListSize( patron->itemsCurrentlyRenting ) == 5 ){
-		fprintf( stderr, "%s cannot check out any more items\n", pid );
-		return;
+	if( g_PatronRecords.numItemsOut[ patron ] == PATRON_MAX_ITEMS_OUT ){
+		writeErrorMessage( PID_FORMAT " cannot check out any more items\n", PID_FORMAT_ARGS( pid ) );
+		return COMMAND_TOO_MANY_ITEMS_OUT;
 	}
 
-	if( findNodeWithData( patron->itemsCurrentlyRenting, itemNode ) != NULL ){
-		fprintf( stderr, "%s already has %s checked out\n", pid, cid );
-		return;
+	if( findPatronsLoan( patron, item ) != NO_LOAN ){
+		writeErrorMessage( PID_FORMAT " already has " CID_FORMAT " checked out\n", PID_FORMAT_ARGS( pid ), CID_FORMAT_ARGS( cid ) );
+		return COMMAND_ALREADY_CHECKED_OUT;
 	}
 
-	insertNodeInOrder( &patron->itemsCurrentlyRenting, itemNode, newItemHasLowerPrecedence );
-	insertNodeInOrder( &item->patronsCurrentlyRenting, patronNode, newPatronHasLowerPrecedence );
+	if( createLoan( patron, item ) == NO_LOAN ){
+		return COMMAND_OUT_OF_MEMORY;
+	}
+	journalBorrow( pid, cid );
+	return COMMAND_SUCCEEDED;
 }
 
 /*
@@ -101,102 +151,104 @@ void borrowItem( const char* pid, const char* cid ){
 * Discards a specified number of copies of an item specified by cid.
 * Only allows you to discard non checked out items and only if there are
 * enough available items to discard the full amount you specified.
-* The node is deleted if copies of an item reaches 0.
+* The item is deleted if its copies reach 0.
 *
 *
 * @numToDelete  ------------> Number of copies of the item to delete.
-* @cid ---------------------> cid of the item to discard copies of.
+* @cid ---------------------> Encoded cid of the item to discard copies of.
 *
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 */
-void discardCopiesOfItem( uint_least8_t numToDelete, const char* cid){
+CommandStatus discardCopiesOfItem( uint_least8_t numToDelete, ItemKey cid ){
 
-	ListNode* itemNode = findNodeWithUID( g_ItemsHead, cid, 0 );
-	if( itemNode == NULL ){
-		fprintf( stderr, "%s does not exist\n", cid );
-		return;
+	RecordHandle item = findItem( cid );
+	if( item == NO_RECORD ){
+		writeErrorMessage( CID_FORMAT " does not exist\n", CID_FORMAT_ARGS( cid ) );
+		return COMMAND_NO_SUCH_ITEM;
 	}
 
-	ItemData* item = (ItemData*)itemNode->data;
-
-	if( ( item->numCopies - getListSize( item->patronsCurrentlyRenting ) ) < numToDelete ){
-		fprintf( stderr, "Too few copies of %s are available", cid );
-		return;
+	if( ( g_ItemRecords.numCopies[ item ] - g_ItemRecords.numCopiesOut[ item ] ) < numToDelete ){
+		writeErrorMessage( "Too few copies of " CID_FORMAT " are available", CID_FORMAT_ARGS( cid ) );
+		return COMMAND_TOO_FEW_COPIES;
 	}
 	
-	item->numCopies -= numToDelete;
+	g_ItemRecords.numCopies[ item ] -= numToDelete;
 
-	if( item->numCopies == 0 ){
-		deleteNode( &g_ItemsHead, itemNode, freeItemDataStruct );
+	if( g_ItemRecords.numCopies[ item ] == 0 ){
+		setIndexedRecord( &g_ItemsIndex, cid, NO_RECORD );
+		deleteItemNode( &g_ItemsList, item );
 	}
+	journalDiscard( numToDelete, cid );
+	return COMMAND_SUCCEEDED;
 }
 
 /*
 * addItem
 * ----------------------------------
 *  
-* Allocates a new ItemData, sets all of its info from arguments,
+* Creates a new item node from arguments and
 * inserts node in list in order.
 *
 * @numCopies ---------------> number of copies to set into node.
-* @cid ---------------------> cid to set into node.
+* @cid ---------------------> Encoded cid to set into node.
 * @author ------------------> author to set into node.
 * @title -------------------> title to set into node.
 *
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 */
-void addItem( uint_least8_t numCopies, const char* cid, const char* author, const char* title ){
+CommandStatus addItem( uint_least8_t numCopies, ItemKey cid, StringView author, StringView title ){
 
-	ListNode* existingItemNode;
-	if( ( existingItemNode = findNodeWithUID( g_ItemsHead, cid, 0 ) ) != NULL ){
-		ItemData* existingItem = (ItemData*)existingItemNode->data;
-		fprintf( stderr, "Item %s (%s/%s) already associated with (%s/%s)\n", cid, author, title, existingItem->author, existingItem->title ); 
-		return;
+	ListNode* itemNode = createItemNode( numCopies, cid, author, title );
+	// only a taken cid leaves an item indexed
+	if( itemNode == NULL ){
+		return ( findItem( cid ) != NO_RECORD ) ? COMMAND_ALREADY_EXISTS : COMMAND_OUT_OF_MEMORY;
 	}
 
-	ItemData* i = (ItemData*) allocate( sizeof(ItemData) );
-
-	if( i == NULL ){
-		printf("Memory allocation failed!\n");
-		return;
-	}
+	linkItemNodeInOrder( &g_ItemsList, itemNode );
+	journalAddItem( numCopies, cid, ITEM_AUTHOR( itemNode->record ), ITEM_TITLE( itemNode->record ) );
+	return COMMAND_SUCCEEDED;
+}
 
-	i->author = (char*) allocate( ( sizeof(char) * strlen(author) ) + 1 );
+/*
+* createItemNode
+* ----------------------------------
+*  
+* Adds a new item record, sets all of its info from arguments
+* and registers it in the CID index. The node is left for
+* the caller to link into the item list.
+*
+* @numCopies ---------------> number of copies to set into node.
+* @cid ---------------------> Encoded cid to set into node.
+* @author ------------------> author to set into node.
+* @title -------------------> title to set into node.
+*
+*
+* @return ------------------> Pointer to the new node, or NULL if cid is taken.
+*/
+ListNode* createItemNode( uint_least8_t numCopies, ItemKey cid, StringView author, StringView title ){
 
-	if( i->author == NULL ){
-		printf("Memory allocation failed!\n");
-		return;
+	RecordHandle existingItem;
+	if( ( existingItem = findItem( cid ) ) != NO_RECORD ){
+		writeErrorMessage( "Item " CID_FORMAT " (%.*s/%.*s) already associated with (%s/%s)\n", CID_FORMAT_ARGS( cid ), (int)author.length, author.start, (int)title.length, title.start, ITEM_AUTHOR( existingItem ), ITEM_TITLE( existingItem ) ); 
+		return NULL;
 	}
 
-	i->title = (char*) allocate( ( sizeof(char) * strlen(title) ) + 1 );
+	RecordHandle item = addItemRecord( numCopies, cid, author, title );
 
-	if( i->title == NULL ){
-		printf("Memory allocation failed!\n");
-		return;
+	if( item == NO_RECORD ){
+		writeOutputString( "Memory allocation failed!\n" );
+		return NULL;
 	}
 
-	char cidBuffer[ CID_MIN_SIZE ];
-
-	uint_least8_t periodLocation = strcspn( cid, PERIOD_WORD_SEPARATOR ); 
-	
-	strncpy( cidBuffer, cid, periodLocation );
-	cidBuffer[ periodLocation ] = '\0';
-	uint_least16_t cidNum = strtoul( cidBuffer, NULL, 10 );
-	i->leftCID = cidNum;
-
-	strcpy( cidBuffer, cid+periodLocation+1 );
-	cidNum = strtoul( cidBuffer, NULL, 10 );
-	i->rightCID = cidNum;
-
-	i->numCopies = numCopies;
-	i->patronsCurrentlyRenting = NULL;
-
-	strcpy( i->author, author );
-	strcpy( i->title, title );
-	
-	insertNodeInOrder( &g_ItemsHead, i, newItemHasLowerPrecedence );
+	ListNode* itemNode = createNode( item );
+	if( itemNode == NULL ){
+		freeItemRecord( item );
+		return NULL;
+	}
+	setIndexedRecord( &g_ItemsIndex, cid, item );
+	return itemNode;
 }
 
 /*
@@ -207,21 +259,22 @@ void addItem( uint_least8_t numCopies, const char* cid, const char* author, cons
 * specified by cid currently checked out.
 *
 *
-* @cid ---------------------> cid who we want to know which patrons have out.
+* @cid ---------------------> Encoded cid who we want to know which patrons have out.
 *
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 */
-void patronsWithItemOut( const char* cid ){
+CommandStatus patronsWithItemOut( ItemKey cid ){
 
-	ListNode* itemNode = findNodeWithUID( g_ItemsHead, cid, 0 );
+	RecordHandle item = findItem( cid );
 	
-	if( itemNode == NULL ){
-		fprintf( stderr, "%s does not exist\n", cid );		
-		return;
+	if( item == NO_RECORD ){
+		writeErrorMessage( CID_FORMAT " does not exist\n", CID_FORMAT_ARGS( cid ) );		
+		return COMMAND_NO_SUCH_ITEM;
 	}
 
-	printItemStatus( (ItemData*) itemNode->data );
+	printItemStatus( item );
+	return COMMAND_SUCCEEDED;
 }
 
 /*
@@ -232,21 +285,22 @@ void patronsWithItemOut( const char* cid ){
 * out by the patron specified by pid.
 *
 *
-* @pid ---------------------> pid who we want to know which items has checked out.
+* @pid ---------------------> Encoded pid who we want to know which items has checked out.
 *
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 */
-void itemsOutByPatron( const char* pid ){
+CommandStatus itemsOutByPatron( PatronKey pid ){
 
-	ListNode* patronNode = findNodeWithUID( g_PatronsHead, pid, 1 );
+	RecordHandle patron = findPatron( pid );
 	
-	if( patronNode == NULL ){
-		fprintf( stderr, "%s does not exist\n", pid );		
-		return;
+	if( patron == NO_RECORD ){
+		writeErrorMessage( PID_FORMAT " does not exist\n", PID_FORMAT_ARGS( pid ) );		
+		return COMMAND_NO_SUCH_PATRON;
 	}
 
-	printPatronStatus( (PatronData*) patronNode->data );
+	printPatronStatus( patron );
+	return COMMAND_SUCCEEDED;
 }
 
 /*
@@ -254,42 +308,40 @@ void itemsOutByPatron( const char* pid ){
 * ----------------------------------
 *  
 * Returns the item specified by CID for the patron
-* specified by PID. The nodes containing pointers to one another are
-* removed from the CID & PID's sublists.(patronsCurrentlyRenting, itemsCurrentlyRenting)
+* specified by PID. The loan record is unlinked from both the
+* CID & PID's loan lists.(patronsCurrentlyRenting, itemsCurrentlyRenting)
 *
 *
-* @pid ---------------------> pid who will be returning an item.
-* @cid ---------------------> cid of the item to return.
+* @pid ---------------------> Encoded pid who will be returning an item.
+* @cid ---------------------> Encoded cid of the item to return.
 *
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 */
-void returnPatronsItem( const char* pid, const char* cid ){
+CommandStatus returnPatronsItem( PatronKey pid, ItemKey cid ){
 
-	ListNode* patronNode = findNodeWithUID( g_PatronsHead, pid, 1 );
-	if( patronNode == NULL ){
-		fprintf( stderr, "%s does not exist\n", pid );
-		return;
+	RecordHandle patron = findPatron( pid );
+	if( patron == NO_RECORD ){
+		writeErrorMessage( PID_FORMAT " does not exist\n", PID_FORMAT_ARGS( pid ) );
+		return COMMAND_NO_SUCH_PATRON;
 	}
 
-	ListNode* itemNode = findNodeWithUID( g_ItemsHead, cid, 0 );
-	if( itemNode == NULL ){
-		fprintf( stderr, "%s does not exist\n", cid );
-		return;
+	RecordHandle item = findItem( cid );
+	if( item == NO_RECORD ){
+		writeErrorMessage( CID_FORMAT " does not exist\n", CID_FORMAT_ARGS( cid ) );
+		return COMMAND_NO_SUCH_ITEM;
 	}
 
-	PatronData* patron = (PatronData*)patronNode->data;
-	ItemData* item = (ItemData*)itemNode->data;
+	LoanHandle loanToDelete = findPatronsLoan( patron, item );
 
-	ListNode* itemPtrToDelete = findNodeWithData( patron->itemsCurrentlyRenting, itemNode );
-
-	if( itemPtrToDelete == NULL ){
-		fprintf( stderr, "%s does not have %s checked out", pid, cid );
-		return;
+	if( loanToDelete == NO_LOAN ){
+		writeErrorMessage( PID_FORMAT " does not have " CID_FORMAT " checked out", PID_FORMAT_ARGS( pid ), CID_FORMAT_ARGS( cid ) );
+		return COMMAND_NOT_CHECKED_OUT;
 	}
 	else{
-		deleteNode( &patron->itemsCurrentlyRenting, itemPtrToDelete, NULL );
-		deleteNode( &item->patronsCurrentlyRenting, findNodeWithData( item->patronsCurrentlyRenting, patronNode ), NULL );
+		deleteLoan( loanToDelete );
+		journalReturn( pid, cid );
+		return COMMAND_SUCCEEDED;
 	}
 }
 
@@ -297,46 +349,64 @@ void returnPatronsItem( const char* pid, const char* cid ){
 * addPatron
 * ----------------------------------
 *  
-* Allocates a new PatronData, sets all of its info from arguments,
+* Creates a new patron node from arguments and
 * inserts node in list in order.
 *
-* @pid ---------------------> pid to set into node.
+* @pid ---------------------> Encoded pid to set into node.
 * @name --------------------> name to set into node.
 *
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 */
-void addPatron( const char* pid, const char* name ){
+CommandStatus addPatron( PatronKey pid, StringView name ){
 
-	ListNode* existingPatron;
-	if( ( existingPatron = findNodeWithUID( g_PatronsHead, pid, 1 ) ) != NULL ){
-		fprintf( stderr, "Patron %s (%s) already associated with (%s)\n", pid, name, ((PatronData*)existingPatron->data)->name );
-		return;
+	ListNode* patronNode = createPatronNode( pid, name );
+	// only a taken pid leaves a patron indexed
+	if( patronNode == NULL ){
+		return ( findPatron( pid ) != NO_RECORD ) ? COMMAND_ALREADY_EXISTS : COMMAND_OUT_OF_MEMORY;
 	}
 
-	PatronData* p = (PatronData*) allocate( sizeof(PatronData) );
-
-	if( p == NULL ){
-		printf("Memory allocation failed!\n");
-		return;
-	}
+	linkPatronNodeInOrder( &g_PatronsList, patronNode );
+	journalAddPatron( pid, PATRON_NAME( patronNode->record ) );
+	return COMMAND_SUCCEEDED;
+}
 
-	p->name = (char*) allocate( ( sizeof(char) * strlen(name) ) + 1 );
+/*
+* createPatronNode
+* ----------------------------------
+*  
+* Adds a new patron record, sets all of its info from arguments
+* and registers it in the PID index. The node is left for
+* the caller to link into the patron list.
+*
+* @pid ---------------------> Encoded pid to set into node.
+* @name --------------------> name to set into node.
+*
+*
+* @return ------------------> Pointer to the new node, or NULL if pid is taken.
+*/
+ListNode* createPatronNode( PatronKey pid, StringView name ){
 
-	if( p->name == NULL ){
-		printf("Memory allocation failed!\n");
-		return;
+	RecordHandle existingPatron;
+	if( ( existingPatron = findPatron( pid ) ) != NO_RECORD ){
+		writeErrorMessage( "Patron " PID_FORMAT " (%.*s) already associated with (%s)\n", PID_FORMAT_ARGS( pid ), (int)name.length, name.start, PATRON_NAME( existingPatron ) );
+		return NULL;
 	}
 
-	strcpy( p->name, name );
-	p->leftPID[ 0 ] = *pid;
-	p->leftPID[ 1 ] = '\0';
+	RecordHandle patron = addPatronRecord( pid, name );
 
-	p->rightPID = strtoul( pid+1, NULL, 10 );
-
-	p->itemsCurrentlyRenting = NULL;
+	if( patron == NO_RECORD ){
+		writeOutputString( "Memory allocation failed!\n" );
+		return NULL;
+	}
 
-	insertNodeInOrder( &g_PatronsHead, p, newPatronHasLowerPrecedence );
+	ListNode* patronNode = createNode( patron );
+	if( patronNode == NULL ){
+		freePatronRecord( patron );
+		return NULL;
+	}
+	setIndexedRecord( &g_PatronsIndex, pid, patron );
+	return patronNode;
 }
 
 
@@ -352,19 +422,19 @@ void addPatron( const char* pid, const char* name ){
 */
 void printAllListsStatus(){
 
-	ListNode* listToPrint = g_ItemsHead;
+	ListNode* listToPrint = g_ItemsList.head[ 0 ];
 	while( listToPrint != NULL ){
-		printItemStatus( (ItemData*) listToPrint->data );
-		listToPrint = listToPrint->next;
-		printf("\n");
+		printItemStatus( listToPrint->record );
+		listToPrint = listToPrint->next[ 0 ];
+		writeOutputChar( '\n' );
 	}
 
-	listToPrint = g_PatronsHead;
+	listToPrint = g_PatronsList.head[ 0 ];
 	while( listToPrint != NULL ){
-		printPatronStatus( (PatronData*) listToPrint->data );
-		listToPrint = listToPrint->next;
+		printPatronStatus( listToPrint->record );
+		listToPrint = listToPrint->next[ 0 ];
 		if( listToPrint != NULL ){
-			printf("\n");
+			writeOutputChar( '\n' );
 		}
 	}
 }
@@ -380,27 +450,30 @@ void printAllListsStatus(){
 * @return ------------------> None.
 *
 */
-void printItemStatus( ItemData* item ){
-	if( item == NULL ){
+void printItemStatus( RecordHandle item ){
+	if( item == NO_RECORD ){
 		return;
 	}
 
-	ListNode* patronsCurrentlyRenting = item->patronsCurrentlyRenting;
+	RecordHandle patrons[ ITEM_MAX_COPIES ];
+	uint_least8_t numPatrons = readPatronsOfItem( item, patrons );
 
-	if( patronsCurrentlyRenting == NULL ){
-		printf( "Item %d.%d (%s/%s) is not checked out\n", item->leftCID, item->rightCID, item->author, item->title ); 
+	if( numPatrons == 0 ){
+		writeOutputString( "Item " );
+		writeItemDescription( item );
+		writeOutputString( " is not checked out\n" );
 	}
 	else{
-		printf( "Item %d.%d (%s/%s) is checked out to:\n", item->leftCID, item->rightCID, item->author, item->title );
-
-		while( patronsCurrentlyRenting != NULL ){
-			PatronData* p = (PatronData*) ((ListNode*)patronsCurrentlyRenting->data)->data;
-			if( p != NULL ){
-				char fullPID[ PID_MAX_SIZE ];
-				sprintf( fullPID, "%s%04i", p->leftPID, p->rightPID );
-				printf( "   %s (%s)\n", fullPID, p->name );
+		writeOutputString( "Item " );
+		writeItemDescription( item );
+		writeOutputString( " is checked out to:\n" );
+
+		for( uint_least8_t i = 0; i < numPatrons; ++i ){
+			if( patrons[ i ] != NO_RECORD ){
+				writeOutputString( "   " );
+				writePatronDescription( patrons[ i ] );
+				writeOutputChar( '\n' );
 			}
-			patronsCurrentlyRenting = patronsCurrentlyRenting->next;
 		}
 	}
 }
@@ -417,23 +490,27 @@ void printItemStatus( ItemData* item ){
 * @return ------------------> None.
 *
 */
-void printPatronStatus( PatronData* patron ){
+void printPatronStatus( RecordHandle patron ){
 
-	ListNode* itemsCurrentlyRenting = patron->itemsCurrentlyRenting;
+	RecordHandle items[ PATRON_MAX_ITEMS_OUT ];
+	uint_least8_t numItems = readItemsOfPatron( patron, items );
 
-	if( itemsCurrentlyRenting == NULL ){
-		printf( "Patron %s%04i (%s) has no items checked out\n", patron->leftPID, patron->rightPID, patron->name ); 
+	if( numItems == 0 ){
+		writeOutputString( "Patron " );
+		writePatronDescription( patron );
+		writeOutputString( " has no items checked out\n" );
 	}
 	else{
-		printf( "Patron %s%04i (%s) has these items checked out:\n", patron->leftPID, patron->rightPID, patron->name );
-
-		while( itemsCurrentlyRenting != NULL ){
-			ItemData* i = (ItemData*)((ListNode*)itemsCurrentlyRenting->data)->data;
-
-			if( i != NULL ){
-				printf( "   %d.%d (%s/%s)\n", i->leftCID, i->rightCID, i->author, i->title );
+		writeOutputString( "Patron " );
+		writePatronDescription( patron );
+		writeOutputString( " has these items checked out:\n" );
+
+		for( uint_least8_t i = 0; i < numItems; ++i ){
+			if( items[ i ] != NO_RECORD ){
+				writeOutputString( "   " );
+				writeItemDescription( items[ i ] );
+				writeOutputChar( '\n' );
 			}
-			itemsCurrentlyRenting = itemsCurrentlyRenting->next;
 		}
 	}
 }
@@ -4,24 +4,51 @@
 * This file contains methods which each map to a legal command.
 * These methods in general are specifing how the more generic
 * functions from LinkedDataNodeOperations.h should interpret
-* ListNode*'s void* data.
+* the patron and item records their ListNodes hold.
 *
 *
 * @author Greg Mojonnier
 */
 
 #include "LinkedDataNodeStructures.h"
+#include "Tokenizer.h"
 #include <stdint.h>
 
-void getCopiesAvailable( const char* cid );
-void borrowItem( const char* pid, const char* cid );
-void discardCopiesOfItem( uint_least8_t numToDelete, const char* cid);
-void addItem( uint_least8_t numCopies, const char* cid, const char* author, const char* title );
-void patronsWithItemOut( const char* cid );
-void itemsOutByPatron( const char* pid );
-void returnPatronsItem( const char* pid, const char* cid );
-void addPatron( const char* pid, const char* name );
+// How a command ended, each error has its own message
+typedef enum {
+	COMMAND_SUCCEEDED,
+	// never got past SanitizeInput
+	COMMAND_MALFORMED,
+	COMMAND_NO_SUCH_PATRON,
+	COMMAND_NO_SUCH_ITEM,
+	COMMAND_NO_COPIES_LEFT,
+	COMMAND_TOO_MANY_ITEMS_OUT,
+	COMMAND_ALREADY_CHECKED_OUT,
+	COMMAND_NOT_CHECKED_OUT,
+	COMMAND_TOO_FEW_COPIES,
+	COMMAND_ALREADY_EXISTS,
+	COMMAND_OUT_OF_MEMORY,
+	COMMAND_STATUSES
+} CommandStatus;
+
+// PIDs and CIDs arrive already encoded by SanitizeInput. Callers hold
+// the locks from LibraryLocks.h, the library for adding and discarding,
+// the library shared for queries and the patron and item for borrowing
+// and returning.
+CommandStatus getCopiesAvailable( ItemKey cid );
+CommandStatus borrowItem( PatronKey pid, ItemKey cid );
+CommandStatus discardCopiesOfItem( uint_least8_t numToDelete, ItemKey cid );
+CommandStatus addItem( uint_least8_t numCopies, ItemKey cid, StringView author, StringView title );
+CommandStatus patronsWithItemOut( ItemKey cid );
+CommandStatus itemsOutByPatron( PatronKey pid );
+CommandStatus returnPatronsItem( PatronKey pid, ItemKey cid );
+CommandStatus addPatron( PatronKey pid, StringView name );
+
+// These create a record and index it without linking it into its list,
+// the bulk loader collects them and links them all at once
+ListNode* createItemNode( uint_least8_t numCopies, ItemKey cid, StringView author, StringView title );
+ListNode* createPatronNode( PatronKey pid, StringView name );
 void printAllListsStatus( );
-void printItemStatus( ItemData* item );
-void printPatronStatus( PatronData* patron );
+void printItemStatus( RecordHandle item );
+void printPatronStatus( RecordHandle patron );
 #endif
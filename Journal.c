@@ -0,0 +1,912 @@
+/*
+* This file contains methods which keep a write-ahead journal
+* of every change made to the library. Records are buffered and
+* written in groups, one fsync covers a whole group. Checkpoints
+* are saved by a forked child working on its copy-on-write view
+* of the lists, the journal is compacted once the child is done.
+* Commands on any thread journal through the one lock.
+*
+*
+* @author Greg Mojonnier
+*/
+
+// fsync, ftruncate, fork and friends are POSIX, not part of c99
+#define _POSIX_C_SOURCE 200809L
+
+#include "Journal.h"
+#include "SanitizeInput.h"
+#include "UIDIndex.h"
+#include "OutputWriter.h"
+#include "Snapshot.h"
+#include "LibraryLocks.h"
+#include <allocate.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "AllConstants.h"
+
+// Longest record is an item, its line is under LINE_MAX_SIZE
+#define JOURNAL_RECORD_MAX_SIZE ( 2 * LINE_MAX_SIZE )
+
+// Room for ".generation" and its \0
+#define JOURNAL_GENERATION_MAX_SIZE 24
+
+// Room for what one call can have to report, a few messages
+#define JOURNAL_MESSAGES_SIZE ( 4 * OUTPUT_ERROR_MAX_SIZE )
+
+// Held for everything below, after any of the library's locks
+static pthread_mutex_t s_JournalLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int s_JournalFile = -1;
+static const char* s_JournalPath = NULL;
+static char s_JournalBuffer[ JOURNAL_BUFFER_SIZE ];
+static size_t s_JournalLength = 0;
+
+// Bytes in the journal file, not counting the buffer
+static off_t s_JournalSize = 0;
+
+// Records since the last fsync, written or not
+static uint_least32_t s_NumUncommitted = 0;
+static uint_least32_t s_GroupSize = JOURNAL_DEFAULT_GROUP_SIZE;
+
+// Generation of the snapshot the journal starts from, 0 for none
+static unsigned long s_Generation = 0;
+
+// Child saving the next generation and how much of the journal it covers
+static pid_t s_CheckpointProcess = 0;
+static off_t s_CheckpointOffset = 0;
+
+// Journal size past which pollJournalCheckpoint starts a checkpoint,
+// pushed back after a checkpoint fails so it is not retried every command
+static off_t s_NextCheckpointSize = JOURNAL_CHECKPOINT_SIZE;
+
+// Set in the checkpoint child, whose copy of s_JournalLock stays held
+static _Bool s_IsCheckpointChild = 0;
+
+// Messages noted under s_JournalLock, reported once it is let go
+static char s_JournalMessages[ JOURNAL_MESSAGES_SIZE ];
+static size_t s_JournalMessagesLength = 0;
+
+/*
+* noteJournalMessage
+* ----------------------------------
+*  
+* Formats an error message like printf, to be reported by
+* unlockJournal. Reporting it now could flush the output,
+* which commits the journal and so needs s_JournalLock.
+*
+* @format ------------------> printf format of message, including its \n.
+*
+* @return ------------------> None.
+*
+*/
+static void noteJournalMessage( const char* format, ... ){
+
+	size_t room = sizeof( s_JournalMessages ) - s_JournalMessagesLength;
+	va_list arguments;
+
+	if( room <= 1 ){
+		return;
+	}
+
+	va_start( arguments, format );
+	int length = vsnprintf( s_JournalMessages + s_JournalMessagesLength, room, format, arguments );
+	va_end( arguments );
+
+	if( length > 0 ){
+		s_JournalMessagesLength += ( (size_t)length < room ) ? (size_t)length : room - 1;
+	}
+}
+
+/*
+* unlockJournal
+* ----------------------------------
+*  
+* Lets go of s_JournalLock, then reports every message noted
+* while it was held through writeErrorMessage, so they reach
+* stderr or a client in order with the rest of the output.
+*
+*
+* @return ------------------> None.
+*
+*/
+static void unlockJournal(){
+
+	char messages[ JOURNAL_MESSAGES_SIZE ];
+	size_t length = s_JournalMessagesLength;
+
+	memcpy( messages, s_JournalMessages, length );
+	s_JournalMessagesLength = 0;
+	pthread_mutex_unlock( &s_JournalLock );
+
+	// one at a time, so none is cut short at OUTPUT_ERROR_MAX_SIZE
+	for( size_t start = 0; start < length; ){
+		const char* newLine = memchr( messages + start, '\n', length - start );
+		size_t end = ( newLine == NULL ) ? length : (size_t)( newLine + 1 - messages );
+
+		writeErrorMessage( "%.*s", (int)( end - start ), messages + start );
+		start = end;
+	}
+}
+
+/*
+* stopJournal
+* ----------------------------------
+*  
+* Stops journaling rather than keep a journal with holes.
+*
+* @reason ------------------> Why journaling stopped.
+*
+* @return ------------------> None.
+*
+*/
+static void stopJournal( const char* reason ){
+
+	close( s_JournalFile );
+	s_JournalFile = -1;
+	s_JournalLength = 0;
+	s_NumUncommitted = 0;
+	noteJournalMessage( "%s: %s, journaling stopped, changes from here on will not be recovered\n", s_JournalPath, reason );
+}
+
+/*
+* failJournal
+* ----------------------------------
+*  
+* Stops journaling on a journal that can no
+* longer be written, see stopJournal.
+*
+*
+* @return ------------------> None.
+*
+*/
+static void failJournal(){
+	stopJournal( strerror( errno ) );
+}
+
+/*
+* writeJournalBuffer
+* ----------------------------------
+*  
+* Writes every buffered record to the journal, without an fsync.
+*
+*
+* @return ------------------> None.
+*
+*/
+static void writeJournalBuffer(){
+
+	const char* unwritten = s_JournalBuffer;
+
+	while( s_JournalFile >= 0 && s_JournalLength > 0 ){
+		ssize_t numWritten = write( s_JournalFile, unwritten, s_JournalLength );
+
+		if( numWritten < 0 ){
+			if( errno != EINTR ){
+				failJournal();
+			}
+			continue;
+		}
+		unwritten += numWritten;
+		s_JournalLength -= numWritten;
+		s_JournalSize += numWritten;
+	}
+}
+
+/*
+* commitJournalRecords
+* ----------------------------------
+*  
+* commitJournal for callers already holding s_JournalLock.
+*
+*
+* @return ------------------> None.
+*
+*/
+static void commitJournalRecords(){
+
+	if( s_JournalFile < 0 || s_NumUncommitted == 0 ){
+		return;
+	}
+	writeJournalBuffer();
+	if( s_JournalFile >= 0 && fsync( s_JournalFile ) != 0 ){
+		failJournal();
+	}
+	s_NumUncommitted = 0;
+}
+
+/*
+* appendJournalRecord
+* ----------------------------------
+*  
+* Formats a record like printf and appends it to the journal,
+* committing the group once it holds s_GroupSize records.
+*
+* @format ------------------> printf format of record, including its \n.
+*
+* @return ------------------> None.
+*
+*/
+static void appendJournalRecord( const char* format, ... ){
+
+	char record[ JOURNAL_RECORD_MAX_SIZE ];
+	va_list arguments;
+
+	va_start( arguments, format );
+	int length = vsnprintf( record, sizeof( record ), format, arguments );
+	va_end( arguments );
+
+	if( length < 0 || (size_t)length >= sizeof( record ) ){
+		return;
+	}
+
+	pthread_mutex_lock( &s_JournalLock );
+	if( s_JournalFile >= 0 ){
+		if( s_JournalLength + length > JOURNAL_BUFFER_SIZE ){
+			writeJournalBuffer();
+		}
+		memcpy( s_JournalBuffer + s_JournalLength, record, length );
+		s_JournalLength += length;
+
+		if( ++s_NumUncommitted >= s_GroupSize ){
+			commitJournalRecords();
+		}
+	}
+	unlockJournal();
+}
+
+/*
+* makeCheckpointPath
+* ----------------------------------
+*  
+* Names the snapshot of a checkpoint after its journal and generation.
+*
+* @checkpointPath ----------> Filled in, strlen( journalPath ) + JOURNAL_GENERATION_MAX_SIZE chars.
+* @journalPath -------------> Journal the checkpoint belongs to.
+* @generation --------------> Generation of the checkpoint.
+*
+* @return ------------------> None.
+*
+*/
+static void makeCheckpointPath( char* checkpointPath, const char* journalPath, unsigned long generation ){
+	sprintf( checkpointPath, "%s.%lu", journalPath, generation );
+}
+
+/*
+* replayJournal
+* ----------------------------------
+*  
+* Runs every complete record of the journal through processLine.
+* A record cut short by a crash is cut off the end of the file.
+*
+* @file --------------------> Journal open for reading and writing.
+* @path --------------------> Journal's path, for error messages.
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool replayJournal( int file, const char* path ){
+
+	struct stat fileInfo;
+
+	if( fstat( file, &fileInfo ) != 0 ){
+		writeErrorMessage( "%s: %s\n", path, strerror( errno ) );
+		return 0;
+	}
+	if( fileInfo.st_size == 0 ){
+		return 1;
+	}
+
+	size_t size = fileInfo.st_size;
+	char* contents = (char*) allocate( size );
+	size_t numRead = 0;
+
+	if( contents == NULL ){
+		writeOutputString( "Memory allocation failed!\n" );
+		return 0;
+	}
+
+	while( numRead < size ){
+		ssize_t numReadNow = pread( file, contents + numRead, size - numRead, numRead );
+
+		if( numReadNow <= 0 ){
+			if( numReadNow < 0 && errno == EINTR ){
+				continue;
+			}
+			writeErrorMessage( "%s: %s\n", path, strerror( errno ) );
+			unallocate( contents );
+			return 0;
+		}
+		numRead += numReadNow;
+	}
+
+	const char* line = contents;
+	const char* end = contents + size;
+	const char* newLine;
+
+	// a journal started from a checkpoint names it first
+	if( size > sizeof( JOURNAL_CHECKPOINT_RECORD ) && memcmp( line, JOURNAL_CHECKPOINT_RECORD " ", sizeof( JOURNAL_CHECKPOINT_RECORD ) ) == 0 ){
+		char checkpointPath[ strlen( path ) + JOURNAL_GENERATION_MAX_SIZE ];
+		unsigned long generation = strtoul( line + sizeof( JOURNAL_CHECKPOINT_RECORD ), NULL, 10 );
+
+		makeCheckpointPath( checkpointPath, path, generation );
+		if( generation == 0 || !loadSnapshot( checkpointPath ) ){
+			writeErrorMessage( "%s: cannot load its checkpoint %s\n", path, checkpointPath );
+			unallocate( contents );
+			return 0;
+		}
+		s_Generation = generation;
+		line = memchr( line, '\n', size );
+		line = ( line == NULL ) ? end : line + 1;
+	}
+
+	while( ( newLine = memchr( line, '\n', end - line ) ) != NULL ){
+		processLine( line, newLine + 1 - line );
+		line = newLine + 1;
+	}
+
+	_Bool succeeded = 1;
+
+	if( line != end ){
+		writeErrorMessage( "%s: dropping incomplete record at end of journal\n", path );
+		if( ftruncate( file, line - contents ) != 0 ){
+			writeErrorMessage( "%s: %s\n", path, strerror( errno ) );
+			succeeded = 0;
+		}
+	}
+	unallocate( contents );
+	return succeeded;
+}
+
+/*
+* compactJournal
+* ----------------------------------
+*  
+* Replaces the journal with one that starts from the checkpoint
+* just saved and holds only the records made since it was started.
+* The new journal is written beside the old one and renamed over it,
+* so a crash part way leaves the old journal and checkpoint in place.
+* Once the rename is synced the old journal is gone for good, if that
+* fails journaling stops since either journal may be the one found
+* after a crash.
+*
+* @generation --------------> Generation of the checkpoint just saved.
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool compactJournal( unsigned long generation ){
+
+	writeJournalBuffer();
+	if( s_JournalFile < 0 ){
+		return 0;
+	}
+
+	char tempPath[ strlen( s_JournalPath ) + sizeof( ".tmp" ) ];
+	strcpy( tempPath, s_JournalPath );
+	strcat( tempPath, ".tmp" );
+
+	int file = open( tempPath, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644 );
+
+	if( file < 0 ){
+		noteJournalMessage( "%s: %s\n", tempPath, strerror( errno ) );
+		return 0;
+	}
+
+	// s_JournalBuffer is empty, so it is free to copy the records through
+	int length = sprintf( s_JournalBuffer, JOURNAL_CHECKPOINT_RECORD " %lu\n", generation );
+	_Bool failed = ( write( file, s_JournalBuffer, length ) != length );
+	off_t compactedSize = length;
+
+	for( off_t offset = s_CheckpointOffset; !failed && offset < s_JournalSize; ){
+		size_t numToCopy = ( s_JournalSize - offset < JOURNAL_BUFFER_SIZE ) ? s_JournalSize - offset : JOURNAL_BUFFER_SIZE;
+		ssize_t numRead = pread( s_JournalFile, s_JournalBuffer, numToCopy, offset );
+
+		if( numRead <= 0 || write( file, s_JournalBuffer, numRead ) != numRead ){
+			failed = 1;
+			break;
+		}
+		offset += numRead;
+		compactedSize += numRead;
+	}
+
+	if( failed || fsync( file ) != 0 || rename( tempPath, s_JournalPath ) != 0 ){
+		noteJournalMessage( "%s: %s\n", tempPath, strerror( errno ) );
+		close( file );
+		remove( tempPath );
+		return 0;
+	}
+
+	off_t oldSize = s_JournalSize;
+
+	close( s_JournalFile );
+	s_JournalFile = file;
+	s_JournalSize = compactedSize;
+	s_NumUncommitted = 0;
+
+	if( !syncDirectoryOf( s_JournalPath ) ){
+		failJournal();
+		return 0;
+	}
+	noteJournalMessage( "%s: compacted from %lld to %lld bytes\n", s_JournalPath, (long long)oldSize, (long long)compactedSize );
+	return 1;
+}
+
+/*
+* startGeneration
+* ----------------------------------
+*  
+* Compacts the journal down to the checkpoint of the next generation,
+* which has just been saved, and the records from s_CheckpointOffset on.
+* Whichever checkpoint the journal does
+* not start from afterwards is of no more use and is removed, unless
+* journaling stopped part way and either could still be needed.
+*
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool startGeneration(){
+
+	unsigned long generation = s_Generation + 1;
+	char checkpointPath[ strlen( s_JournalPath ) + JOURNAL_GENERATION_MAX_SIZE ];
+
+	if( !compactJournal( generation ) ){
+		if( s_JournalFile >= 0 ){
+			makeCheckpointPath( checkpointPath, s_JournalPath, generation );
+			remove( checkpointPath );
+		}
+		return 0;
+	}
+
+	unsigned long oldGeneration = s_Generation;
+
+	s_Generation = generation;
+	s_NextCheckpointSize = JOURNAL_CHECKPOINT_SIZE;
+	if( oldGeneration != 0 ){
+		makeCheckpointPath( checkpointPath, s_JournalPath, oldGeneration );
+		remove( checkpointPath );
+	}
+	return 1;
+}
+
+/*
+* finishCheckpoint
+* ----------------------------------
+*  
+* Compacts the journal once the child saving a checkpoint has
+* exited successfully. After a failure the journal is left as is and
+* is not checkpointed again until it grows by another
+* JOURNAL_CHECKPOINT_SIZE, or the checkpoint command asks for one.
+*
+* @status ------------------> Exit status of the checkpoint child, from waitpid.
+*
+* @return ------------------> None.
+*
+*/
+static void finishCheckpoint( int status ){
+
+	s_CheckpointProcess = 0;
+
+	if( !WIFEXITED( status ) || WEXITSTATUS( status ) != EXIT_SUCCESS ){
+		char checkpointPath[ strlen( s_JournalPath ) + JOURNAL_GENERATION_MAX_SIZE ];
+
+		makeCheckpointPath( checkpointPath, s_JournalPath, s_Generation + 1 );
+		remove( checkpointPath );
+		s_NextCheckpointSize = s_JournalSize + (off_t)s_JournalLength + JOURNAL_CHECKPOINT_SIZE;
+		noteJournalMessage( "%s: checkpoint %lu failed, journal left as is\n", s_JournalPath, s_Generation + 1 );
+		return;
+	}
+	if( !startGeneration() ){
+		s_NextCheckpointSize = s_JournalSize + (off_t)s_JournalLength + JOURNAL_CHECKPOINT_SIZE;
+	}
+}
+
+/*
+* waitForCheckpoint
+* ----------------------------------
+*  
+* Waits for the child saving a checkpoint, if there is
+* one, and finishes the checkpoint.
+*
+*
+* @return ------------------> None.
+*
+*/
+static void waitForCheckpoint(){
+
+	if( s_JournalFile >= 0 && s_CheckpointProcess > 0 ){
+		int status;
+
+		while( waitpid( s_CheckpointProcess, &status, 0 ) < 0 && errno == EINTR );
+		finishCheckpoint( status );
+	}
+}
+
+/*
+* openJournal
+* ----------------------------------
+*  
+* Opens the journal, creating it if needed, and replays
+* whatever it already holds on top of the library as loaded
+* so far. Every change from then on is appended to it.
+*
+* @path --------------------> Journal file.
+* @groupSize ---------------> Number of records per fsync, at least 1.
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+_Bool openJournal( const char* path, uint_least32_t groupSize ){
+
+	int file = open( path, O_RDWR | O_CREAT | O_APPEND, 0644 );
+
+	if( file < 0 ){
+		writeErrorMessage( "%s: %s\n", path, strerror( errno ) );
+		return 0;
+	}
+
+	// replayed records must not be journaled again, so the journal opens after
+	if( !replayJournal( file, path ) ){
+		close( file );
+		return 0;
+	}
+
+	s_JournalFile = file;
+	s_JournalPath = path;
+	s_JournalSize = lseek( file, 0, SEEK_END );
+	s_GroupSize = ( groupSize == 0 ) ? 1 : groupSize;
+	return 1;
+}
+
+/*
+* closeJournal
+* ----------------------------------
+*  
+* Commits whatever is left and closes the journal.
+*
+*
+* @return ------------------> None.
+*
+*/
+void closeJournal(){
+
+	pthread_mutex_lock( &s_JournalLock );
+	waitForCheckpoint();
+	commitJournalRecords();
+	if( s_JournalFile >= 0 ){
+		close( s_JournalFile );
+		s_JournalFile = -1;
+	}
+	unlockJournal();
+}
+
+/*
+* commitJournal
+* ----------------------------------
+*  
+* Writes every buffered record and fsyncs the journal,
+* so every change so far survives a crash.
+*
+*
+* @return ------------------> None.
+*
+*/
+void commitJournal(){
+
+	// the child has no journal of its own, and errors it reports commit
+	if( s_IsCheckpointChild ){
+		return;
+	}
+	pthread_mutex_lock( &s_JournalLock );
+	commitJournalRecords();
+	unlockJournal();
+}
+
+/*
+* journalAddPatron
+* ----------------------------------
+*  
+* Journals a patron that has just been added. name is the
+* already truncated one stored in the list, so it replays unchanged.
+*
+* @pid ---------------------> Encoded pid of new patron.
+* @name --------------------> Name of new patron.
+*
+* @return ------------------> None.
+*
+*/
+void journalAddPatron( PatronKey pid, const char* name ){
+	appendJournalRecord( ADD_PATRON_COMMAND " " PID_FORMAT "  \"%s\"\n", PID_FORMAT_ARGS( pid ), name );
+}
+
+/*
+* journalAddItem
+* ----------------------------------
+*  
+* Journals an item that has just been added. author and title are
+* the already truncated ones stored in the list, so they replay unchanged.
+*
+* @numCopies ---------------> Number of copies of new item.
+* @cid ---------------------> Encoded cid of new item.
+* @author ------------------> Author of new item.
+* @title -------------------> Title of new item.
+*
+* @return ------------------> None.
+*
+*/
+void journalAddItem( uint_least8_t numCopies, ItemKey cid, const char* author, const char* title ){
+	appendJournalRecord( ADD_ITEM_COMMAND " %u " CID_FORMAT "  \"%s\"  \"%s\"\n", (unsigned int)numCopies, CID_FORMAT_ARGS( cid ), author, title );
+}
+
+/*
+* journalBorrow
+* ----------------------------------
+*  
+* Journals a loan that has just been made.
+*
+* @pid ---------------------> Encoded pid of borrowing patron.
+* @cid ---------------------> Encoded cid of borrowed item.
+*
+* @return ------------------> None.
+*
+*/
+void journalBorrow( PatronKey pid, ItemKey cid ){
+	appendJournalRecord( BORROW_ITEM_COMMAND " " PID_FORMAT " " CID_FORMAT "\n", PID_FORMAT_ARGS( pid ), CID_FORMAT_ARGS( cid ) );
+}
+
+/*
+* journalReturn
+* ----------------------------------
+*  
+* Journals a loan that has just been returned.
+*
+* @pid ---------------------> Encoded pid of returning patron.
+* @cid ---------------------> Encoded cid of returned item.
+*
+* @return ------------------> None.
+*
+*/
+void journalReturn( PatronKey pid, ItemKey cid ){
+	appendJournalRecord( RETURN_ITEM_COMMAND " " PID_FORMAT " " CID_FORMAT "\n", PID_FORMAT_ARGS( pid ), CID_FORMAT_ARGS( cid ) );
+}
+
+/*
+* journalDiscard
+* ----------------------------------
+*  
+* Journals copies of an item that have just been discarded.
+*
+* @numToDelete -------------> Number of copies discarded.
+* @cid ---------------------> Encoded cid of item.
+*
+* @return ------------------> None.
+*
+*/
+void journalDiscard( uint_least8_t numToDelete, ItemKey cid ){
+	appendJournalRecord( DISCARD_ITEM_COMMAND " %u " CID_FORMAT "\n", (unsigned int)numToDelete, CID_FORMAT_ARGS( cid ) );
+}
+
+/*
+* journalLoad
+* ----------------------------------
+*  
+* Journals a snapshot that has just replaced the library. Rather
+* than name the loaded file, which may be changed or removed later,
+* the library as loaded is saved as the next generation of checkpoint
+* and the journal is compacted down to it, dropping every record
+* before the load. If that cannot be done journaling stops, since
+* the journal could no longer rebuild the library. Callers hold the
+* library exclusively, so no command journals in the meantime.
+*
+*
+* @return ------------------> None.
+*
+*/
+void journalLoad(){
+
+	pthread_mutex_lock( &s_JournalLock );
+
+	// a checkpoint still being saved is of the library before the load
+	waitForCheckpoint();
+	if( s_JournalFile < 0 ){
+		unlockJournal();
+		return;
+	}
+
+	char checkpointPath[ strlen( s_JournalPath ) + JOURNAL_GENERATION_MAX_SIZE ];
+	makeCheckpointPath( checkpointPath, s_JournalPath, s_Generation + 1 );
+	unlockJournal();
+
+	// saving may report errors, which commit the journal, so it is saved unlocked
+	_Bool isSaved = saveSnapshot( checkpointPath );
+
+	pthread_mutex_lock( &s_JournalLock );
+	if( s_JournalFile >= 0 ){
+		s_CheckpointOffset = s_JournalSize + (off_t)s_JournalLength;
+		if( ( !isSaved || !startGeneration() ) && s_JournalFile >= 0 ){
+			stopJournal( "cannot start a new generation from the loaded snapshot" );
+		}
+	}
+	unlockJournal();
+}
+
+/*
+* isJournalFile
+* ----------------------------------
+*  
+* Determines if path is the journal or a checkpoint it depends on,
+* which must not be overwritten by anything but the journal itself.
+*
+* @path --------------------> File to check, need not exist.
+*
+* @return ------------------> _Bool indicating if the journal uses path.
+*
+*/
+_Bool isJournalFile( const char* path ){
+
+	struct stat pathInfo;
+	struct stat fileInfo;
+	_Bool isUsed = 0;
+
+	if( stat( path, &pathInfo ) != 0 ){
+		return 0;
+	}
+
+	pthread_mutex_lock( &s_JournalLock );
+	if( s_JournalFile >= 0 ){
+		char checkpointPath[ strlen( s_JournalPath ) + JOURNAL_GENERATION_MAX_SIZE ];
+
+		isUsed = ( fstat( s_JournalFile, &fileInfo ) == 0 && fileInfo.st_dev == pathInfo.st_dev && fileInfo.st_ino == pathInfo.st_ino );
+
+		// the generation replay loads and the one being saved
+		for( unsigned long generation = s_Generation; !isUsed && generation <= s_Generation + 1; ++generation ){
+			makeCheckpointPath( checkpointPath, s_JournalPath, generation );
+			isUsed = ( generation != 0 && stat( checkpointPath, &fileInfo ) == 0 && fileInfo.st_dev == pathInfo.st_dev && fileInfo.st_ino == pathInfo.st_ino );
+		}
+	}
+	unlockJournal();
+	return isUsed;
+}
+
+/*
+* startCheckpoint
+* ----------------------------------
+*  
+* Commits the journal and forks a child which saves the library,
+* as it stands between two commands, to the next generation of
+* checkpoint. The child only reads its copy-on-write view of the
+* lists, so commands carry on in the parent while it writes. It
+* reports how long the save took and how many bytes it wrote.
+* Callers hold the library exclusively and s_JournalLock, so the
+* child's only thread starts with no command half done, and have
+* checked that a journal is open with no checkpoint running.
+*
+*
+* @return ------------------> _Bool indicating whether a checkpoint was started.
+*
+*/
+static _Bool startCheckpoint(){
+
+	commitJournalRecords();
+	writeJournalBuffer();
+	if( s_JournalFile < 0 ){
+		return 0;
+	}
+
+	pid_t child = fork();
+
+	if( child < 0 ){
+		s_NextCheckpointSize = s_JournalSize + JOURNAL_CHECKPOINT_SIZE;
+		noteJournalMessage( "fork: %s\n", strerror( errno ) );
+		return 0;
+	}
+
+	if( child == 0 ){
+		char checkpointPath[ strlen( s_JournalPath ) + JOURNAL_GENERATION_MAX_SIZE ];
+		struct timespec start, finish;
+		struct stat fileInfo;
+
+		s_IsCheckpointChild = 1;
+		resetOutput();
+		makeCheckpointPath( checkpointPath, s_JournalPath, s_Generation + 1 );
+		clock_gettime( CLOCK_MONOTONIC, &start );
+
+		if( !saveSnapshot( checkpointPath ) || stat( checkpointPath, &fileInfo ) != 0 ){
+			flushOutput();
+			_exit( EXIT_FAILURE );
+		}
+		clock_gettime( CLOCK_MONOTONIC, &finish );
+		writeErrorMessage( "%s: %lld bytes written in %.3f ms\n", checkpointPath, (long long)fileInfo.st_size,
+		                   ( finish.tv_sec - start.tv_sec ) * 1e3 + ( finish.tv_nsec - start.tv_nsec ) / 1e6 );
+		flushOutput();
+
+		// _exit, so nothing stdio buffered for the parent is written twice
+		_exit( EXIT_SUCCESS );
+	}
+
+	s_CheckpointProcess = child;
+	s_CheckpointOffset = s_JournalSize;
+	return 1;
+}
+
+/*
+* checkpointJournal
+* ----------------------------------
+*  
+* Starts a checkpoint, see startCheckpoint, unless there
+* is no journal or a checkpoint is still being saved.
+*
+*
+* @return ------------------> _Bool indicating whether a checkpoint was started.
+*
+*/
+_Bool checkpointJournal(){
+
+	_Bool isStarted = 0;
+
+	lockLibrary();
+	pthread_mutex_lock( &s_JournalLock );
+	if( s_JournalFile < 0 ){
+		noteJournalMessage( "checkpoint needs a journal, start with -j journal_file\n" );
+	}
+	else if( s_CheckpointProcess > 0 ){
+		noteJournalMessage( "%s: checkpoint %lu is still being saved\n", s_JournalPath, s_Generation + 1 );
+	}
+	else{
+		isStarted = startCheckpoint();
+	}
+	unlockJournal();
+	unlockLibrary();
+	return isStarted;
+}
+
+/*
+* pollJournalCheckpoint
+* ----------------------------------
+*  
+* Finishes a checkpoint whose child has exited, without waiting
+* for one that is still running, and starts a new one once the
+* journal has grown past s_NextCheckpointSize.
+*
+*
+* @return ------------------> None.
+*
+*/
+void pollJournalCheckpoint(){
+
+	_Bool isCheckpointDue = 0;
+
+	pthread_mutex_lock( &s_JournalLock );
+	if( s_JournalFile >= 0 && s_CheckpointProcess > 0 ){
+		int status;
+
+		if( waitpid( s_CheckpointProcess, &status, WNOHANG ) == s_CheckpointProcess ){
+			finishCheckpoint( status );
+		}
+	}
+	else if( s_JournalFile >= 0 ){
+		isCheckpointDue = ( s_JournalSize + (off_t)s_JournalLength > s_NextCheckpointSize );
+	}
+	unlockJournal();
+
+	// the library's lock comes first, so the journal's is let go before
+	// taking it and another thread may have started the checkpoint since
+	if( isCheckpointDue ){
+		lockLibrary();
+		pthread_mutex_lock( &s_JournalLock );
+		if( s_JournalFile >= 0 && s_CheckpointProcess == 0 ){
+			startCheckpoint();
+		}
+		unlockJournal();
+		unlockLibrary();
+	}
+}
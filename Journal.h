@@ -0,0 +1,66 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+/*
+* This file contains methods which keep a write-ahead journal
+* of every change made to the library. Each change that succeeds
+* is appended to the journal as the command line that would make
+* it again, so replaying the journal through processLine on top of
+* the same starting files rebuilds the library after a crash.
+* Records are written in groups, one fsync covers a whole group,
+* and the group is cut short whenever output is flushed to stdout
+* or stderr, see OutputWriter.h.
+*
+* A checkpoint saves the library to a snapshot from a forked
+* copy of the process while commands keep running, then cuts
+* the records it covers out of the journal. A compacted journal
+* starts with a JOURNAL_CHECKPOINT_RECORD naming the generation
+* of its snapshot, journal_file.generation, which replay loads
+* before the records that follow. Loading a snapshot starts a new
+* generation at once, so replay never reads a file outside the
+* journal's own, which could have changed since.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "LinkedDataNodeStructures.h"
+#include <stdint.h>
+
+#define JOURNAL_BUFFER_SIZE 65536
+
+// Default number of records written before an fsync
+#define JOURNAL_DEFAULT_GROUP_SIZE 64
+
+// Journals longer than this are checkpointed between commands
+#define JOURNAL_CHECKPOINT_SIZE ( 1 << 24 )
+
+#define JOURNAL_CHECKPOINT_RECORD "checkpoint"
+
+// Replays path then appends to it from then on, groupSize records per fsync
+_Bool openJournal( const char* path, uint_least32_t groupSize );
+void closeJournal( );
+
+// Do nothing unless a journal is open
+void journalAddPatron( PatronKey pid, const char* name );
+void journalAddItem( uint_least8_t numCopies, ItemKey cid, const char* author, const char* title );
+void journalBorrow( PatronKey pid, ItemKey cid );
+void journalReturn( PatronKey pid, ItemKey cid );
+void journalDiscard( uint_least8_t numToDelete, ItemKey cid );
+
+// Callers hold the library exclusively, stops journaling if the
+// loaded library cannot be checkpointed
+void journalLoad( );
+
+// Whether path is the journal or one of its checkpoints, which save must not replace
+_Bool isJournalFile( const char* path );
+
+// Writes and fsyncs every record so far, ending the current group early
+void commitJournal( );
+
+// Starts a checkpoint in the background unless one is already running
+_Bool checkpointJournal( );
+
+// Called between commands, finishes a checkpoint that is done
+// or starts one once the journal has grown too long
+void pollJournalCheckpoint( );
+#endif
@@ -0,0 +1,174 @@
+/*
+* This file contains methods which count latencies into
+* log-linear buckets and read percentiles back out of them.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "LatencyHistogram.h"
+
+/*
+* findLatencyBucket
+* ----------------------------------
+*  
+* Picks the bucket of a latency. Below LATENCY_SUB_BUCKETS
+* every latency has its own bucket, above it the top
+* LATENCY_SUB_BUCKET_BITS + 1 bits pick the bucket.
+*
+* @nanoseconds -------------> Latency to find the bucket of.
+*
+* @return ------------------> Index into a LatencyHistogram's counts.
+*
+*/
+static unsigned int findLatencyBucket( uint_least64_t nanoseconds ){
+
+	if( nanoseconds < LATENCY_SUB_BUCKETS ){
+		return (unsigned int)nanoseconds;
+	}
+
+	unsigned int highestBit = 63 - __builtin_clzll( nanoseconds );
+	if( highestBit >= LATENCY_MAX_BITS ){
+		return LATENCY_HISTOGRAM_BUCKETS - 1;
+	}
+
+	unsigned int shift = highestBit - LATENCY_SUB_BUCKET_BITS;
+	unsigned int subBucket = (unsigned int)( nanoseconds >> shift ) - LATENCY_SUB_BUCKETS;
+	return ( shift + 1 ) * LATENCY_SUB_BUCKETS + subBucket;
+}
+
+/*
+* getBucketHighestLatency
+* ----------------------------------
+*  
+* Undoes findLatencyBucket as closely as it can.
+*
+* @bucket ------------------> Index into a LatencyHistogram's counts.
+*
+* @return ------------------> Highest latency that falls in bucket.
+*
+*/
+static uint_least64_t getBucketHighestLatency( unsigned int bucket ){
+
+	if( bucket < LATENCY_SUB_BUCKETS ){
+		return bucket;
+	}
+
+	unsigned int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+	uint_least64_t lowest = (uint_least64_t)( LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS ) << shift;
+	return lowest + ( (uint_least64_t)1 << shift ) - 1;
+}
+
+/*
+* recordLatency
+* ----------------------------------
+*  
+* Counts one latency. Only one thread may count into a
+* histogram, but others may merge it while it does.
+*
+* @histogram ---------------> Histogram to count it in.
+* @nanoseconds -------------> Latency to count.
+*
+* @return ------------------> None.
+*
+*/
+void recordLatency( LatencyHistogram* histogram, uint_least64_t nanoseconds ){
+
+	uint_least64_t* bucket = &histogram->counts[ findLatencyBucket( nanoseconds ) ];
+
+	// the only writer, so a load and a store add without a locked instruction
+	__atomic_store_n( bucket, __atomic_load_n( bucket, __ATOMIC_RELAXED ) + 1, __ATOMIC_RELAXED );
+	__atomic_store_n( &histogram->count, histogram->count + 1, __ATOMIC_RELAXED );
+	__atomic_store_n( &histogram->total, histogram->total + nanoseconds, __ATOMIC_RELAXED );
+	if( nanoseconds > histogram->max ){
+		__atomic_store_n( &histogram->max, nanoseconds, __ATOMIC_RELAXED );
+	}
+}
+
+/*
+* mergeLatencyHistogram
+* ----------------------------------
+*  
+* Adds every latency counted in from into into. from
+* may be counted into by another thread meanwhile, its
+* latencies counted after the merge starts may be missed.
+*
+* @into --------------------> Histogram to add to.
+* @from --------------------> Histogram to add.
+*
+* @return ------------------> None.
+*
+*/
+void mergeLatencyHistogram( LatencyHistogram* into, const LatencyHistogram* from ){
+
+	uint_least64_t count = 0;
+	for( unsigned int bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; ++bucket ){
+		uint_least64_t bucketCount = __atomic_load_n( &from->counts[ bucket ], __ATOMIC_RELAXED );
+
+		into->counts[ bucket ] += bucketCount;
+		count += bucketCount;
+	}
+
+	// count comes from the buckets so percentiles always find their rank
+	into->count += count;
+	into->total += __atomic_load_n( &from->total, __ATOMIC_RELAXED );
+
+	uint_least64_t max = __atomic_load_n( &from->max, __ATOMIC_RELAXED );
+	if( max > into->max ){
+		into->max = max;
+	}
+}
+
+/*
+* getLatencyPercentile
+* ----------------------------------
+*  
+* Finds the latency that percentile percent of the
+* counted latencies are no longer than.
+*
+* @histogram ---------------> Histogram to read.
+* @percentile --------------> 0 to 100.
+*
+* @return ------------------> That latency in nanoseconds, 0 if nothing was counted.
+*
+*/
+uint_least64_t getLatencyPercentile( const LatencyHistogram* histogram, double percentile ){
+
+	if( histogram->count == 0 ){
+		return 0;
+	}
+
+	// the rank'th shortest latency, counting from 1
+	uint_least64_t rank = (uint_least64_t)( percentile / 100.0 * histogram->count );
+	if( rank < percentile / 100.0 * histogram->count ){
+		++rank;
+	}
+	if( rank == 0 ){
+		rank = 1;
+	}
+
+	uint_least64_t counted = 0;
+	for( unsigned int bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; ++bucket ){
+		counted += histogram->counts[ bucket ];
+		if( counted >= rank ){
+			uint_least64_t latency = getBucketHighestLatency( bucket );
+			return ( latency < histogram->max ) ? latency : histogram->max;
+		}
+	}
+	return histogram->max;
+}
+
+/*
+* getLatencyMean
+* ----------------------------------
+*  
+* Averages every counted latency.
+*
+* @histogram ---------------> Histogram to read.
+*
+* @return ------------------> Mean latency in nanoseconds, 0 if nothing was counted.
+*
+*/
+uint_least64_t getLatencyMean( const LatencyHistogram* histogram ){
+	return ( histogram->count == 0 ) ? 0 : histogram->total / histogram->count;
+}
@@ -0,0 +1,50 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+/*
+* This file contains methods which count latencies into
+* log-linear buckets, the way an HDR histogram does. Every
+* power of 2 is split into LATENCY_SUB_BUCKETS equal buckets, so
+* a latency is known to within about 3% whatever its size and
+* percentiles come out of the counts without keeping samples.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include <stdint.h>
+
+// Buckets per power of 2, as a power of 2 itself
+#define LATENCY_SUB_BUCKET_BITS 5
+#define LATENCY_SUB_BUCKETS ( 1 << LATENCY_SUB_BUCKET_BITS )
+
+// Latencies from 2^LATENCY_MAX_BITS ns, about 18 minutes, up share the last bucket
+#define LATENCY_MAX_BITS 40
+#define LATENCY_HISTOGRAM_BUCKETS ( ( LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS + 1 ) * LATENCY_SUB_BUCKETS )
+
+/*
+* Data Structure: LatencyHistogram
+* ----------------------------------
+*
+* Counts of latencies in nanoseconds, zeroed to start empty.
+*
+* @counts ----------------> Latencies counted in each bucket.
+* @count -----------------> Latencies counted in all.
+* @total -----------------> Sum of every latency, for the mean.
+* @max -------------------> Longest latency, exactly.
+*
+*/
+typedef struct {
+	uint_least64_t counts[ LATENCY_HISTOGRAM_BUCKETS ];
+	uint_least64_t count;
+	uint_least64_t total;
+	uint_least64_t max;
+} LatencyHistogram;
+
+// One thread counts into a histogram, any thread may merge it meanwhile
+void recordLatency( LatencyHistogram* histogram, uint_least64_t nanoseconds );
+void mergeLatencyHistogram( LatencyHistogram* into, const LatencyHistogram* from );
+
+// percentile is 0 to 100, the answer is the highest latency of its bucket
+uint_least64_t getLatencyPercentile( const LatencyHistogram* histogram, double percentile );
+uint_least64_t getLatencyMean( const LatencyHistogram* histogram );
+#endif
@@ -0,0 +1,351 @@
+/*
+* This file contains the locks which let commands run on
+* several threads at once. The library is guarded by one
+* reader/writer lock, patrons and items by stripes of mutexes
+* picked by a hash of their key. Each stripe doubles as a
+* seqlock over the loans of its patrons or items.
+*
+*
+* @author Greg Mojonnier
+*/
+
+// pthread_rwlockattr_setkind_np lets adds and discards get a turn
+#define _GNU_SOURCE
+
+#include "LibraryLocks.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+/*
+* Data Structure: StripeLock
+* ----------------------------------
+*
+* A mutex padded out to its own cache line, so threads
+* locking neighbouring stripes do not slow each other down.
+*
+* @lock ------------------> The mutex.
+* @sequence --------------> Odd while a loan of the stripe is being changed,
+*                           bumped twice by every change.
+*
+*/
+typedef struct {
+	pthread_mutex_t lock;
+	uint_least32_t sequence;
+	char padding[ 64 - sizeof( pthread_mutex_t ) - sizeof( uint_least32_t ) ];
+} StripeLock;
+
+static pthread_rwlock_t s_LibraryLock;
+static pthread_once_t s_LibraryLockOnce = PTHREAD_ONCE_INIT;
+static StripeLock s_PatronStripes[ LIBRARY_LOCK_STRIPES ];
+static StripeLock s_ItemStripes[ LIBRARY_LOCK_STRIPES ];
+
+/*
+* initLibraryLocks
+* ----------------------------------
+*  
+* Creates every lock the first time one is needed. Left to
+* itself a reader/writer lock lets a steady stream of borrows
+* keep an add waiting forever, so writers are preferred.
+*
+*
+* @return ------------------> None.
+*
+*/
+static void initLibraryLocks(){
+
+	pthread_rwlockattr_t attributes;
+
+	pthread_rwlockattr_init( &attributes );
+	pthread_rwlockattr_setkind_np( &attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP );
+	pthread_rwlock_init( &s_LibraryLock, &attributes );
+	pthread_rwlockattr_destroy( &attributes );
+
+	for( int i = 0; i < LIBRARY_LOCK_STRIPES; ++i ){
+		pthread_mutex_init( &s_PatronStripes[ i ].lock, NULL );
+		pthread_mutex_init( &s_ItemStripes[ i ].lock, NULL );
+	}
+}
+
+/*
+* findStripe
+* ----------------------------------
+*  
+* Picks the stripe of a key. Keys are hashed first because
+* neighbouring PIDs and CIDs tend to be used together.
+*
+* @key ---------------------> Encoded PID or CID.
+*
+* @return ------------------> Index of the key's stripe.
+*
+*/
+static unsigned int findStripe( uint_least32_t key ){
+	return (uint32_t)( key * 2654435761u ) % LIBRARY_LOCK_STRIPES;
+}
+
+/*
+* lockLibrary
+* ----------------------------------
+*  
+* Holds the library exclusively, for commands which add
+* or remove records or replace the library outright.
+*
+*
+* @return ------------------> None.
+*
+*/
+void lockLibrary(){
+	pthread_once( &s_LibraryLockOnce, initLibraryLocks );
+	pthread_rwlock_wrlock( &s_LibraryLock );
+}
+
+/*
+* unlockLibrary
+* ----------------------------------
+*  
+* Undoes lockLibrary.
+*
+*
+* @return ------------------> None.
+*
+*/
+void unlockLibrary(){
+	pthread_rwlock_unlock( &s_LibraryLock );
+}
+
+/*
+* lockLibraryShared
+* ----------------------------------
+*  
+* Holds the library shared, so no record is added
+* or removed while it is held.
+*
+*
+* @return ------------------> None.
+*
+*/
+void lockLibraryShared(){
+	pthread_once( &s_LibraryLockOnce, initLibraryLocks );
+	pthread_rwlock_rdlock( &s_LibraryLock );
+}
+
+/*
+* unlockLibraryShared
+* ----------------------------------
+*  
+* Lets go of the library after lockLibraryShared.
+*
+*
+* @return ------------------> None.
+*
+*/
+void unlockLibraryShared(){
+	pthread_rwlock_unlock( &s_LibraryLock );
+}
+
+/*
+* lockPatronAndItem
+* ----------------------------------
+*  
+* Holds the library shared, then the patron's stripe, then
+* the item's, for making or ending a loan between the two.
+*
+* @pid ---------------------> Encoded pid of patron.
+* @cid ---------------------> Encoded cid of item.
+*
+* @return ------------------> None.
+*
+*/
+void lockPatronAndItem( PatronKey pid, ItemKey cid ){
+	lockLibraryShared();
+	pthread_mutex_lock( &s_PatronStripes[ findStripe( pid ) ].lock );
+	pthread_mutex_lock( &s_ItemStripes[ findStripe( cid ) ].lock );
+}
+
+/*
+* unlockPatronAndItem
+* ----------------------------------
+*  
+* Undoes lockPatronAndItem.
+*
+* @pid ---------------------> Encoded pid of patron.
+* @cid ---------------------> Encoded cid of item.
+*
+* @return ------------------> None.
+*
+*/
+void unlockPatronAndItem( PatronKey pid, ItemKey cid ){
+	pthread_mutex_unlock( &s_ItemStripes[ findStripe( cid ) ].lock );
+	pthread_mutex_unlock( &s_PatronStripes[ findStripe( pid ) ].lock );
+	unlockLibraryShared();
+}
+
+/*
+* beginStripeChange
+* ----------------------------------
+*  
+* Makes a stripe's sequence odd. The fence keeps any store
+* made after it from being seen before the odd sequence.
+*
+* @stripe ------------------> Stripe held by the caller.
+*
+* @return ------------------> None.
+*
+*/
+static void beginStripeChange( StripeLock* stripe ){
+	STORE_SHARED( stripe->sequence, LOAD_SHARED( stripe->sequence ) + 1 );
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+/*
+* endStripeChange
+* ----------------------------------
+*  
+* Makes a stripe's sequence even again, after every
+* store made since beginStripeChange.
+*
+* @stripe ------------------> Stripe held by the caller.
+*
+* @return ------------------> None.
+*
+*/
+static void endStripeChange( StripeLock* stripe ){
+	__atomic_store_n( &stripe->sequence, LOAD_SHARED( stripe->sequence ) + 1, __ATOMIC_RELEASE );
+}
+
+/*
+* beginStripeRead
+* ----------------------------------
+*  
+* Waits out any change running on a stripe. Changes only
+* relink a few pointers, so this seldom waits at all.
+*
+* @stripe ------------------> Stripe to read under.
+*
+* @return ------------------> The even sequence the read starts from.
+*
+*/
+static uint_least32_t beginStripeRead( StripeLock* stripe ){
+
+	uint_least32_t sequence;
+	while( ( sequence = __atomic_load_n( &stripe->sequence, __ATOMIC_ACQUIRE ) ) & 1 ){
+		sched_yield();
+	}
+	return sequence;
+}
+
+/*
+* endStripeRead
+* ----------------------------------
+*  
+* Checks that no change ran on a stripe since beginStripeRead.
+* The fence keeps every load before it from being made after
+* the sequence is checked.
+*
+* @stripe ------------------> Stripe read under.
+* @sequence ----------------> What beginStripeRead returned.
+*
+* @return ------------------> 1 if the read was not torn, 0 otherwise.
+*
+*/
+static _Bool endStripeRead( StripeLock* stripe, uint_least32_t sequence ){
+	__atomic_thread_fence( __ATOMIC_ACQUIRE );
+	return LOAD_SHARED( stripe->sequence ) == sequence;
+}
+
+/*
+* beginLoanChange
+* ----------------------------------
+*  
+* Marks the loans of a patron and an item as changing,
+* making queries of either read them again.
+*
+* @pid ---------------------> Encoded pid of patron.
+* @cid ---------------------> Encoded cid of item.
+*
+* @return ------------------> None.
+*
+*/
+void beginLoanChange( PatronKey pid, ItemKey cid ){
+	beginStripeChange( &s_PatronStripes[ findStripe( pid ) ] );
+	beginStripeChange( &s_ItemStripes[ findStripe( cid ) ] );
+}
+
+/*
+* endLoanChange
+* ----------------------------------
+*  
+* Undoes beginLoanChange.
+*
+* @pid ---------------------> Encoded pid of patron.
+* @cid ---------------------> Encoded cid of item.
+*
+* @return ------------------> None.
+*
+*/
+void endLoanChange( PatronKey pid, ItemKey cid ){
+	endStripeChange( &s_ItemStripes[ findStripe( cid ) ] );
+	endStripeChange( &s_PatronStripes[ findStripe( pid ) ] );
+}
+
+/*
+* beginPatronRead
+* ----------------------------------
+*  
+* Starts reading a patron's loans without its stripe.
+*
+* @pid ---------------------> Encoded pid of patron.
+*
+* @return ------------------> Sequence to hand to endPatronRead.
+*
+*/
+uint_least32_t beginPatronRead( PatronKey pid ){
+	return beginStripeRead( &s_PatronStripes[ findStripe( pid ) ] );
+}
+
+/*
+* endPatronRead
+* ----------------------------------
+*  
+* Finishes reading a patron's loans.
+*
+* @pid ---------------------> Encoded pid of patron.
+* @sequence ----------------> What beginPatronRead returned.
+*
+* @return ------------------> 1 if the loans read are whole, 0 to read them again.
+*
+*/
+_Bool endPatronRead( PatronKey pid, uint_least32_t sequence ){
+	return endStripeRead( &s_PatronStripes[ findStripe( pid ) ], sequence );
+}
+
+/*
+* beginItemRead
+* ----------------------------------
+*  
+* Starts reading an item's loans without its stripe.
+*
+* @cid ---------------------> Encoded cid of item.
+*
+* @return ------------------> Sequence to hand to endItemRead.
+*
+*/
+uint_least32_t beginItemRead( ItemKey cid ){
+	return beginStripeRead( &s_ItemStripes[ findStripe( cid ) ] );
+}
+
+/*
+* endItemRead
+* ----------------------------------
+*  
+* Finishes reading an item's loans.
+*
+* @cid ---------------------> Encoded cid of item.
+* @sequence ----------------> What beginItemRead returned.
+*
+* @return ------------------> 1 if the loans read are whole, 0 to read them again.
+*
+*/
+_Bool endItemRead( ItemKey cid, uint_least32_t sequence ){
+	return endStripeRead( &s_ItemStripes[ findStripe( cid ) ], sequence );
+}
@@ -0,0 +1,53 @@
+#ifndef LIBRARY_LOCKS_H
+#define LIBRARY_LOCKS_H
+/*
+* This file contains the locks which let commands run on
+* several threads at once. Commands which add or remove records,
+* or replace the whole library, hold the library exclusively.
+* Every other command holds it shared, along with the stripe
+* lock of each patron and item whose loans it reads or changes,
+* so borrows and returns of unrelated patrons and items never
+* wait on each other.
+*
+* Queries take no stripe lock at all. Each stripe also has a
+* sequence number which borrows and returns make odd while they
+* relink loans, so a query holding only the library shared reads
+* the loans it wants and reads them again if the number moved.
+*
+* Locks are always taken in this order, which rules out deadlock:
+*     library, then patron stripe, then item stripe.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "LinkedDataNodeStructures.h"
+
+// Number of patron stripes and of item stripes, a power of 2
+#define LIBRARY_LOCK_STRIPES 64
+
+void lockLibrary( );
+void unlockLibrary( );
+void lockLibraryShared( );
+void unlockLibraryShared( );
+
+// Also holds the library shared
+void lockPatronAndItem( PatronKey pid, ItemKey cid );
+void unlockPatronAndItem( PatronKey pid, ItemKey cid );
+
+// Called holding both stripes, around any change to their loans
+void beginLoanChange( PatronKey pid, ItemKey cid );
+void endLoanChange( PatronKey pid, ItemKey cid );
+
+// Called holding the library shared, an end returning 0 means
+// the loans read since the begin may be torn and must be read again
+uint_least32_t beginPatronRead( PatronKey pid );
+_Bool endPatronRead( PatronKey pid, uint_least32_t sequence );
+uint_least32_t beginItemRead( ItemKey cid );
+_Bool endItemRead( ItemKey cid, uint_least32_t sequence );
+
+// Every load a query makes of loan fields, and every store to them
+// while queries may be running, so torn reads are never data races
+#define LOAD_SHARED( field ) __atomic_load_n( &(field), __ATOMIC_RELAXED )
+#define STORE_SHARED( field, value ) __atomic_store_n( &(field), (value), __ATOMIC_RELAXED )
+#endif
@@ -1,117 +1,377 @@
 /*
 * This file contains methods that perform operations
-* on linked lists of ListNodes. The ListNodes contain
-* void* data which are either ItemData* or PatronData*.
+* on ordered skip lists of ListNodes. The ListNodes hold the
+* handle of a patron or item record in the RecordStore.
+* It also maintains the LoanRecords shared between them, which
+* queries read without locks, see LibraryLocks.h.
 *
 *
 * @author Greg Mojonnier
 */
 
 #include "LinkedDataNodeOperations.h"
+#include "UIDIndex.h"
+#include "RecordStore.h"
+#include "SlabAllocator.h"
+#include "OutputWriter.h"
+#include "LibraryLocks.h"
 #include <allocate.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "AllConstants.h"
 
-extern ListNode* g_ItemsHead;
-extern ListNode* g_PatronsHead;
+extern OrderedList g_ItemsList;
+extern OrderedList g_PatronsList;
+extern UIDIndex g_PatronsIndex;
+extern UIDIndex g_ItemsIndex;
+
+// The list functions below are only called from the functions
+// DEFINE_ORDERED_LIST_FUNCTIONS stamps out for each kind of list,
+// inlining them there turns every call through hasLowerPrecedence
+// or freeRecordFunction into a direct call that can be inlined too
+#define LIST_FUNCTION static inline __attribute__(( always_inline ))
+
+/*
+* getRandomNodeLevel
+* ----------------------------------
+*  
+* Picks how many levels a new skip list node is linked into.
+* Each extra level is kept with a 1 in 4 chance, so on average
+* a node carries 1.33 next pointers.
+*
+* @return --------------------> Level between 1 and SKIP_LIST_MAX_LEVEL.
+*
+*/
+static uint_least8_t getRandomNodeLevel(){
+
+	// xorshift, quality only needs to be good enough to spread levels
+	static uint_least32_t state = 2463534242u;
+	uint_least8_t level = 1;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	state &= 0xFFFFFFFFu;
+
+	uint_least32_t bits = state;
+	while( level < SKIP_LIST_MAX_LEVEL && ( bits & 3 ) == 0 ){
+		++level;
+		bits >>= 2;
+	}
+	return level;
+}
+
 /*
-* insertNodeInOrder
+* findPrecedingNodes
 * ----------------------------------
 *  
-* Allocates a new ListNode, sets new nodes data to data argument,
-* inserts node into the list in order. Order is determined by the
-* function passed in newDataHasLowerPrecedence. Data with lower precedence
-* goes lower in the list. Items and Patrons have different criteria for ordering.
+* Fills preceding with the last node on each level that record
+* has lower precedence than, NULL meaning the list's head.
+* This is where record belongs(or already sits) in the list.
 *
-* @currentHead ---------------> List to insert node into.
-* @data ----------------------> Data thats put into new node thats inserted into list.
-* @newDataHasLowerPrecedence -> Function pointer to determine data precedence.
+* @list ----------------------> List to search.
+* @record --------------------> Record to find the position of.
+* @preceding -----------------> Array of SKIP_LIST_MAX_LEVEL nodes to fill.
+* @hasLowerPrecedence --------> Precedence function of the list.
 *
 * @return --------------------> None.
 *
 */
-void insertNodeInOrder( ListNode** currentHead, void* data, _Bool(*newDataHasLowerPrecedence)(void* _newData, void* _currentData) ){
+LIST_FUNCTION void findPrecedingNodes( OrderedList* list, RecordHandle record, ListNode** preceding, _Bool(*hasLowerPrecedence)(RecordHandle _newRecord, RecordHandle _currentRecord) ){
 
-	// The address of the outside variable is NULL???
-	// error!
-	if( currentHead == NULL ){
-		return;
+	ListNode* nodeToCheck = NULL;
+
+	for( int_least8_t i = list->level - 1; i >= 0; --i ){
+		ListNode* nextNodeToCheck = ( nodeToCheck == NULL ) ? list->head[ i ] : nodeToCheck->next[ i ];
+
+		while( nextNodeToCheck != NULL && hasLowerPrecedence( record, nextNodeToCheck->record ) ){
+			nodeToCheck = nextNodeToCheck;
+			nextNodeToCheck = nodeToCheck->next[ i ];
+		}
+		preceding[ i ] = nodeToCheck;
 	}
+}
 
-	ListNode* newNode = (ListNode*) allocate( sizeof( ListNode ) ); 
+/*
+* createNode
+* ----------------------------------
+*  
+* Allocates a new ListNode with a random skip list level
+* and sets new nodes record to record argument. The node is
+* not linked into any list yet.
+*
+* @record --------------------> Record thats put into new node.
+*
+* @return --------------------> Pointer to the new node, or NULL.
+*
+*/
+ListNode* createNode( RecordHandle record ){
+
+	uint_least8_t level = getRandomNodeLevel();
+
+	ListNode* newNode = allocateListNode( level ); 
 	if( newNode == NULL ){
-		printf("Memory allocation failed!\n");
+		writeOutputString( "Memory allocation failed!\n" );
+		return NULL;
+	}
+	newNode->record = record;
+	newNode->level = level;
+	return newNode;
+}
+
+/*
+* linkNodeInOrder
+* ----------------------------------
+*  
+* Links a node made by createNode into the list in order. Order is
+* determined by hasLowerPrecedence. Records with lower precedence
+* goes lower in the list. Items and Patrons have different
+* criteria for ordering. The list is a skip list so this takes O(log n) comparisons.
+*
+* @list ----------------------> List to link node into.
+* @newNode -------------------> Node to link into list.
+* @hasLowerPrecedence --------> Precedence function of the list.
+*
+* @return --------------------> None.
+*
+*/
+LIST_FUNCTION void linkNodeInOrder( OrderedList* list, ListNode* newNode, _Bool(*hasLowerPrecedence)(RecordHandle _newRecord, RecordHandle _currentRecord) ){
+
+	if( list == NULL || newNode == NULL ){
 		return;
 	}
-	newNode->data = data;
 
+	ListNode* preceding[ SKIP_LIST_MAX_LEVEL ];
+	findPrecedingNodes( list, newNode->record, preceding, hasLowerPrecedence );
 
-	// empty list
-	if( *currentHead == NULL ){
-		newNode->next = NULL;
-		*currentHead = newNode; 
+	// levels the list did not use yet start right at the head
+	while( list->level < newNode->level ){
+		preceding[ list->level ] = NULL;
+		list->head[ list->level ] = NULL;
+		++list->level;
 	}
-	else{
-		ListNode* nodeToCheck = *currentHead;
-	
 
-		if( !newDataHasLowerPrecedence( data, nodeToCheck->data ) ){
+	for( uint_least8_t i = 0; i < newNode->level; ++i ){
+		if( preceding[ i ] == NULL ){
+			newNode->next[ i ] = list->head[ i ];
+			list->head[ i ] = newNode;
+		}
+		else{
+			newNode->next[ i ] = preceding[ i ]->next[ i ];
+			preceding[ i ]->next[ i ] = newNode;
+		}
+	}
+}
 
-			newNode->next = *currentHead;
-			*currentHead = newNode; 
-			return;
+/*
+* mergeSortedNodes
+* ----------------------------------
+*  
+* Merges two sorted runs of nodes into merged. When neither node
+* has lower precedence the one from first is taken, so the merge is stable.
+*
+* @first ---------------------> First sorted run.
+* @numFirst ------------------> Number of nodes in first.
+* @second --------------------> Second sorted run.
+* @numSecond -----------------> Number of nodes in second.
+* @merged --------------------> Array with room for both runs, must not overlap them.
+* @hasLowerPrecedence --------> Precedence function of the list the nodes belong in.
+*
+* @return --------------------> None.
+*
+*/
+LIST_FUNCTION void mergeSortedNodes( ListNode** first, size_t numFirst, ListNode** second, size_t numSecond, ListNode** merged, _Bool(*hasLowerPrecedence)(RecordHandle _newRecord, RecordHandle _currentRecord) ){
+
+	ListNode** firstEnd = first + numFirst;
+	ListNode** secondEnd = second + numSecond;
+
+	while( first != firstEnd && second != secondEnd ){
+		if( hasLowerPrecedence( (*first)->record, (*second)->record ) ){
+			*merged++ = *second++;
+		}
+		else{
+			*merged++ = *first++;
 		}
+	}
+	while( first != firstEnd ){
+		*merged++ = *first++;
+	}
+	while( second != secondEnd ){
+		*merged++ = *second++;
+	}
+}
 
-		while( nodeToCheck != NULL ){
-			ListNode* nextNodeToCheck = nodeToCheck->next;
+/*
+* sortNodes
+* ----------------------------------
+*  
+* Sorts an array of nodes into list order with a bottom up merge sort.
+*
+* @nodes ---------------------> Array of nodes, sorted in place.
+* @scratch -------------------> Array with room for numNodes nodes used while merging.
+* @numNodes ------------------> Number of nodes in array.
+* @hasLowerPrecedence --------> Precedence function of the list the nodes belong in.
+*
+* @return --------------------> None.
+*
+*/
+LIST_FUNCTION void sortNodes( ListNode** nodes, ListNode** scratch, size_t numNodes, _Bool(*hasLowerPrecedence)(RecordHandle _newRecord, RecordHandle _currentRecord) ){
 
-			if( nextNodeToCheck != NULL ){
-				if( newDataHasLowerPrecedence( data, nextNodeToCheck->data ) ){
-					nodeToCheck = nextNodeToCheck;
-					continue;
-				}
-				else{
-					nodeToCheck->next = newNode;
-					newNode->next = nextNodeToCheck;
-					break;
-				}
+	ListNode** source = nodes;
+	ListNode** destination = scratch;
+
+	for( size_t runLength = 1; runLength < numNodes; runLength *= 2 ){
+		for( size_t runStart = 0; runStart < numNodes; runStart += 2 * runLength ){
+			size_t numFirst = ( numNodes - runStart < runLength ) ? numNodes - runStart : runLength;
+			size_t numSecond = ( numNodes - runStart - numFirst < runLength ) ? numNodes - runStart - numFirst : runLength;
+
+			mergeSortedNodes( source + runStart, numFirst, source + runStart + numFirst, numSecond, destination + runStart, hasLowerPrecedence );
+		}
+		ListNode** swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	if( source != nodes ){
+		memcpy( nodes, source, sizeof( ListNode* ) * numNodes );
+	}
+}
+
+/*
+* linkSortedNodesInOrder
+* ----------------------------------
+*  
+* Links a batch of nodes already sorted into list order.
+* The batch is merged with the nodes already in the list
+* and every level is then relinked in one pass.
+*
+* @list ----------------------> List to link nodes into.
+* @nodes ---------------------> Array of unlinked nodes in list order.
+* @numNodes ------------------> Number of nodes in array.
+* @hasLowerPrecedence --------> Precedence function of the list.
+*
+* @return --------------------> None.
+*
+*/
+LIST_FUNCTION void linkSortedNodesInOrder( OrderedList* list, ListNode** nodes, size_t numNodes, _Bool(*hasLowerPrecedence)(RecordHandle _newRecord, RecordHandle _currentRecord) ){
+
+	if( list == NULL || nodes == NULL || numNodes == 0 ){
+		return;
+	}
+
+	ListNode* tail[ SKIP_LIST_MAX_LEVEL ];
+	memset( tail, 0, sizeof( tail ) );
+
+	ListNode* existingNode = list->head[ 0 ];
+	size_t nodeIndex = 0;
+
+	memset( list->head, 0, sizeof( list->head ) );
+	list->level = 0;
+
+	while( existingNode != NULL || nodeIndex < numNodes ){
+		ListNode* nextNode;
+
+		// take whichever comes first, the rest of the existing list is already in order
+		if( existingNode == NULL || ( nodeIndex < numNodes && hasLowerPrecedence( existingNode->record, nodes[ nodeIndex ]->record ) ) ){
+			nextNode = nodes[ nodeIndex++ ];
+		}
+		else{
+			nextNode = existingNode;
+			existingNode = existingNode->next[ 0 ];
+		}
+
+		for( uint_least8_t i = 0; i < nextNode->level; ++i ){
+			if( tail[ i ] == NULL ){
+				list->head[ i ] = nextNode;
 			}
 			else{
-				nodeToCheck->next = newNode;
-				newNode->next = NULL;
-				break;
+				tail[ i ]->next[ i ] = nextNode;
 			}
+			tail[ i ] = nextNode;
+		}
+		if( nextNode->level > list->level ){
+			list->level = nextNode->level;
 		}
 	}
+
+	for( uint_least8_t i = 0; i < list->level; ++i ){
+		tail[ i ]->next[ i ] = NULL;
+	}
+}
+
+/*
+* linkNodesInOrder
+* ----------------------------------
+*  
+* Links a whole batch of nodes made by createNode into the list.
+* The batch is sorted once and then linked by linkSortedNodesInOrder,
+* so n nodes take O(n log n) comparisons rather than n separate inserts.
+* A batch already in order, like one loaded from a snapshot, is not sorted.
+*
+* @list ----------------------> List to link nodes into.
+* @nodes ---------------------> Array of unlinked nodes, gets sorted in place.
+* @numNodes ------------------> Number of nodes in array.
+* @hasLowerPrecedence --------> Precedence function of the list.
+*
+* @return --------------------> None.
+*
+*/
+LIST_FUNCTION void linkNodesInOrder( OrderedList* list, ListNode** nodes, size_t numNodes, _Bool(*hasLowerPrecedence)(RecordHandle _newRecord, RecordHandle _currentRecord) ){
+
+	if( list == NULL || nodes == NULL || numNodes == 0 ){
+		return;
+	}
+
+	size_t numInOrder = 1;
+	while( numInOrder < numNodes && !hasLowerPrecedence( nodes[ numInOrder - 1 ]->record, nodes[ numInOrder ]->record ) ){
+		++numInOrder;
+	}
+	if( numInOrder == numNodes ){
+		linkSortedNodesInOrder( list, nodes, numNodes, hasLowerPrecedence );
+		return;
+	}
+
+	ListNode** scratch = (ListNode**) allocate( sizeof( ListNode* ) * numNodes );
+	if( scratch == NULL ){
+		// no room to sort, insert them one at a time instead
+		for( size_t i = 0; i < numNodes; ++i ){
+			linkNodeInOrder( list, nodes[ i ], hasLowerPrecedence );
+		}
+		return;
+	}
+
+	sortNodes( nodes, scratch, numNodes, hasLowerPrecedence );
+	unallocate( scratch );
+
+	linkSortedNodesInOrder( list, nodes, numNodes, hasLowerPrecedence );
 }
 
 /*
 * newPatronHasLowerPrecedence
 * ----------------------------------
 *  
-* Determines if _newPatron has lower precedence
-* than _currentPatron. First compares their name
-* if that is equal than their pid is used.
+* Determines if newPatron has lower precedence
+* than currentPatron. First compares their name
+* if that is equal than their pid is used. Names are
+* compared by their OrderKeys first, see compareKeyedStrings.
 *
-* @_newPatron -------------> New patron to check for lower precedence with.
-* @_currentPatron ---------> Current patron to check against.
+* @newPatron --------------> New patron to check for lower precedence with.
+* @currentPatron ----------> Current patron to check against.
 *
 * @return ------------------> _Bool indicating success or failure.
 *
 */
-_Bool newPatronHasLowerPrecedence( void* _newPatron, void* _currentPatron ){
-	PatronData* newPatron = (PatronData*)_newPatron;
-	PatronData* currentPatron = (PatronData*)_currentPatron;
+_Bool newPatronHasLowerPrecedence( RecordHandle newPatron, RecordHandle currentPatron ){
 
-	if( newPatron != NULL && currentPatron != NULL){
-		char namePrecedence = strcmp( newPatron->name, currentPatron->name );
+	if( newPatron != NO_RECORD && currentPatron != NO_RECORD ){
+		int namePrecedence = compareKeyedStrings( g_PatronRecords.nameKeys[ newPatron ], PATRON_NAME( newPatron ), g_PatronRecords.nameKeys[ currentPatron ], PATRON_NAME( currentPatron ) );
 
 
 		if( namePrecedence == 0 ){
-			// do by PID
+			// do by PID, encoded PIDs order the same as letter then digits
 
-			if( newPatron->leftPID[0] > currentPatron->leftPID[0] || ( newPatron->leftPID[0] == currentPatron->leftPID[0] && newPatron->rightPID > currentPatron->rightPID ) ){
+			if( g_PatronRecords.pids[ newPatron ] > g_PatronRecords.pids[ currentPatron ] ){
 				return 1;
 			}
 			else{
@@ -135,31 +395,32 @@ _Bool newPatronHasLowerPrecedence( void* _newPatron, void* _currentPatron ){
 * newItemHasLowerPrecedence
 * ----------------------------------
 *  
-* Determines if _newItem has lower precedence than _currentItem.
+* Determines if newItem has lower precedence than currentItem.
 * First compares author, if they are the same it than tries
-* title. If titles are the same it uses CID.
+* title. If titles are the same it uses CID. Authors are interned
+* so items by the same author are told apart without their chars,
+* and strings are compared by their OrderKeys first.
 *
-* @_newItem ----------------> New item to check for lower precedence with.
-* @_currentItem ------------> Current item to check against.
+* @newItem -----------------> New item to check for lower precedence with.
+* @currentItem -------------> Current item to check against.
 *
 * @return ------------------> _Bool indicating success or failure.
 *
 */
-_Bool newItemHasLowerPrecedence( void* _newItem, void* _currentItem ){
-	ItemData* newItem = (ItemData*)_newItem;
-	ItemData* currentItem = (ItemData*)_currentItem;
+_Bool newItemHasLowerPrecedence( RecordHandle newItem, RecordHandle currentItem ){
 
-	if( newItem != NULL && currentItem != NULL ){
-		char authorPrecedence = strcmp( newItem->author, currentItem->author );
+	if( newItem != NO_RECORD && currentItem != NO_RECORD ){
+		AuthorHandle newAuthor = g_ItemRecords.authors[ newItem ];
+		AuthorHandle currentAuthor = g_ItemRecords.authors[ currentItem ];
+		int authorPrecedence = ( newAuthor == currentAuthor ) ? 0 : compareKeyedStrings( g_Authors.nameKeys[ newAuthor ], AUTHOR_NAME( newAuthor ), g_Authors.nameKeys[ currentAuthor ], AUTHOR_NAME( currentAuthor ) );
 
 		if( authorPrecedence == 0 ){
 			// item title
-			char titlePrecedence = strcmp( newItem->title, currentItem->title );
+			int titlePrecedence = compareKeyedStrings( g_ItemRecords.titleKeys[ newItem ], ITEM_TITLE( newItem ), g_ItemRecords.titleKeys[ currentItem ], ITEM_TITLE( currentItem ) );
 			
 			if( titlePrecedence == 0 ){
-				// cid
-				if( ( newItem->leftCID > currentItem->leftCID || newItem->leftCID == currentItem->leftCID ) 
-										&& newItem->rightCID > currentItem->rightCID ){
+				// cid, encoded CIDs order the same as left half then right half
+				if( g_ItemRecords.cids[ newItem ] > g_ItemRecords.cids[ currentItem ] ){
 					return 1;
 				}
 				else{
@@ -189,272 +450,429 @@ _Bool newItemHasLowerPrecedence( void* _newItem, void* _currentItem ){
 * deleteNode
 * ----------------------------------
 *  
-* Frees the existing specified ListNode, calling freeVoidDataFunction 
-* which properly unallocates its void* data.
+* Unlinks the ListNode holding record from every level of the list
+* and frees it, calling freeRecordFunction which properly removes
+* the record itself.
 *
-* @currentHead -------------> List to delete node from.
-* @nodeToDelete ------------> Node that we want to delete.
-* @freeVoidDataFunction ----> Function pointer which determines how to clean up node's void* data.
+* @list --------------------> List to delete node from.
+* @record ------------------> Record whose node we want to delete.
+* @hasLowerPrecedence ------> Precedence function of the list.
+* @freeRecordFunction ------> Function pointer which determines how to clean up the record.
 *
 * @return ------------------> _Bool indicating success or failure.
 *
 */
-_Bool deleteNode( ListNode** currentHead, ListNode* nodeToDelete, void(*freeVoidDataFunction)(void* data) ){
-	// The address of the outside variable is NULL???
-	// or its an empty list or nodeToDelete is null
-	if( currentHead == NULL || *currentHead == NULL || nodeToDelete == NULL ){
+LIST_FUNCTION _Bool deleteNode( OrderedList* list, RecordHandle record, _Bool(*hasLowerPrecedence)(RecordHandle _newRecord, RecordHandle _currentRecord), void(*freeRecordFunction)(RecordHandle record) ){
+	// empty list or record is missing
+	if( list == NULL || list->head[ 0 ] == NULL || record == NO_RECORD ){
 		return 0;
 	}
-	// special case if head is node to delete
-	if( *currentHead == nodeToDelete ){
- 
-		// take out of list
-		// if only element in list next is null
-		// when outside ptr is dereferenced goes to ptr to next
-		*currentHead = nodeToDelete->next;
-
-		// delete everything related to nodeToDelete
 
-		// if null then void* data is just a pointer to ListNode
-		// so no special freeing is needed
-		if( freeVoidDataFunction != NULL ){
-			(*freeVoidDataFunction)(nodeToDelete->data);
-		}
-		unallocate( nodeToDelete );
+	ListNode* preceding[ SKIP_LIST_MAX_LEVEL ];
+	findPrecedingNodes( list, record, preceding, hasLowerPrecedence );
 
-		return 1;
+	ListNode* nodeToDelete = ( preceding[ 0 ] == NULL ) ? list->head[ 0 ] : preceding[ 0 ]->next[ 0 ];
+	if( nodeToDelete == NULL || nodeToDelete->record != record ){
+		return 0;
 	}
 
-	ListNode* nodeToCheck = *currentHead;
-
-	while( nodeToCheck != NULL ){
-		ListNode* nextNode = nodeToCheck->next;
-
-		if( nextNode == nodeToDelete ){
-			
-			// take nextNode out of list
-			nodeToCheck->next = nextNode->next;
-
-			// if null then void* data is just a pointer
-			// so no special freeing is needed
-			if( freeVoidDataFunction != NULL ){
-				(*freeVoidDataFunction)(nextNode->data);
-			}
-			unallocate( nextNode );
+	for( uint_least8_t i = 0; i < nodeToDelete->level; ++i ){
+		if( preceding[ i ] == NULL ){
+			list->head[ i ] = nodeToDelete->next[ i ];
+		}
+		else{
+			preceding[ i ]->next[ i ] = nodeToDelete->next[ i ];
+		}
+	}
 
+	// drop levels left empty
+	while( list->level > 0 && list->head[ list->level - 1 ] == NULL ){
+		--list->level;
+	}
 
-			return 1;
-		}
-		nodeToCheck = nextNode;
+	// if null then the record is kept
+	if( freeRecordFunction != NULL ){
+		(*freeRecordFunction)( record );
 	}
-	return 0;
+	freeListNode( nodeToDelete );
+
+	return 1;
 }
 
 /*
 * deleteAndFreeBothLists
 * ----------------------------------
 *  
-* Frees the entire list, calling freeVoidDataFunction 
-* for each node which properly unallocates its void* data.
-*
-* @currentHead -------------> List to completely delete.
-* @freeVoidDataFunction ----> Function pointer which determines how to clean up node's void* data.
+* Frees both the patron and item lists along with
+* everything they own and their UID indexes. Every node lives
+* in the slab allocator and every record, loan and string in the
+* record store so they are all released at once rather than
+* node by node.
 *
 * @return ------------------> None.
 *
 */
 void deleteAndFreeBothLists(){
 
-	while( deleteNode( &g_PatronsHead, g_PatronsHead, freePatronDataStruct ) );
-	while( deleteNode( &g_ItemsHead, g_ItemsHead, freeItemDataStruct ) );
+	releaseAllSlabs();
+	releaseRecordStore();
 
-	g_PatronsHead = NULL;	
-	g_ItemsHead = NULL;	
+	memset( g_PatronsList.head, 0, sizeof( g_PatronsList.head ) );
+	g_PatronsList.level = 0;
+	memset( g_ItemsList.head, 0, sizeof( g_ItemsList.head ) );
+	g_ItemsList.level = 0;
+
+	freeUIDIndex( &g_PatronsIndex );
+	freeUIDIndex( &g_ItemsIndex );
 }
 
 
 /*
-* freeItemDataStruct
+* freeItemRecord
 * ----------------------------------
 *  
-* Unallocates a void* data interpreting it as an ItemData*.
+* Ends every loan of an item and removes its record
+* from the record store.
 *
-* @item --------------------> Void* to interpret as ItemData* and unallocate.
+* @item --------------------> Item to remove.
 *
 * @return ------------------> None.
 *
 */
-void freeItemDataStruct( void* item ){
-	ItemData* i = (ItemData*)item;
-	if( i == NULL ){
+void freeItemRecord( RecordHandle item ){
+	if( item == NO_RECORD ){
 		return;
 	}
-	unallocate( i->author );
-	unallocate( i->title );
-	// numCopies gets taken care of when full struct is unallocated
-
-	ListNode* nodeToDelete = i->patronsCurrentlyRenting;
-	while( nodeToDelete != NULL ){
-		ListNode* next = nodeToDelete->next;
 
-		// Get data, its a pointer to a ListNode containing an patron
-		PatronData* patronToCollectFrom = (PatronData*)((ListNode*) nodeToDelete->data)->data;
-		// find listnode with data address of p
-
-		deleteNode( &patronToCollectFrom->itemsCurrentlyRenting, findNodeWithData( patronToCollectFrom->itemsCurrentlyRenting, i ), NULL );
-
-		unallocate( nodeToDelete );
-
-		nodeToDelete = next;
+	// each loan unlinks itself from its patron's list as well
+	while( g_ItemRecords.loans[ item ] != NO_LOAN ){
+		deleteLoan( g_ItemRecords.loans[ item ] );
 	}
-	unallocate( i );
+	removeItemRecord( item );
 }
 
 /*
-* freePatronDataStruct
+* freePatronRecord
 * ----------------------------------
 *  
-* Unallocates a void* data interpreting it as an PatronData*.
+* Ends every loan of a patron and removes its record
+* from the record store.
 *
-* @patron ------------------> Void* to interpret as PatronData* and unallocate.
+* @patron ------------------> Patron to remove.
 *
 * @return ------------------> None.
 *
 */
-void freePatronDataStruct( void* patron ){
-	PatronData* p = (PatronData*)patron; 
-	if( p == NULL ){
+void freePatronRecord( RecordHandle patron ){
+	if( patron == NO_RECORD ){
 		return;
 	}
-	unallocate( p->name );
-	// pid gets taken care of when full struct is unallocated
-	// unallocate the actual nodes of items currently renting
-	// dont worry about the void* data in them because those point to
-	// other item nodes that will take care of themselves
-	
-	ListNode* nodeToDelete = p->itemsCurrentlyRenting;
-	while( nodeToDelete != NULL ){
-		ListNode* next = nodeToDelete->next;
-	
-		// this is a node
-		// it has a void* data which contains an address of a listnode
-		// whom contains a void* data to an item
-	
-		// go to this other listnode and cast its void* data to an item
-		// within this item loop through its patronsCurrentlyrenting LL
-		// find the node containg a void* data with the patrons address
-		// delete this node
-
-
-		// Get data, its a pointer to a ListNode containing an item
-		ItemData* itemToReturn = (ItemData*)((ListNode*)nodeToDelete->data)->data;
-		// find listnode with data address of p
-
-		ListNode* pcr = itemToReturn->patronsCurrentlyRenting;
-
-		deleteNode( &pcr, findNodeWithData( pcr, p ), NULL );
-
-		unallocate( nodeToDelete );
-		nodeToDelete = next;
-	}
-	unallocate( p );
+
+	// each loan unlinks itself from its item's list as well
+	while( g_PatronRecords.loans[ patron ] != NO_LOAN ){
+		deleteLoan( g_PatronRecords.loans[ patron ] );
+	}
+	removePatronRecord( patron );
 }
 
 /*
-* findNodeWithUID
+* DEFINE_ORDERED_LIST_FUNCTIONS
 * ----------------------------------
 *  
-* Finds a node with the matching UID. The UID is
-* matched to nodes void* data with doesDataMatchUID.
+* Stamps out the functions of one kind of list from the LIST_FUNCTIONs
+* above, with kind's precedence and free functions built into them.
+* link##kind##NodeInOrder, sort##kind##Nodes and the rest are declared
+* in LinkedDataNodeOperations.h.
+*
+* @kind ----------------------> Patron or Item, as it appears in the function names.
+* @hasLowerPrecedence --------> Function ordering the kind's records.
+* @freeRecord ----------------> Function removing one of the kind's records.
 *
-* @nodeToCheck -------------> List to find node from.
-* @uid ---------------------> UID to look node up with.
-* @doesDataMatchUID --------> unsigned char indicating if looking up a patron or not.
+*/
+#define DEFINE_ORDERED_LIST_FUNCTIONS( kind, hasLowerPrecedence, freeRecord ) \
+	void link##kind##NodeInOrder( OrderedList* list, ListNode* newNode ){ \
+		linkNodeInOrder( list, newNode, hasLowerPrecedence ); \
+	} \
+	void link##kind##NodesInOrder( OrderedList* list, ListNode** nodes, size_t numNodes ){ \
+		linkNodesInOrder( list, nodes, numNodes, hasLowerPrecedence ); \
+	} \
+	void linkSorted##kind##NodesInOrder( OrderedList* list, ListNode** nodes, size_t numNodes ){ \
+		linkSortedNodesInOrder( list, nodes, numNodes, hasLowerPrecedence ); \
+	} \
+	void mergeSorted##kind##Nodes( ListNode** first, size_t numFirst, ListNode** second, size_t numSecond, ListNode** merged ){ \
+		mergeSortedNodes( first, numFirst, second, numSecond, merged, hasLowerPrecedence ); \
+	} \
+	void sort##kind##Nodes( ListNode** nodes, ListNode** scratch, size_t numNodes ){ \
+		sortNodes( nodes, scratch, numNodes, hasLowerPrecedence ); \
+	} \
+	_Bool delete##kind##Node( OrderedList* list, RecordHandle record ){ \
+		return deleteNode( list, record, hasLowerPrecedence, freeRecord ); \
+	}
+
+DEFINE_ORDERED_LIST_FUNCTIONS( Patron, newPatronHasLowerPrecedence, freePatronRecord )
+DEFINE_ORDERED_LIST_FUNCTIONS( Item, newItemHasLowerPrecedence, freeItemRecord )
+
+/*
+* findItem
+* ----------------------------------
+*  
+* Finds the item with the matching CID
+* through the direct-indexed item table.
+*
+* @cid ---------------------> Encoded CID to look item up with.
 
-* @return ------------------> Pointer to node matching UID, or NULL.
+* @return ------------------> Handle of the item matching CID, or NO_RECORD.
 *
 */
-ListNode* findNodeWithUID( ListNode* nodeToCheck, const char* uid, unsigned char lookingUpPatron ){
-	
-	while( nodeToCheck != NULL && uid != NULL){
-
-		if( lookingUpPatron == 1 ){
-			PatronData* p = (PatronData*)nodeToCheck->data; 
-			if( p == NULL ){
-				return NULL;
-			}
-			unsigned short int rightPID = strtoul( uid+1, NULL, 10 );
+RecordHandle findItem( ItemKey cid ){
+	return findIndexedRecord( &g_ItemsIndex, cid );
+}
 
-			if( *uid == p->leftPID[0] && rightPID == p->rightPID){
-				break;
-			}
-		}
-		else{
+/*
+* findPatron
+* ----------------------------------
+*  
+* Finds the patron with the matching PID
+* through the direct-indexed patron table.
+*
+* @pid ---------------------> Encoded PID to look patron up with.
 
-			ItemData* i = (ItemData*)nodeToCheck->data; 
-			if( i == NULL ){
-				return NULL;
-			}
+* @return ------------------> Handle of the patron matching PID, or NO_RECORD.
+*
+*/
+RecordHandle findPatron( PatronKey pid ){
+	return findIndexedRecord( &g_PatronsIndex, pid );
+}
 
-			char cidBuffer[ CID_MIN_SIZE ];
-			unsigned char periodLocation = strcspn( uid, PERIOD_WORD_SEPARATOR );
-			
-			strncpy( cidBuffer, uid, periodLocation );
-			cidBuffer[ periodLocation ] = '\0';
-			unsigned short int leftCID = strtoul( cidBuffer, NULL, 10 );
+/*
+* createLoan
+* ----------------------------------
+*  
+* Allocates a new LoanRecord for patron borrowing item,
+* links it in order into both the patron's loan list(ordered by item)
+* and the item's loan list(ordered by patron) and counts it on both.
+*
+* @patron ------------------> Patron borrowing the item.
+* @item --------------------> Item being borrowed.
 
-			strcpy( cidBuffer, uid+periodLocation+1 );
-			unsigned short int rightCID = strtoul( cidBuffer, NULL, 10 );
+* @return ------------------> Handle of the new loan, or NO_LOAN.
+*
+*/
+LoanHandle createLoan( RecordHandle patron, RecordHandle item ){
 
-			if( i->leftCID == leftCID && i->rightCID == rightCID ){
-				break;
-			}
-		}
-		nodeToCheck = nodeToCheck->next;
+	if( patron == NO_RECORD || item == NO_RECORD ){
+		return NO_LOAN;
+	}
+
+	LoanHandle loan = allocateLoan();
+	if( loan == NO_LOAN ){
+		writeOutputString( "Memory allocation failed!\n" );
+		return NO_LOAN;
+	}
+	LoanRecord* record = LOAN_RECORD( loan );
+	PatronKey pid = g_PatronRecords.pids[ patron ];
+	ItemKey cid = g_ItemRecords.cids[ item ];
+
+	beginLoanChange( pid, cid );
+	STORE_SHARED( record->patron, patron );
+	STORE_SHARED( record->item, item );
+
+	// link into patron's list after every loan of a lower ordered item
+	LoanHandle prev = NO_LOAN;
+	LoanHandle next = g_PatronRecords.loans[ patron ];
+	while( next != NO_LOAN && newItemHasLowerPrecedence( item, LOAN_RECORD( next )->item ) ){
+		prev = next;
+		next = LOAN_RECORD( next )->nextPatronsLoan;
+	}
+	record->prevPatronsLoan = prev;
+	STORE_SHARED( record->nextPatronsLoan, next );
+	if( prev == NO_LOAN ){
+		STORE_SHARED( g_PatronRecords.loans[ patron ], loan );
+	}
+	else{
+		STORE_SHARED( LOAN_RECORD( prev )->nextPatronsLoan, loan );
+	}
+	if( next != NO_LOAN ){
+		LOAN_RECORD( next )->prevPatronsLoan = loan;
 	}
-	return nodeToCheck;
+
+	// link into item's list after every loan of a lower ordered patron
+	prev = NO_LOAN;
+	next = g_ItemRecords.loans[ item ];
+	while( next != NO_LOAN && newPatronHasLowerPrecedence( patron, LOAN_RECORD( next )->patron ) ){
+		prev = next;
+		next = LOAN_RECORD( next )->nextItemsLoan;
+	}
+	record->prevItemsLoan = prev;
+	STORE_SHARED( record->nextItemsLoan, next );
+	if( prev == NO_LOAN ){
+		STORE_SHARED( g_ItemRecords.loans[ item ], loan );
+	}
+	else{
+		STORE_SHARED( LOAN_RECORD( prev )->nextItemsLoan, loan );
+	}
+	if( next != NO_LOAN ){
+		LOAN_RECORD( next )->prevItemsLoan = loan;
+	}
+
+	++g_PatronRecords.numItemsOut[ patron ];
+	STORE_SHARED( g_ItemRecords.numCopiesOut[ item ], g_ItemRecords.numCopiesOut[ item ] + 1 );
+	endLoanChange( pid, cid );
+	return loan;
 }
 
 /*
-* findNodeWithData
+* findPatronsLoan
 * ----------------------------------
 *  
-* Finds a node with its void* data the exact same
-* as the supplied void* data argument.
+* Finds the loan of item in patron's loan list.
+* A patron holds at most 5 loans so this is a short walk.
 *
-* @nodeToCheck -------------> List to find node from.
-* @data --------------------> Data to match node with.
+* @patron ------------------> Patron whose loans are checked.
+* @item --------------------> Item to match loan with.
 
-* @return ------------------> Pointer to node matching data, or NULL.
+* @return ------------------> Handle of the matching loan, or NO_LOAN.
 *
 */
-ListNode* findNodeWithData( ListNode* nodeToCheck, void* data ){
+LoanHandle findPatronsLoan( RecordHandle patron, RecordHandle item ){
 
-	while( nodeToCheck != NULL && nodeToCheck->data != data ){
-		nodeToCheck = nodeToCheck->next;
+	if( patron == NO_RECORD ){
+		return NO_LOAN;
 	}
-	return nodeToCheck;
+
+	LoanHandle loan = g_PatronRecords.loans[ patron ];
+	while( loan != NO_LOAN && LOAN_RECORD( loan )->item != item ){
+		loan = LOAN_RECORD( loan )->nextPatronsLoan;
+	}
+	return loan;
 }
 
 /*
-* getListSize
+* deleteLoan
 * ----------------------------------
 *  
-* Finds the length of the given list.
+* Unlinks loan from both its patron's and its item's
+* loan lists, uncounts it on both and frees it.
 *
-* @currentNode -------------> List to determine size of.
+* @loan --------------------> Loan to delete.
 
-* @return ------------------> int indicating a list's size.
+* @return ------------------> None.
 *
 */
-uint_least8_t getListSize( ListNode* currentNode ){
+void deleteLoan( LoanHandle loan ){
+
+	if( loan == NO_LOAN ){
+		return;
+	}
 
-	uint_least8_t size = 0;
+	LoanRecord* record = LOAN_RECORD( loan );
+	RecordHandle patron = record->patron;
+	RecordHandle item = record->item;
+	PatronKey pid = g_PatronRecords.pids[ patron ];
+	ItemKey cid = g_ItemRecords.cids[ item ];
+	beginLoanChange( pid, cid );
 
-	while( currentNode != NULL ){
-		++size;
-		currentNode = currentNode->next;
+	if( record->prevPatronsLoan == NO_LOAN ){
+		STORE_SHARED( g_PatronRecords.loans[ patron ], record->nextPatronsLoan );
+	}
+	else{
+		STORE_SHARED( LOAN_RECORD( record->prevPatronsLoan )->nextPatronsLoan, record->nextPatronsLoan );
+	}
+	if( record->nextPatronsLoan != NO_LOAN ){
+		LOAN_RECORD( record->nextPatronsLoan )->prevPatronsLoan = record->prevPatronsLoan;
 	}
-	return size;
+
+	if( record->prevItemsLoan == NO_LOAN ){
+		STORE_SHARED( g_ItemRecords.loans[ item ], record->nextItemsLoan );
+	}
+	else{
+		STORE_SHARED( LOAN_RECORD( record->prevItemsLoan )->nextItemsLoan, record->nextItemsLoan );
+	}
+	if( record->nextItemsLoan != NO_LOAN ){
+		LOAN_RECORD( record->nextItemsLoan )->prevItemsLoan = record->prevItemsLoan;
+	}
+
+	--g_PatronRecords.numItemsOut[ patron ];
+	STORE_SHARED( g_ItemRecords.numCopiesOut[ item ], g_ItemRecords.numCopiesOut[ item ] - 1 );
+	endLoanChange( pid, cid );
+	freeLoan( loan );
 }
 
+/*
+* readPatronsOfItem
+* ----------------------------------
+*  
+* Copies out the patron of each of item's loans, in order,
+* without the item's stripe. Borrows and returns may relink
+* the loans mid walk, or even free one that is being looked at,
+* so nothing read is used until the walk is known to be whole.
+* Loan chunks never move or go away while the library is held
+* shared, which keeps a stale handle naming some LoanRecord.
+*
+* @item --------------------> Item whose loans are read.
+* @patrons -----------------> Filled with up to ITEM_MAX_COPIES patrons.
+
+* @return ------------------> Number of patrons copied out.
+*
+*/
+uint_least8_t readPatronsOfItem( RecordHandle item, RecordHandle* patrons ){
+
+	ItemKey cid = g_ItemRecords.cids[ item ];
+	uint_least32_t sequence;
+	uint_least8_t numPatrons;
+
+	do{
+		sequence = beginItemRead( cid );
+		numPatrons = 0;
+
+		// a torn walk can run in a circle, so stop where a whole one must have
+		LoanHandle loan = LOAD_SHARED( g_ItemRecords.loans[ item ] );
+		while( loan != NO_LOAN && numPatrons < ITEM_MAX_COPIES ){
+			const LoanRecord* record = readLoanRecord( loan );
+			if( record == NULL ){
+				break;
+			}
+			patrons[ numPatrons++ ] = LOAD_SHARED( record->patron );
+			loan = LOAD_SHARED( record->nextItemsLoan );
+		}
+	} while( !endItemRead( cid, sequence ) );
+
+	return numPatrons;
+}
+
+/*
+* readItemsOfPatron
+* ----------------------------------
+*  
+* Copies out the item of each of patron's loans, in order,
+* without the patron's stripe. Works as readPatronsOfItem does.
+*
+* @patron ------------------> Patron whose loans are read.
+* @items -------------------> Filled with up to PATRON_MAX_ITEMS_OUT items.
+
+* @return ------------------> Number of items copied out.
+*
+*/
+uint_least8_t readItemsOfPatron( RecordHandle patron, RecordHandle* items ){
+
+	PatronKey pid = g_PatronRecords.pids[ patron ];
+	uint_least32_t sequence;
+	uint_least8_t numItems;
+
+	do{
+		sequence = beginPatronRead( pid );
+		numItems = 0;
+
+		LoanHandle loan = LOAD_SHARED( g_PatronRecords.loans[ patron ] );
+		while( loan != NO_LOAN && numItems < PATRON_MAX_ITEMS_OUT ){
+			const LoanRecord* record = readLoanRecord( loan );
+			if( record == NULL ){
+				break;
+			}
+			items[ numItems++ ] = LOAD_SHARED( record->item );
+			loan = LOAD_SHARED( record->nextPatronsLoan );
+		}
+	} while( !endPatronRead( pid, sequence ) );
+
+	return numItems;
+}
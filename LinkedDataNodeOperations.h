@@ -2,43 +2,66 @@
 #define LINKED_DATA_NODE_OPERATIONS_H
 /*
 * This file contains methods that perform operations
-* on linked lists of ListNodes. The ListNodes contain
-* void* data which are either ItemData* or PatronData* or ListNode*.
+* on ordered skip lists of ListNodes. The ListNodes hold the
+* handle of a patron or item record in the RecordStore.
+* It also maintains the LoanRecords shared between them.
 *
 *
 * @author Greg Mojonnier
 */
 
 #include "LinkedDataNodeStructures.h"
+#include <stddef.h>
 #include <stdint.h>
 
 
-// Function to create and insert a ListNode into specified list
-void insertNodeInOrder( ListNode** currentHead, void* data, _Bool(*newDataHasLowerPrecedence)(void* _newData, void* _currentData) );
+// Each kind of list has its own copy of the functions below, made by
+// DEFINE_ORDERED_LIST_FUNCTIONS, with its precedence and free functions
+// built in rather than called through pointers
 
-// These are passed into insertNodeInOrder, they determine
+// Functions to create a ListNode and link it, or a whole batch of them, into specified list
+ListNode* createNode( RecordHandle record );
+void linkPatronNodeInOrder( OrderedList* list, ListNode* newNode );
+void linkItemNodeInOrder( OrderedList* list, ListNode* newNode );
+void linkPatronNodesInOrder( OrderedList* list, ListNode** nodes, size_t numNodes );
+void linkItemNodesInOrder( OrderedList* list, ListNode** nodes, size_t numNodes );
+void linkSortedPatronNodesInOrder( OrderedList* list, ListNode** nodes, size_t numNodes );
+void linkSortedItemNodesInOrder( OrderedList* list, ListNode** nodes, size_t numNodes );
+
+// Functions to put a batch of nodes into list order before linking it
+void mergeSortedPatronNodes( ListNode** first, size_t numFirst, ListNode** second, size_t numSecond, ListNode** merged );
+void mergeSortedItemNodes( ListNode** first, size_t numFirst, ListNode** second, size_t numSecond, ListNode** merged );
+void sortPatronNodes( ListNode** nodes, ListNode** scratch, size_t numNodes );
+void sortItemNodes( ListNode** nodes, ListNode** scratch, size_t numNodes );
+
+// These order the patron and item lists, they determine
 // if the new Patron/Item has a lower precedence than current
-_Bool newPatronHasLowerPrecedence( void* _newPatron, void* _currentPatron );
-_Bool newItemHasLowerPrecedence( void* _newItem, void* _currentItem );
+_Bool newPatronHasLowerPrecedence( RecordHandle newPatron, RecordHandle currentPatron );
+_Bool newItemHasLowerPrecedence( RecordHandle newItem, RecordHandle currentItem );
 
-// Functions to delete node from list of ListNodes
-_Bool deleteNode( ListNode** currentHead, ListNode* nodeToDelete, void(*freeVoidDataFunction)(void* data) );
+// Functions to delete the node holding a record from list of ListNodes,
+// removing the record along with it
+_Bool deletePatronNode( OrderedList* list, RecordHandle patron );
+_Bool deleteItemNode( OrderedList* list, RecordHandle item );
 void deleteAndFreeBothLists( );
 
-// These are passed into delete node functions as function pointers
-// to insure proper clean up based on what the nodes void* data represents
-void freeItemDataStruct( void* item );
-void freePatronDataStruct( void* patron );
+// These are built into the delete node functions to insure
+// proper clean up based on what the node's record represents
+void freeItemRecord( RecordHandle item );
+void freePatronRecord( RecordHandle patron );
 
-// Functions to find a specific node based on a UID from list of ListNodes
-ListNode* findNodeWithUID( ListNode* nodeToCheck, const char* uid, unsigned char lookingUpPatron );
+// Functions to find a specific record based on a UID
+RecordHandle findItem( ItemKey cid );
+RecordHandle findPatron( PatronKey pid );
 
-// Function to find a specific node whose void* data == to the void* data argument
-// This is used for ItemData and PatronData's sublists (patronsCurrentlyRenting, itemsCurrentlyRenting)
-// which use their void* data strictly as a pointer
-ListNode* findNodeWithData( ListNode* nodeToCheck, void* data );
+// Functions to create, find and delete the loans linking a patron and an item
+LoanHandle createLoan( RecordHandle patron, RecordHandle item );
+LoanHandle findPatronsLoan( RecordHandle patron, RecordHandle item );
+void deleteLoan( LoanHandle loan );
 
-// General utility LL function
-uint_least8_t getListSize( ListNode* currentNode );
+// Copy out the other side of every loan, in order, holding only the library
+// shared, patrons needs room for ITEM_MAX_COPIES and items for PATRON_MAX_ITEMS_OUT
+uint_least8_t readPatronsOfItem( RecordHandle item, RecordHandle* patrons );
+uint_least8_t readItemsOfPatron( RecordHandle patron, RecordHandle* items );
 
 #endif
@@ -8,62 +8,163 @@
 * @author Greg Mojonnier
 */
 
+#include <stdint.h>
+
+// Encoded UIDs, these are produced once when a command is parsed
+// PatronKey is 0 to PID_KEY_COUNT-1, ItemKey is 0 to CID_KEY_COUNT-1
+typedef uint_least32_t PatronKey;
+typedef uint_least32_t ItemKey;
+
+// Most copies of one item, the widest numCopies holds
+#define ITEM_MAX_COPIES 127
+
+// Records and loans are named by their index in their table's
+// columns rather than by pointer, the NO_ handles name nothing
+typedef uint_least32_t RecordHandle;
+typedef uint_least32_t LoanHandle;
+#define NO_RECORD ( (RecordHandle)0xFFFFFFFF )
+#define NO_LOAN ( (LoanHandle)0xFFFFFFFF )
+
+// Authors are interned, every item by the same author shares one
+typedef uint_least32_t AuthorHandle;
+#define NO_AUTHOR ( (AuthorHandle)0xFFFFFFFF )
+
+// Offset of a \0 terminated string within the StringHeap
+typedef uint_least32_t StringOffset;
+#define NO_STRING ( (StringOffset)0xFFFFFFFF )
+
+// First ORDER_KEY_SIZE chars of a string packed big-endian, 0 past
+// its end, so comparing two keys orders them as strcmp would unless
+// they are equal
+typedef uint_least64_t OrderKey;
+#define ORDER_KEY_SIZE 8
+
+// Highest level a skip list node can reach, each level
+// holds about a quarter of the nodes of the level below
+#define SKIP_LIST_MAX_LEVEL 16
+
 /*
 * Data Structure: ListNode
 * ----------------------------------
 *
-* Represents a generic list node for linked lists.
+* Represents a skip list node. Level 0 is the ordinary
+* in order linked list, higher levels skip ahead over it.
+* Nodes are allocated with room for exactly level next pointers.
 *
-* @data ------------------> Generic data, most likely PatronData or ItemData struct.
-* @next ------------------> Next linked list node.
+* @record ----------------> Handle of the patron or item record this node orders.
+* @level -----------------> Number of levels this node is linked into.
+* @next ------------------> Next node at each level, next[ 0 ] is the next node in order.
 *
 */
 typedef struct _ListNode {
-	void* data;
-	struct _ListNode* next;
+	RecordHandle record;
+	uint_least8_t level;
+	struct _ListNode* next[];
 } ListNode;
 
 /*
-* ItemData
+* Data Structure: OrderedList
+* ----------------------------------
+*
+* Skip list of ListNodes kept in order. Which order is up to the
+* functions it is used with, linkPatronNodeInOrder and the rest
+* keep patron order and linkItemNodeInOrder and the rest item order.
+* Records with lower precedence go lower in the list.
+*
+* @head ------------------> First node at each level, head[ 0 ] is the first node in order.
+* @level -----------------> Number of levels currently in use.
+*
+*/
+typedef struct {
+	ListNode* head[ SKIP_LIST_MAX_LEVEL ];
+	uint_least8_t level;
+} OrderedList;
+
+/*
+* Data Structure: PatronTable
 * ----------------------------------
-*  
-* Represents a library item.
 *
-* @author ------------------> Item's author.
-* @title -------------------> Item's title.
-* @leftCID -----------------> Item's left half of catalog ID(3 digits).
-* @rightCID ----------------> Item's right half of catalog ID(3 digits).
-* @numCopies ---------------> Number of copies library owns.
-* @patronsCurrentlyRenting -> Linked list of void* to patrons renting item.
+* Every library patron, one column per field, all indexed
+* by the patron's RecordHandle. Columns hold room for capacity
+* records and only move when they grow, with the library held
+* exclusively.
+*
+* @pids ------------------> Patron's encoded ID.
+* @names -----------------> Patron's name, NO_STRING once the handle is free.
+* @nameKeys --------------> OrderKey of the patron's name.
+* @numItemsOut -----------> Number of items checked out, at most PATRON_MAX_ITEMS_OUT.
+* @loans -----------------> First of the patron's loans, ordered by item. Free handles chain through it.
+* @numRecords ------------> Handles handed out so far, freed or not.
+* @capacity --------------> Handles the columns have room for.
+* @freeRecords -----------> Most recently freed handle, NO_RECORD for none.
 *
 */
 typedef struct {
-	char* author;
-	char* title;
-	unsigned int leftCID:10;
-	unsigned int rightCID:10;
-	// allows 0-127
-	unsigned int numCopies:7;
-	ListNode* patronsCurrentlyRenting;
-} ItemData;
+	PatronKey* pids;
+	StringOffset* names;
+	OrderKey* nameKeys;
+	uint_least8_t* numItemsOut;
+	LoanHandle* loans;
+	uint_least32_t numRecords;
+	uint_least32_t capacity;
+	RecordHandle freeRecords;
+} PatronTable;
 
 /*
-* PatronData
+* Data Structure: ItemTable
 * ----------------------------------
 *
-* Represents a library patron.
+* Every library item, one column per field, laid out
+* as PatronTable is.
 *
-* @name ------------------> Patron's name.
-* @leftPID ---------------> Patron's left half of ID(1 char).
-* @rightPID---------------> Patron's right half of ID(4 digits).
-* @itemsCurrentlyRenting -> Linked list of void* to items curently renting.
+* @cids ------------------> Item's encoded catalog ID, left half in the high 10 bits.
+* @authors ---------------> Item's interned author.
+* @titles ----------------> Item's title, NO_STRING once the handle is free.
+* @titleKeys -------------> OrderKey of the item's title.
+* @numCopies -------------> Number of copies library owns, at most ITEM_MAX_COPIES.
+* @numCopiesOut ----------> Number of copies checked out, never more than numCopies.
+* @loans -----------------> First of the item's loans, ordered by patron. Free handles chain through it.
+* @numRecords ------------> Handles handed out so far, freed or not.
+* @capacity --------------> Handles the columns have room for.
+* @freeRecords -----------> Most recently freed handle, NO_RECORD for none.
 *
 */
 typedef struct {
-	char* name;
-	char leftPID[2];
-	unsigned int rightPID:14;
-	ListNode* itemsCurrentlyRenting;
-} PatronData;
+	ItemKey* cids;
+	AuthorHandle* authors;
+	StringOffset* titles;
+	OrderKey* titleKeys;
+	uint_least8_t* numCopies;
+	uint_least8_t* numCopiesOut;
+	LoanHandle* loans;
+	uint_least32_t numRecords;
+	uint_least32_t capacity;
+	RecordHandle freeRecords;
+} ItemTable;
+
+/*
+* LoanRecord
+* ----------------------------------
+*
+* Represents one item checked out by one patron. The same
+* record is linked into both the patron's and the item's
+* loan lists so it can be unlinked from either side directly.
+*
+* @patron ----------------> Patron who has the item out.
+* @item ------------------> Item the patron has out.
+* @prevPatronsLoan -------> Previous loan in patron's loans.
+* @nextPatronsLoan -------> Next loan in patron's loans.
+* @prevItemsLoan ---------> Previous loan in item's loans.
+* @nextItemsLoan ---------> Next loan in item's loans.
+*
+*/
+typedef struct _LoanRecord {
+	RecordHandle patron;
+	RecordHandle item;
+	LoanHandle prevPatronsLoan;
+	LoanHandle nextPatronsLoan;
+	LoanHandle prevItemsLoan;
+	LoanHandle nextItemsLoan;
+} LoanRecord;
 
 #endif
@@ -0,0 +1,339 @@
+/*
+* This file contains methods which write the program's
+* normal output. Output is gathered in one large buffer and
+* handed to the operating system with a single write each time
+* the buffer fills or is flushed, to stdout or to an OutputSink.
+* Each thread has its own buffer and sink. Error messages headed
+* for stderr are buffered beside the output and flushed along with
+* it, and the journal is committed before either is written, so no
+* output a user sees can be of a change that a crash would lose
+* while changes are still fsynced a group at a time.
+*
+*
+* @author Greg Mojonnier
+*/
+
+// write and isatty are POSIX, not part of c99
+#define _POSIX_C_SOURCE 200809L
+
+#include "OutputWriter.h"
+#include "UIDIndex.h"
+#include "Journal.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// every thread running commands gathers its own output
+static _Thread_local char s_OutputBuffer[ OUTPUT_BUFFER_SIZE ];
+static _Thread_local size_t s_OutputLength = 0;
+
+// error messages waiting for the output to be flushed to stdout
+static _Thread_local char s_ErrorBuffer[ OUTPUT_BUFFER_SIZE ];
+static _Thread_local size_t s_ErrorLength = 0;
+
+// NULL while output goes to stdout
+static _Thread_local const OutputSink* s_OutputSink = NULL;
+
+// -1 until isOutputInteractive first checks stdout and stderr
+static int s_OutputIsInteractive = -1;
+
+/*
+* writeOutputChars
+* ----------------------------------
+*  
+* Appends chars to the output buffer, flushing
+* whenever the buffer fills.
+*
+* @chars -------------------> Chars to write, need not be \0 terminated.
+* @length ------------------> Number of chars to write.
+*
+* @return ------------------> None.
+*
+*/
+void writeOutputChars( const char* chars, size_t length ){
+
+	while( length > 0 ){
+		if( s_OutputLength == OUTPUT_BUFFER_SIZE ){
+			flushOutput();
+		}
+
+		size_t roomLeft = OUTPUT_BUFFER_SIZE - s_OutputLength;
+		size_t numToCopy = ( length < roomLeft ) ? length : roomLeft;
+
+		memcpy( s_OutputBuffer + s_OutputLength, chars, numToCopy );
+		s_OutputLength += numToCopy;
+		chars += numToCopy;
+		length -= numToCopy;
+	}
+}
+
+/*
+* writeOutputString
+* ----------------------------------
+*  
+* Appends a \0 terminated string to the output buffer.
+*
+* @string ------------------> String to write.
+*
+* @return ------------------> None.
+*
+*/
+void writeOutputString( const char* string ){
+	writeOutputChars( string, strlen( string ) );
+}
+
+/*
+* writeOutputChar
+* ----------------------------------
+*  
+* Appends a single char to the output buffer.
+*
+* @ch ----------------------> Char to write.
+*
+* @return ------------------> None.
+*
+*/
+void writeOutputChar( char ch ){
+
+	if( s_OutputLength == OUTPUT_BUFFER_SIZE ){
+		flushOutput();
+	}
+	s_OutputBuffer[ s_OutputLength++ ] = ch;
+}
+
+/*
+* writeOutputInt
+* ----------------------------------
+*  
+* Appends a number in decimal, as printf's %i would.
+*
+* @number ------------------> Number to write.
+*
+* @return ------------------> None.
+*
+*/
+void writeOutputInt( int number ){
+
+	// enough digits for any int plus its sign
+	char digits[ 3 * sizeof( int ) + 1 ];
+	char* digitsIt = digits + sizeof( digits );
+	unsigned int magnitude = ( number < 0 ) ? -(unsigned int)number : (unsigned int)number;
+
+	do{
+		*--digitsIt = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while( magnitude != 0 );
+
+	if( number < 0 ){
+		*--digitsIt = '-';
+	}
+	writeOutputChars( digitsIt, digits + sizeof( digits ) - digitsIt );
+}
+
+/*
+* writeOutputPID
+* ----------------------------------
+*  
+* Appends an encoded PID as its letter followed by
+* its 4 zero padded digits, as PID_FORMAT would.
+*
+* @pid ---------------------> Encoded PID to write.
+*
+* @return ------------------> None.
+*
+*/
+void writeOutputPID( PatronKey pid ){
+
+	char fullPID[ PID_MAX_SIZE - 1 ];
+	unsigned int number = PID_KEY_NUMBER( pid );
+
+	fullPID[ 0 ] = PID_KEY_LETTER( pid );
+	for( uint_least8_t i = PID_MAX_SIZE - 2; i > 0; --i ){
+		fullPID[ i ] = '0' + number % 10;
+		number /= 10;
+	}
+	writeOutputChars( fullPID, sizeof( fullPID ) );
+}
+
+/*
+* writeOutputCID
+* ----------------------------------
+*  
+* Appends an encoded CID as its two halves
+* separated by a period, as CID_FORMAT would.
+*
+* @cid ---------------------> Encoded CID to write.
+*
+* @return ------------------> None.
+*
+*/
+void writeOutputCID( ItemKey cid ){
+	writeOutputInt( CID_KEY_LEFT( cid ) );
+	writeOutputChar( PERIOD_WORD_SEPARATOR_CH );
+	writeOutputInt( CID_KEY_RIGHT( cid ) );
+}
+
+/*
+* writeErrorMessage
+* ----------------------------------
+*  
+* Formats an error message like printf. Without a sink it is
+* buffered for stderr until the output is next flushed, since an
+* error can give away that an earlier change was made. With one it
+* goes to the sink's writeError straight away, or if it has none
+* joins the output so it reaches the sink in order with the rest.
+*
+* @format ------------------> printf format of message.
+*
+* @return ------------------> None.
+*
+*/
+void writeErrorMessage( const char* format, ... ){
+
+	char message[ OUTPUT_ERROR_MAX_SIZE ];
+	va_list arguments;
+
+	va_start( arguments, format );
+	int length = vsnprintf( message, sizeof( message ), format, arguments );
+	va_end( arguments );
+
+	if( length <= 0 ){
+		return;
+	}
+	if( (size_t)length >= sizeof( message ) ){
+		length = sizeof( message ) - 1;
+	}
+
+	if( s_OutputSink != NULL && s_OutputSink->writeError != NULL ){
+		s_OutputSink->writeError( s_OutputSink->context, message, length );
+		return;
+	}
+	if( s_OutputSink != NULL ){
+		writeOutputChars( message, length );
+		return;
+	}
+	if( s_ErrorLength + length > OUTPUT_BUFFER_SIZE ){
+		flushOutput();
+	}
+	memcpy( s_ErrorBuffer + s_ErrorLength, message, length );
+	s_ErrorLength += length;
+}
+
+/*
+* writeAll
+* ----------------------------------
+*  
+* Writes chars to a file descriptor, only writing
+* again if the first write was cut short.
+*
+* @file --------------------> File descriptor to write to.
+* @chars -------------------> Chars to write.
+* @length ------------------> Number of chars to write.
+*
+* @return ------------------> None.
+*
+*/
+static void writeAll( int file, const char* chars, size_t length ){
+
+	while( length > 0 ){
+		ssize_t numWritten = write( file, chars, length );
+
+		if( numWritten < 0 ){
+			if( errno == EINTR ){
+				continue;
+			}
+			// nowhere left to report output going missing
+			break;
+		}
+		chars += numWritten;
+		length -= numWritten;
+	}
+}
+
+/*
+* flushOutput
+* ----------------------------------
+*  
+* Hands everything buffered so far to the sink, or to stdout
+* in a single write and any error messages to stderr in another.
+* The journal is committed before writing to either. Sinks hold on
+* to their output, whoever sends it on commits the journal first.
+*
+*
+* @return ------------------> None.
+*
+*/
+void flushOutput(){
+
+	if( s_OutputSink != NULL ){
+		if( s_OutputLength > 0 ){
+			s_OutputSink->write( s_OutputSink->context, s_OutputBuffer, s_OutputLength );
+		}
+		s_OutputLength = 0;
+		return;
+	}
+
+	if( s_OutputLength == 0 && s_ErrorLength == 0 ){
+		return;
+	}
+	commitJournal();
+
+	writeAll( STDOUT_FILENO, s_OutputBuffer, s_OutputLength );
+	writeAll( STDERR_FILENO, s_ErrorBuffer, s_ErrorLength );
+	s_OutputLength = 0;
+	s_ErrorLength = 0;
+}
+
+/*
+* setOutputSink
+* ----------------------------------
+*  
+* Flushes whatever is buffered to where it was headed,
+* then sends all output and error messages to sink.
+*
+* @sink --------------------> Where output goes, NULL for stdout.
+*
+* @return ------------------> None.
+*
+*/
+void setOutputSink( const OutputSink* sink ){
+	flushOutput();
+	s_OutputSink = sink;
+}
+
+/*
+* resetOutput
+* ----------------------------------
+*  
+* Drops everything buffered and sends output to stdout again,
+* for a forked child whose buffers and sink are its parent's.
+*
+*
+* @return ------------------> None.
+*
+*/
+void resetOutput(){
+	s_OutputLength = 0;
+	s_ErrorLength = 0;
+	s_OutputSink = NULL;
+}
+
+/*
+* isOutputInteractive
+* ----------------------------------
+*  
+* Determines if stdout or stderr is a terminal.
+*
+*
+* @return ------------------> _Bool indicating if either is a terminal.
+*
+*/
+_Bool isOutputInteractive(){
+
+	if( s_OutputIsInteractive == -1 ){
+		s_OutputIsInteractive = isatty( STDOUT_FILENO ) || isatty( STDERR_FILENO );
+	}
+	return s_OutputIsInteractive;
+}
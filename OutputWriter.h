@@ -0,0 +1,65 @@
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+/*
+* This file contains methods which write the program's
+* normal output. Output is gathered in one large buffer and
+* handed to the operating system with a single write each time
+* the buffer fills or is flushed. Numbers, PIDs and CIDs are
+* formatted by hand so printf is never involved.
+* Error messages are buffered for stderr and flushed along with the
+* output unless an OutputSink is set, then they go along with the
+* output to whoever sent the command, or to the sink's writeError.
+* Nothing reaches stdout or stderr before the journal is committed.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "LinkedDataNodeStructures.h"
+#include <stddef.h>
+
+#define OUTPUT_BUFFER_SIZE 65536
+
+// Longest error message, longer ones are cut short
+#define OUTPUT_ERROR_MAX_SIZE 512
+
+/*
+* Data Structure: OutputSink
+* ----------------------------------
+*
+* Takes flushed output in place of stdout.
+*
+* @write -----------------> Called with each run of flushed chars.
+* @context ---------------> Passed back to write and writeError.
+* @writeError ------------> Called with each error message, NULL to have them join the output.
+*
+*/
+typedef struct {
+	void (*write)( void* context, const char* chars, size_t length );
+	void* context;
+	void (*writeError)( void* context, const char* chars, size_t length );
+} OutputSink;
+
+void writeOutputChars( const char* chars, size_t length );
+void writeOutputString( const char* string );
+void writeOutputChar( char ch );
+void writeOutputInt( int number );
+void writeOutputPID( PatronKey pid );
+void writeOutputCID( ItemKey cid );
+
+// printf for error messages
+void writeErrorMessage( const char* format, ... );
+
+// Writes everything buffered so far
+void flushOutput( );
+
+// Flushes, then sends this thread's output to sink from now on, or to stdout again if NULL
+void setOutputSink( const OutputSink* sink );
+
+// Drops everything buffered and goes back to stdout, in a forked child
+void resetOutput( );
+
+// Whether output or errors go to a terminal, where a user should
+// see each command's output before typing the next one
+_Bool isOutputInteractive( );
+#endif
@@ -0,0 +1,943 @@
+/*
+* This file contains the tables holding every patron, item,
+* author and loan, and the heap holding their strings. Columns,
+* the heap and the author index are grown by doubling, so adding
+* n records copies O(n) in all.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "RecordStore.h"
+#include <allocate.h>
+#include <pthread.h>
+#include <string.h>
+
+// Smallest the columns and the heap are ever made
+#define RECORD_TABLE_MIN_CAPACITY 1024
+#define STRING_HEAP_MIN_CAPACITY 16384
+
+// Most handles a table hands out, NO_RECORD is never one of them
+#define RECORD_TABLE_MAX_CAPACITY ( (uint_least32_t)NO_RECORD )
+
+// Smallest the author index is ever made, a power of 2
+#define AUTHOR_INDEX_MIN_CAPACITY 2048
+
+// 32 bit FNV-1a
+#define AUTHOR_HASH_SEED 2166136261U
+#define AUTHOR_HASH_PRIME 16777619U
+
+PatronTable g_PatronRecords = { NULL, NULL, NULL, NULL, NULL, 0, 0, NO_RECORD };
+ItemTable g_ItemRecords = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, NO_RECORD };
+AuthorTable g_Authors = { NULL, NULL, NULL, NULL, 0, 0, NO_AUTHOR, NULL, 0, 0 };
+LoanTable g_LoanRecords = { { NULL }, 0, NO_LOAN };
+StringHeap g_Strings = { NULL, 0, 0, 0 };
+
+// Held while a loan is handed out or given back
+static pthread_mutex_t s_LoanLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+* getGrownCapacity
+* ----------------------------------
+*  
+* Picks the next capacity of a table or the heap.
+*
+* @capacity ----------------> Current capacity.
+* @needed ------------------> Least the new capacity must be.
+* @minimum -----------------> Smallest capacity to start from.
+* @maximum -----------------> Largest capacity allowed.
+*
+* @return ------------------> New capacity, 0 if needed is over maximum.
+*
+*/
+static uint_least32_t getGrownCapacity( uint_least32_t capacity, uint_least64_t needed, uint_least32_t minimum, uint_least32_t maximum ){
+
+	if( needed > maximum ){
+		return 0;
+	}
+
+	uint_least64_t grown = ( capacity < minimum ) ? minimum : capacity;
+	while( grown < needed ){
+		grown *= 2;
+	}
+	return ( grown > maximum ) ? maximum : (uint_least32_t)grown;
+}
+
+/*
+* copyColumn
+* ----------------------------------
+*  
+* Allocates a bigger column and copies the used part of
+* the old one into it. The old column is left alone.
+*
+* @column ------------------> Old column, may be NULL.
+* @width -------------------> Bytes per record.
+* @numRecords --------------> Records to copy.
+* @capacity ----------------> Records the new column needs room for.
+*
+* @return ------------------> The new column, or NULL.
+*
+*/
+static void* copyColumn( const void* column, size_t width, uint_least32_t numRecords, uint_least32_t capacity ){
+
+	void* grown = allocate( width * capacity );
+	if( grown != NULL && column != NULL ){
+		memcpy( grown, column, width * numRecords );
+	}
+	return grown;
+}
+
+/*
+* freeColumn
+* ----------------------------------
+*  
+* Unallocates a column unless it is NULL.
+*
+* @column ------------------> Column to unallocate.
+*
+* @return ------------------> None.
+*
+*/
+static void freeColumn( void* column ){
+	if( column != NULL ){
+		unallocate( column );
+	}
+}
+
+/*
+* growPatronTable
+* ----------------------------------
+*  
+* Moves every patron column to room for at least one more
+* record. Either every column moves or none do.
+*
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool growPatronTable(){
+
+	PatronTable* table = &g_PatronRecords;
+	uint_least32_t capacity = getGrownCapacity( table->capacity, (uint_least64_t)table->numRecords + 1, RECORD_TABLE_MIN_CAPACITY, RECORD_TABLE_MAX_CAPACITY );
+	if( capacity == 0 ){
+		return 0;
+	}
+
+	PatronKey* pids = (PatronKey*) copyColumn( table->pids, sizeof( PatronKey ), table->numRecords, capacity );
+	StringOffset* names = (StringOffset*) copyColumn( table->names, sizeof( StringOffset ), table->numRecords, capacity );
+	OrderKey* nameKeys = (OrderKey*) copyColumn( table->nameKeys, sizeof( OrderKey ), table->numRecords, capacity );
+	uint_least8_t* numItemsOut = (uint_least8_t*) copyColumn( table->numItemsOut, sizeof( uint_least8_t ), table->numRecords, capacity );
+	LoanHandle* loans = (LoanHandle*) copyColumn( table->loans, sizeof( LoanHandle ), table->numRecords, capacity );
+
+	if( pids == NULL || names == NULL || nameKeys == NULL || numItemsOut == NULL || loans == NULL ){
+		freeColumn( pids );
+		freeColumn( names );
+		freeColumn( nameKeys );
+		freeColumn( numItemsOut );
+		freeColumn( loans );
+		return 0;
+	}
+
+	freeColumn( table->pids );
+	freeColumn( table->names );
+	freeColumn( table->nameKeys );
+	freeColumn( table->numItemsOut );
+	freeColumn( table->loans );
+
+	table->pids = pids;
+	table->names = names;
+	table->nameKeys = nameKeys;
+	table->numItemsOut = numItemsOut;
+	table->loans = loans;
+	table->capacity = capacity;
+	return 1;
+}
+
+/*
+* growItemTable
+* ----------------------------------
+*  
+* Moves every item column to room for at least one more
+* record. Either every column moves or none do.
+*
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool growItemTable(){
+
+	ItemTable* table = &g_ItemRecords;
+	uint_least32_t capacity = getGrownCapacity( table->capacity, (uint_least64_t)table->numRecords + 1, RECORD_TABLE_MIN_CAPACITY, RECORD_TABLE_MAX_CAPACITY );
+	if( capacity == 0 ){
+		return 0;
+	}
+
+	ItemKey* cids = (ItemKey*) copyColumn( table->cids, sizeof( ItemKey ), table->numRecords, capacity );
+	AuthorHandle* authors = (AuthorHandle*) copyColumn( table->authors, sizeof( AuthorHandle ), table->numRecords, capacity );
+	StringOffset* titles = (StringOffset*) copyColumn( table->titles, sizeof( StringOffset ), table->numRecords, capacity );
+	OrderKey* titleKeys = (OrderKey*) copyColumn( table->titleKeys, sizeof( OrderKey ), table->numRecords, capacity );
+	uint_least8_t* numCopies = (uint_least8_t*) copyColumn( table->numCopies, sizeof( uint_least8_t ), table->numRecords, capacity );
+	uint_least8_t* numCopiesOut = (uint_least8_t*) copyColumn( table->numCopiesOut, sizeof( uint_least8_t ), table->numRecords, capacity );
+	LoanHandle* loans = (LoanHandle*) copyColumn( table->loans, sizeof( LoanHandle ), table->numRecords, capacity );
+
+	if( cids == NULL || authors == NULL || titles == NULL || titleKeys == NULL || numCopies == NULL || numCopiesOut == NULL || loans == NULL ){
+		freeColumn( cids );
+		freeColumn( authors );
+		freeColumn( titles );
+		freeColumn( titleKeys );
+		freeColumn( numCopies );
+		freeColumn( numCopiesOut );
+		freeColumn( loans );
+		return 0;
+	}
+
+	freeColumn( table->cids );
+	freeColumn( table->authors );
+	freeColumn( table->titles );
+	freeColumn( table->titleKeys );
+	freeColumn( table->numCopies );
+	freeColumn( table->numCopiesOut );
+	freeColumn( table->loans );
+
+	table->cids = cids;
+	table->authors = authors;
+	table->titles = titles;
+	table->titleKeys = titleKeys;
+	table->numCopies = numCopies;
+	table->numCopiesOut = numCopiesOut;
+	table->loans = loans;
+	table->capacity = capacity;
+	return 1;
+}
+
+/*
+* addHeapString
+* ----------------------------------
+*  
+* Copies a string onto the end of the heap behind its length
+* and followed by a \0, growing the heap if needed.
+*
+* @string ------------------> Chars of the string, no longer than HEAP_STRING_MAX_LENGTH.
+*
+* @return ------------------> Offset of the copy's chars, NO_STRING if memory ran out.
+*
+*/
+static StringOffset addHeapString( StringView string ){
+
+	uint_least64_t needed = (uint_least64_t)g_Strings.size + string.length + 2;
+
+	if( needed > g_Strings.capacity ){
+		uint_least32_t capacity = getGrownCapacity( g_Strings.capacity, needed, STRING_HEAP_MIN_CAPACITY, (uint_least32_t)NO_STRING );
+		if( capacity == 0 ){
+			return NO_STRING;
+		}
+
+		char* chars = (char*) copyColumn( g_Strings.chars, sizeof( char ), g_Strings.size, capacity );
+		if( chars == NULL ){
+			return NO_STRING;
+		}
+		freeColumn( g_Strings.chars );
+		g_Strings.chars = chars;
+		g_Strings.capacity = capacity;
+	}
+
+	StringOffset offset = g_Strings.size + 1;
+
+	g_Strings.chars[ offset - 1 ] = (char)string.length;
+	memcpy( g_Strings.chars + offset, string.start, string.length );
+	g_Strings.chars[ offset + string.length ] = '\0';
+	g_Strings.size = needed;
+	return offset;
+}
+
+/*
+* getHeapStringSize
+* ----------------------------------
+*  
+* Counts the chars a string takes up in the heap.
+*
+* @string ------------------> String from the heap.
+*
+* @return ------------------> Chars it takes up, its length and \0 included.
+*
+*/
+static uint_least32_t getHeapStringSize( const char* string ){
+	return HEAP_STRING_LENGTH( string ) + 2;
+}
+
+/*
+* moveHeapString
+* ----------------------------------
+*  
+* Copies one string into a compacted heap and points its offset at the copy.
+*
+* @offset ------------------> Offset of the string, updated to the copy's.
+* @chars -------------------> Compacted heap.
+* @size --------------------> Chars used in the compacted heap, updated.
+*
+* @return ------------------> None.
+*
+*/
+static void moveHeapString( StringOffset* offset, char* chars, uint_least32_t* size ){
+
+	uint_least32_t stringSize = getHeapStringSize( HEAP_STRING( *offset ) );
+
+	memcpy( chars + *size, HEAP_STRING( *offset ) - 1, stringSize );
+	*offset = *size + 1;
+	*size += stringSize;
+}
+
+/*
+* freeHeapChars
+* ----------------------------------
+*  
+* Counts chars of strings no record uses any more as a hole.
+* Once holes are half of the heap every live string is copied
+* into a new heap without them, if there is memory for one.
+*
+* @numChars ----------------> Chars freed, see getHeapStringSize.
+*
+* @return ------------------> None.
+*
+*/
+static void freeHeapChars( uint_least32_t numChars ){
+
+	g_Strings.numFreed += numChars;
+
+	if( g_Strings.numFreed < STRING_HEAP_MIN_CAPACITY || g_Strings.numFreed < g_Strings.size / 2 ){
+		return;
+	}
+
+	uint_least32_t capacity = getGrownCapacity( 0, g_Strings.size - g_Strings.numFreed, STRING_HEAP_MIN_CAPACITY, (uint_least32_t)NO_STRING );
+	char* chars = (char*) allocate( capacity );
+	if( chars == NULL ){
+		return;
+	}
+
+	uint_least32_t size = 0;
+
+	for( RecordHandle patron = 0; patron < g_PatronRecords.numRecords; ++patron ){
+		if( g_PatronRecords.names[ patron ] != NO_STRING ){
+			moveHeapString( &g_PatronRecords.names[ patron ], chars, &size );
+		}
+	}
+	for( RecordHandle item = 0; item < g_ItemRecords.numRecords; ++item ){
+		if( g_ItemRecords.titles[ item ] != NO_STRING ){
+			moveHeapString( &g_ItemRecords.titles[ item ], chars, &size );
+		}
+	}
+	for( AuthorHandle author = 0; author < g_Authors.numAuthors; ++author ){
+		if( g_Authors.names[ author ] != NO_STRING ){
+			moveHeapString( &g_Authors.names[ author ], chars, &size );
+		}
+	}
+
+	unallocate( g_Strings.chars );
+	g_Strings.chars = chars;
+	g_Strings.size = size;
+	g_Strings.capacity = capacity;
+	g_Strings.numFreed = 0;
+}
+
+/*
+* compareHeapStrings
+* ----------------------------------
+*  
+* Orders two strings from the heap as strcmp would. Their lengths
+* are known so the chars are compared in one memcmp, up to and
+* including the shorter one's \0.
+*
+* @first -------------------> String from the heap.
+* @second ------------------> String from the heap.
+*
+* @return ------------------> Less than, equal to or greater than 0 as first orders before, with or after second.
+*
+*/
+int compareHeapStrings( const char* first, const char* second ){
+
+	uint_least8_t firstLength = HEAP_STRING_LENGTH( first );
+	uint_least8_t secondLength = HEAP_STRING_LENGTH( second );
+
+	return memcmp( first, second, ( ( firstLength < secondLength ) ? firstLength : secondLength ) + 1 );
+}
+
+/*
+* compareKeyedStrings
+* ----------------------------------
+*  
+* Orders two strings from the heap as compareHeapStrings would,
+* given their OrderKeys. Only strings sharing their first
+* ORDER_KEY_SIZE chars have those chars compared.
+*
+* @firstKey ----------------> OrderKey of first.
+* @first -------------------> String from the heap.
+* @secondKey ---------------> OrderKey of second.
+* @second ------------------> String from the heap.
+*
+* @return ------------------> Less than, equal to or greater than 0 as first orders before, with or after second.
+*
+*/
+int compareKeyedStrings( OrderKey firstKey, const char* first, OrderKey secondKey, const char* second ){
+
+	if( firstKey != secondKey ){
+		return ( firstKey > secondKey ) ? 1 : -1;
+	}
+	// equal keys with a \0 inside them are equal strings
+	if( HEAP_STRING_LENGTH( first ) < ORDER_KEY_SIZE ){
+		return 0;
+	}
+	return compareHeapStrings( first, second );
+}
+
+/*
+* getOrderKey
+* ----------------------------------
+*  
+* Packs the first ORDER_KEY_SIZE chars of a string into
+* an OrderKey, first char highest.
+*
+* @string ------------------> String to make the key of.
+*
+* @return ------------------> The key.
+*
+*/
+static OrderKey getOrderKey( StringView string ){
+
+	OrderKey key = 0;
+
+	for( size_t i = 0; i < ORDER_KEY_SIZE; ++i ){
+		key = ( key << 8 ) | ( ( i < string.length ) ? (unsigned char)string.start[ i ] : 0 );
+	}
+	return key;
+}
+
+/*
+* hashAuthor
+* ----------------------------------
+*  
+* Hashes an author's chars for the author index.
+*
+* @author ------------------> Author to hash.
+*
+* @return ------------------> The hash.
+*
+*/
+static uint_least32_t hashAuthor( StringView author ){
+
+	uint_least32_t hash = AUTHOR_HASH_SEED;
+
+	for( size_t i = 0; i < author.length; ++i ){
+		hash = ( hash ^ (unsigned char)author.start[ i ] ) * AUTHOR_HASH_PRIME;
+	}
+	return hash & 0xFFFFFFFF;
+}
+
+/*
+* findAuthorSlot
+* ----------------------------------
+*  
+* Probes the author index for an author, stopping at the slot
+* holding it or at the empty slot where it would go.
+*
+* @author ------------------> Author to look for.
+* @hash --------------------> hashAuthor of author.
+*
+* @return ------------------> Index of the slot.
+*
+*/
+static uint_least32_t findAuthorSlot( StringView author, uint_least32_t hash ){
+
+	uint_least32_t mask = g_Authors.indexCapacity - 1;
+	uint_least32_t slot = hash & mask;
+
+	for( AuthorHandle existing; ( existing = g_Authors.index[ slot ] ) != NO_AUTHOR; slot = ( slot + 1 ) & mask ){
+		const char* name = AUTHOR_NAME( existing );
+
+		if( g_Authors.hashes[ existing ] == hash && HEAP_STRING_LENGTH( name ) == author.length && memcmp( name, author.start, author.length ) == 0 ){
+			break;
+		}
+	}
+	return slot;
+}
+
+/*
+* growAuthorIndex
+* ----------------------------------
+*  
+* Moves the author index to twice the slots and puts
+* every author back into it.
+*
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool growAuthorIndex(){
+
+	uint_least32_t capacity = ( g_Authors.indexCapacity == 0 ) ? AUTHOR_INDEX_MIN_CAPACITY : g_Authors.indexCapacity * 2;
+	AuthorHandle* index = (AuthorHandle*) allocate( sizeof( AuthorHandle ) * capacity );
+	if( index == NULL ){
+		return 0;
+	}
+
+	for( uint_least32_t slot = 0; slot < capacity; ++slot ){
+		index[ slot ] = NO_AUTHOR;
+	}
+
+	uint_least32_t mask = capacity - 1;
+
+	for( AuthorHandle author = 0; author < g_Authors.numAuthors; ++author ){
+		if( g_Authors.names[ author ] != NO_STRING ){
+			uint_least32_t slot = g_Authors.hashes[ author ] & mask;
+
+			while( index[ slot ] != NO_AUTHOR ){
+				slot = ( slot + 1 ) & mask;
+			}
+			index[ slot ] = author;
+		}
+	}
+
+	freeColumn( g_Authors.index );
+	g_Authors.index = index;
+	g_Authors.indexCapacity = capacity;
+	return 1;
+}
+
+/*
+* growAuthorTable
+* ----------------------------------
+*  
+* Moves every author column to room for at least one more
+* author. Either every column moves or none do.
+*
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool growAuthorTable(){
+
+	AuthorTable* table = &g_Authors;
+	uint_least32_t capacity = getGrownCapacity( table->capacity, (uint_least64_t)table->numAuthors + 1, RECORD_TABLE_MIN_CAPACITY, RECORD_TABLE_MAX_CAPACITY );
+	if( capacity == 0 ){
+		return 0;
+	}
+
+	StringOffset* names = (StringOffset*) copyColumn( table->names, sizeof( StringOffset ), table->numAuthors, capacity );
+	OrderKey* nameKeys = (OrderKey*) copyColumn( table->nameKeys, sizeof( OrderKey ), table->numAuthors, capacity );
+	uint_least32_t* hashes = (uint_least32_t*) copyColumn( table->hashes, sizeof( uint_least32_t ), table->numAuthors, capacity );
+	uint_least32_t* numItems = (uint_least32_t*) copyColumn( table->numItems, sizeof( uint_least32_t ), table->numAuthors, capacity );
+
+	if( names == NULL || nameKeys == NULL || hashes == NULL || numItems == NULL ){
+		freeColumn( names );
+		freeColumn( nameKeys );
+		freeColumn( hashes );
+		freeColumn( numItems );
+		return 0;
+	}
+
+	freeColumn( table->names );
+	freeColumn( table->nameKeys );
+	freeColumn( table->hashes );
+	freeColumn( table->numItems );
+
+	table->names = names;
+	table->nameKeys = nameKeys;
+	table->hashes = hashes;
+	table->numItems = numItems;
+	table->capacity = capacity;
+	return 1;
+}
+
+/*
+* internAuthor
+* ----------------------------------
+*  
+* Finds the author among those already stored and counts one
+* more item by them, or stores them if they are new.
+*
+* @author ------------------> Author, no longer than HEAP_STRING_MAX_LENGTH.
+*
+* @return ------------------> Handle of the author, NO_AUTHOR if memory ran out.
+*
+*/
+static AuthorHandle internAuthor( StringView author ){
+
+	AuthorTable* table = &g_Authors;
+	uint_least32_t hash = hashAuthor( author );
+
+	if( table->indexCapacity > 0 ){
+		AuthorHandle existing = table->index[ findAuthorSlot( author, hash ) ];
+
+		if( existing != NO_AUTHOR ){
+			++table->numItems[ existing ];
+			return existing;
+		}
+	}
+
+	if( ( table->numIndexed + 1 ) * 2 > table->indexCapacity && !growAuthorIndex() ){
+		return NO_AUTHOR;
+	}
+	if( table->freeAuthors == NO_AUTHOR && table->numAuthors == table->capacity && !growAuthorTable() ){
+		return NO_AUTHOR;
+	}
+
+	StringOffset nameOffset = addHeapString( author );
+	if( nameOffset == NO_STRING ){
+		return NO_AUTHOR;
+	}
+
+	AuthorHandle newAuthor = table->freeAuthors;
+	if( newAuthor != NO_AUTHOR ){
+		table->freeAuthors = table->numItems[ newAuthor ];
+	}
+	else{
+		newAuthor = table->numAuthors++;
+	}
+
+	table->names[ newAuthor ] = nameOffset;
+	table->nameKeys[ newAuthor ] = getOrderKey( author );
+	table->hashes[ newAuthor ] = hash;
+	table->numItems[ newAuthor ] = 1;
+	table->index[ findAuthorSlot( author, hash ) ] = newAuthor;
+	++table->numIndexed;
+	return newAuthor;
+}
+
+/*
+* releaseAuthor
+* ----------------------------------
+*  
+* Counts one item fewer by the author, and once none are left
+* frees their handle for reuse. Later entries of the author index
+* are shifted back over the emptied slot, so lookups never need to
+* step over a removed author. The caller passes what is returned
+* on to freeHeapChars.
+*
+* @author ------------------> Author of an item being removed.
+*
+* @return ------------------> Chars of the author's string left unused, 0 if still in use.
+*
+*/
+static uint_least32_t releaseAuthor( AuthorHandle author ){
+
+	AuthorTable* table = &g_Authors;
+
+	if( --table->numItems[ author ] > 0 ){
+		return 0;
+	}
+
+	uint_least32_t mask = table->indexCapacity - 1;
+	uint_least32_t slot = table->hashes[ author ] & mask;
+
+	while( table->index[ slot ] != author ){
+		slot = ( slot + 1 ) & mask;
+	}
+	table->index[ slot ] = NO_AUTHOR;
+
+	for( uint_least32_t next = ( slot + 1 ) & mask; table->index[ next ] != NO_AUTHOR; next = ( next + 1 ) & mask ){
+		uint_least32_t home = table->hashes[ table->index[ next ] ] & mask;
+
+		// it may fill the hole only if the hole is not before its home slot
+		if( ( ( next - home ) & mask ) >= ( ( next - slot ) & mask ) ){
+			table->index[ slot ] = table->index[ next ];
+			table->index[ next ] = NO_AUTHOR;
+			slot = next;
+		}
+	}
+	--table->numIndexed;
+
+	uint_least32_t numChars = getHeapStringSize( AUTHOR_NAME( author ) );
+
+	table->names[ author ] = NO_STRING;
+	table->numItems[ author ] = table->freeAuthors;
+	table->freeAuthors = author;
+	return numChars;
+}
+
+/*
+* addPatronRecord
+* ----------------------------------
+*  
+* Adds a patron with no loans, reusing a freed handle if there is one.
+*
+* @pid ---------------------> Encoded PID.
+* @name --------------------> Name, copied into the heap.
+*
+* @return ------------------> Handle of the patron, NO_RECORD if memory ran out.
+*
+*/
+RecordHandle addPatronRecord( PatronKey pid, StringView name ){
+
+	PatronTable* table = &g_PatronRecords;
+
+	if( table->freeRecords == NO_RECORD && table->numRecords == table->capacity && !growPatronTable() ){
+		return NO_RECORD;
+	}
+
+	if( name.length > HEAP_STRING_MAX_LENGTH ){
+		name.length = HEAP_STRING_MAX_LENGTH;
+	}
+
+	StringOffset nameOffset = addHeapString( name );
+	if( nameOffset == NO_STRING ){
+		return NO_RECORD;
+	}
+
+	RecordHandle patron = table->freeRecords;
+	if( patron != NO_RECORD ){
+		table->freeRecords = table->loans[ patron ];
+	}
+	else{
+		patron = table->numRecords++;
+	}
+
+	table->pids[ patron ] = pid;
+	table->names[ patron ] = nameOffset;
+	table->nameKeys[ patron ] = getOrderKey( name );
+	table->numItemsOut[ patron ] = 0;
+	table->loans[ patron ] = NO_LOAN;
+	return patron;
+}
+
+/*
+* addItemRecord
+* ----------------------------------
+*  
+* Adds an item with no loans, reusing a freed handle if there is one.
+*
+* @numCopies ---------------> Number of copies library owns.
+* @cid ---------------------> Encoded CID.
+* @author ------------------> Author, interned.
+* @title -------------------> Title, copied into the heap.
+*
+* @return ------------------> Handle of the item, NO_RECORD if memory ran out.
+*
+*/
+RecordHandle addItemRecord( uint_least8_t numCopies, ItemKey cid, StringView author, StringView title ){
+
+	ItemTable* table = &g_ItemRecords;
+
+	if( table->freeRecords == NO_RECORD && table->numRecords == table->capacity && !growItemTable() ){
+		return NO_RECORD;
+	}
+
+	if( author.length > HEAP_STRING_MAX_LENGTH ){
+		author.length = HEAP_STRING_MAX_LENGTH;
+	}
+	if( title.length > HEAP_STRING_MAX_LENGTH ){
+		title.length = HEAP_STRING_MAX_LENGTH;
+	}
+
+	AuthorHandle itemsAuthor = internAuthor( author );
+	if( itemsAuthor == NO_AUTHOR ){
+		return NO_RECORD;
+	}
+
+	StringOffset titleOffset = addHeapString( title );
+	if( titleOffset == NO_STRING ){
+		freeHeapChars( releaseAuthor( itemsAuthor ) );
+		return NO_RECORD;
+	}
+
+	RecordHandle item = table->freeRecords;
+	if( item != NO_RECORD ){
+		table->freeRecords = table->loans[ item ];
+	}
+	else{
+		item = table->numRecords++;
+	}
+
+	table->cids[ item ] = cid;
+	table->authors[ item ] = itemsAuthor;
+	table->titles[ item ] = titleOffset;
+	table->titleKeys[ item ] = getOrderKey( title );
+	table->numCopies[ item ] = numCopies;
+	table->numCopiesOut[ item ] = 0;
+	table->loans[ item ] = NO_LOAN;
+	return item;
+}
+
+/*
+* removePatronRecord
+* ----------------------------------
+*  
+* Frees a patron's name and its handle for reuse.
+*
+* @patron ------------------> Patron with no loans left.
+*
+* @return ------------------> None.
+*
+*/
+void removePatronRecord( RecordHandle patron ){
+
+	if( patron >= g_PatronRecords.numRecords || g_PatronRecords.names[ patron ] == NO_STRING ){
+		return;
+	}
+
+	uint_least32_t numChars = getHeapStringSize( PATRON_NAME( patron ) );
+
+	g_PatronRecords.names[ patron ] = NO_STRING;
+	g_PatronRecords.loans[ patron ] = g_PatronRecords.freeRecords;
+	g_PatronRecords.freeRecords = patron;
+	freeHeapChars( numChars );
+}
+
+/*
+* removeItemRecord
+* ----------------------------------
+*  
+* Frees an item's strings and its handle for reuse.
+*
+* @item --------------------> Item with no loans left.
+*
+* @return ------------------> None.
+*
+*/
+void removeItemRecord( RecordHandle item ){
+
+	if( item >= g_ItemRecords.numRecords || g_ItemRecords.titles[ item ] == NO_STRING ){
+		return;
+	}
+
+	uint_least32_t numChars = getHeapStringSize( ITEM_TITLE( item ) );
+
+	// marked free first so compacting leaves its strings behind
+	g_ItemRecords.titles[ item ] = NO_STRING;
+	numChars += releaseAuthor( g_ItemRecords.authors[ item ] );
+	g_ItemRecords.loans[ item ] = g_ItemRecords.freeRecords;
+	g_ItemRecords.freeRecords = item;
+	freeHeapChars( numChars );
+}
+
+/*
+* allocateLoan
+* ----------------------------------
+*  
+* Hands out a loan, reusing a freed one first. A new chunk
+* is published only once it is allocated, so queries reading
+* through readLoanRecord never see a half made one.
+*
+*
+* @return ------------------> Handle of the loan, or NO_LOAN.
+*
+*/
+LoanHandle allocateLoan(){
+
+	pthread_mutex_lock( &s_LoanLock );
+
+	LoanHandle loan = g_LoanRecords.freeLoans;
+
+	if( loan != NO_LOAN ){
+		g_LoanRecords.freeLoans = LOAN_RECORD( loan )->nextPatronsLoan;
+	}
+	else if( g_LoanRecords.numLoans < LOAN_MAX_CHUNKS * LOAN_CHUNK_SIZE ){
+		LoanRecord** chunk = &g_LoanRecords.chunks[ g_LoanRecords.numLoans >> LOAN_CHUNK_BITS ];
+
+		if( *chunk == NULL ){
+			LoanRecord* newChunk = (LoanRecord*) allocate( sizeof( LoanRecord ) * LOAN_CHUNK_SIZE );
+			if( newChunk != NULL ){
+				__atomic_store_n( chunk, newChunk, __ATOMIC_RELEASE );
+			}
+		}
+		if( *chunk != NULL ){
+			loan = g_LoanRecords.numLoans++;
+		}
+	}
+
+	pthread_mutex_unlock( &s_LoanLock );
+	return loan;
+}
+
+/*
+* freeLoan
+* ----------------------------------
+*  
+* Gives a loan back for reuse.
+*
+* @loan --------------------> Loan to give back.
+*
+* @return ------------------> None.
+*
+*/
+void freeLoan( LoanHandle loan ){
+
+	if( loan == NO_LOAN ){
+		return;
+	}
+
+	pthread_mutex_lock( &s_LoanLock );
+	// a query may still be reading the freed loan, see readPatronsOfItem
+	__atomic_store_n( &LOAN_RECORD( loan )->nextPatronsLoan, g_LoanRecords.freeLoans, __ATOMIC_RELAXED );
+	g_LoanRecords.freeLoans = loan;
+	pthread_mutex_unlock( &s_LoanLock );
+}
+
+/*
+* readLoanRecord
+* ----------------------------------
+*  
+* Finds a loan without its stripes. A torn walk can hand over
+* a handle whose chunk this thread cannot see yet, that only
+* happens when the read is going to be thrown away anyway.
+*
+* @loan --------------------> Loan to find.
+*
+* @return ------------------> The loan, or NULL.
+*
+*/
+const LoanRecord* readLoanRecord( LoanHandle loan ){
+
+	if( loan >= LOAN_MAX_CHUNKS * LOAN_CHUNK_SIZE ){
+		return NULL;
+	}
+
+	const LoanRecord* chunk = __atomic_load_n( &g_LoanRecords.chunks[ loan >> LOAN_CHUNK_BITS ], __ATOMIC_ACQUIRE );
+	return ( chunk == NULL ) ? NULL : &chunk[ loan & ( LOAN_CHUNK_SIZE - 1 ) ];
+}
+
+/*
+* releaseRecordStore
+* ----------------------------------
+*  
+* Unallocates every column, the author index, every loan chunk and the heap.
+*
+*
+* @return ------------------> None.
+*
+*/
+void releaseRecordStore(){
+
+	freeColumn( g_PatronRecords.pids );
+	freeColumn( g_PatronRecords.names );
+	freeColumn( g_PatronRecords.nameKeys );
+	freeColumn( g_PatronRecords.numItemsOut );
+	freeColumn( g_PatronRecords.loans );
+	memset( &g_PatronRecords, 0, sizeof( g_PatronRecords ) );
+	g_PatronRecords.freeRecords = NO_RECORD;
+
+	freeColumn( g_ItemRecords.cids );
+	freeColumn( g_ItemRecords.authors );
+	freeColumn( g_ItemRecords.titles );
+	freeColumn( g_ItemRecords.titleKeys );
+	freeColumn( g_ItemRecords.numCopies );
+	freeColumn( g_ItemRecords.numCopiesOut );
+	freeColumn( g_ItemRecords.loans );
+	memset( &g_ItemRecords, 0, sizeof( g_ItemRecords ) );
+	g_ItemRecords.freeRecords = NO_RECORD;
+
+	freeColumn( g_Authors.names );
+	freeColumn( g_Authors.nameKeys );
+	freeColumn( g_Authors.hashes );
+	freeColumn( g_Authors.numItems );
+	freeColumn( g_Authors.index );
+	memset( &g_Authors, 0, sizeof( g_Authors ) );
+	g_Authors.freeAuthors = NO_AUTHOR;
+
+	for( uint_least32_t i = 0; i < LOAN_MAX_CHUNKS; ++i ){
+		freeColumn( g_LoanRecords.chunks[ i ] );
+	}
+	memset( &g_LoanRecords, 0, sizeof( g_LoanRecords ) );
+	g_LoanRecords.freeLoans = NO_LOAN;
+
+	freeColumn( g_Strings.chars );
+	memset( &g_Strings, 0, sizeof( g_Strings ) );
+}
@@ -0,0 +1,160 @@
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+/*
+* This file contains the tables holding every patron, item and
+* loan, one dense column per field, and the one heap holding all
+* of their strings. Records and loans are named by 32 bit handles
+* and strings by 32 bit offsets rather than by 64 bit pointers, so
+* a patron takes 21 bytes besides its name, an item 26 besides its
+* title and a loan 24, and reading one field of every record
+* walks one array. Strings sit in the heap each behind its length,
+* so comparing two of them never looks for the end first.
+*
+* Authors are interned. Each distinct author is stored once with
+* a count of the items by it, and items name it by AuthorHandle,
+* so two items by the same author compare equal without reading
+* either string. Names, authors and titles also keep an OrderKey
+* beside them, which orders two different strings in one compare
+* unless their first ORDER_KEY_SIZE chars are the same.
+*
+* Records and strings are only added or removed with the library
+* held exclusively, which is also the only time a column or the
+* heap may move. Loans are made and ended by borrows and returns
+* on several threads at once, so the loan table is split into
+* chunks that never move and has a lock of its own.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "LinkedDataNodeStructures.h"
+#include "Tokenizer.h"
+#include "AllConstants.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest string the heap holds, its length has to fit in the byte before it
+#define HEAP_STRING_MAX_LENGTH UINT8_MAX
+
+// Loans per chunk, as a power of 2
+#define LOAN_CHUNK_BITS 10
+#define LOAN_CHUNK_SIZE ( 1 << LOAN_CHUNK_BITS )
+
+// Enough chunks for every patron to have as many loans as allowed
+#define LOAN_MAX_CHUNKS ( ( PID_KEY_COUNT * PATRON_MAX_ITEMS_OUT + LOAN_CHUNK_SIZE - 1 ) / LOAN_CHUNK_SIZE )
+
+/*
+* Data Structure: StringHeap
+* ----------------------------------
+*
+* Every name, author and title. Each is stored as a length byte,
+* its chars and a \0. Freed strings leave holes which are squeezed out once they
+* make up half of the heap.
+*
+* @chars -----------------> The strings.
+* @size ------------------> Chars in use, holes included.
+* @capacity --------------> Chars chars has room for.
+* @numFreed --------------> Chars in holes.
+*
+*/
+typedef struct {
+	char* chars;
+	uint_least32_t size;
+	uint_least32_t capacity;
+	uint_least32_t numFreed;
+} StringHeap;
+
+/*
+* Data Structure: AuthorTable
+* ----------------------------------
+*
+* Every distinct author, one column per field indexed by
+* AuthorHandle, and a hash index from an author's chars
+* to its handle. Changes only with the library held exclusively.
+*
+* @names -----------------> Author, NO_STRING once the handle is free.
+* @nameKeys --------------> OrderKey of the author.
+* @hashes ----------------> Hash of the author's chars.
+* @numItems --------------> Items by the author. Free handles chain through it.
+* @numAuthors ------------> Handles handed out so far, freed or not.
+* @capacity --------------> Handles the columns have room for.
+* @freeAuthors -----------> Most recently freed handle, NO_AUTHOR for none.
+* @index -----------------> Open addressed by hash, NO_AUTHOR marks an empty slot.
+* @indexCapacity ---------> Slots in index, a power of 2.
+* @numIndexed ------------> Authors in index, kept under half of indexCapacity.
+*
+*/
+typedef struct {
+	StringOffset* names;
+	OrderKey* nameKeys;
+	uint_least32_t* hashes;
+	uint_least32_t* numItems;
+	uint_least32_t numAuthors;
+	uint_least32_t capacity;
+	AuthorHandle freeAuthors;
+	AuthorHandle* index;
+	uint_least32_t indexCapacity;
+	uint_least32_t numIndexed;
+} AuthorTable;
+
+/*
+* Data Structure: LoanTable
+* ----------------------------------
+*
+* Every loan, LOAN_CHUNK_SIZE to a chunk. A LoanHandle's
+* high bits pick the chunk and its low LOAN_CHUNK_BITS the loan.
+*
+* @chunks ----------------> Chunks of loans, NULL until first needed.
+* @numLoans --------------> Handles handed out so far, freed or not.
+* @freeLoans -------------> Most recently freed loan, chained through nextPatronsLoan.
+*
+*/
+typedef struct {
+	LoanRecord* chunks[ LOAN_MAX_CHUNKS ];
+	uint_least32_t numLoans;
+	LoanHandle freeLoans;
+} LoanTable;
+
+extern PatronTable g_PatronRecords;
+extern ItemTable g_ItemRecords;
+extern AuthorTable g_Authors;
+extern LoanTable g_LoanRecords;
+extern StringHeap g_Strings;
+
+// Strings of a record, valid until the library is next held exclusively
+#define HEAP_STRING( offset ) ( g_Strings.chars + (offset) )
+#define HEAP_STRING_LENGTH( string ) ( (uint_least8_t)(string)[ -1 ] )
+#define PATRON_NAME( patron ) HEAP_STRING( g_PatronRecords.names[ (patron) ] )
+#define AUTHOR_NAME( author ) HEAP_STRING( g_Authors.names[ (author) ] )
+#define ITEM_AUTHOR( item ) AUTHOR_NAME( g_ItemRecords.authors[ (item) ] )
+#define ITEM_TITLE( item ) HEAP_STRING( g_ItemRecords.titles[ (item) ] )
+
+// Orders two heap strings as strcmp does
+int compareHeapStrings( const char* first, const char* second );
+
+// Orders two heap strings by their OrderKeys, only comparing chars when those tie
+int compareKeyedStrings( OrderKey firstKey, const char* first, OrderKey secondKey, const char* second );
+
+// Loan of a handle, for callers holding both of its stripes
+#define LOAN_RECORD( loan ) ( &g_LoanRecords.chunks[ (loan) >> LOAN_CHUNK_BITS ][ (loan) & ( LOAN_CHUNK_SIZE - 1 ) ] )
+
+// These copy the strings into the heap, cut to HEAP_STRING_MAX_LENGTH,
+// they return NO_RECORD when memory runs out
+RecordHandle addPatronRecord( PatronKey pid, StringView name );
+RecordHandle addItemRecord( uint_least8_t numCopies, ItemKey cid, StringView author, StringView title );
+
+// The record must have no loans left
+void removePatronRecord( RecordHandle patron );
+void removeItemRecord( RecordHandle item );
+
+// NO_LOAN when memory runs out, the loan's fields are left for the caller
+LoanHandle allocateLoan( );
+void freeLoan( LoanHandle loan );
+
+// For queries holding only the library shared, see readPatronsOfItem,
+// NULL if the loan's chunk cannot be seen yet which makes the read torn
+const LoanRecord* readLoanRecord( LoanHandle loan );
+
+// Empties every table and the heap, any handle or offset is invalid afterwards
+void releaseRecordStore( );
+#endif
@@ -11,9 +11,14 @@
 
 #include "SanitizeInput.h"
 #include "ExecuteCommands.h"
+#include "UIDIndex.h"
+#include "OutputWriter.h"
+#include "Snapshot.h"
+#include "Journal.h"
+#include "LibraryLocks.h"
+#include "CommandStats.h"
 #include <string.h>
 #include <ctype.h>
-#include <allocate.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "AllConstants.h"
@@ -40,66 +45,174 @@ void processInput(){
 
 	// get each line until end of file
 	while( fgets( fullLine, LINE_MAX_SIZE, ( ( g_InputFile == NULL ) ? stdin : g_InputFile ) ) != NULL ){
+		processLine( fullLine, strlen( fullLine ) );
+		pollJournalCheckpoint();
+		pollCommandStats();
 
-		// parse first word of line based on word separators
-		char* parsedCommand = strtok( fullLine, DEFAULT_WORD_SEPARATORS );;
+		// a user at a terminal sees each command's output, flushing commits the journal first
+		if( isOutputInteractive() ){
+			flushOutput();
+		}
+	}
+	if( g_InputFile == NULL ){
+		// if using stdin then we need to print finising statuses of everything
+		writeOutputChar( '\n' );
+		printAllListsStatus( );
+	}
+}
+
+/*
+* processLine
+* ----------------------------------
+*  
+* Processes a single line of input. The line is
+* only read, never copied or modified.
+*
+* @line --------------------> Chars of the line, need not be \0 terminated.
+* @length ------------------> Number of chars in line.
+*
+* @return ------------------> None.
+*
+*/
+void processLine( const char* line, size_t length ){
+
+	Tokenizer tokens;
+	StringView parsedCommand;
+
+	initTokenizer( &tokens, line, length );
+
+	// parse first word of line based on word separators
+	if( nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &parsedCommand ) ){
+		processCommand( &tokens, parsedCommand );
+	}
+}
+
+/*
+* processCommand
+* ----------------------------------
+*  
+* Processes a single command. The command word has already
+* been split off the line, the rest of the line is parsed
+* from where tokens left off. Commands that change or query
+* the library are counted and timed in CommandStats.
+*
+* @tokens ------------------> Tokenizer positioned after the command word.
+* @parsedCommand -----------> First word of the line.
+*
+* @return ------------------> None.
+*
+*/
+void processCommand( Tokenizer* tokens, StringView parsedCommand ){
 
-		if( parsedCommand != NULL ){
+	uint_least64_t startTime = getCommandClock();
 
-			if( strcmp( parsedCommand, ADD_PATRON_COMMAND ) == 0 ){
-				processPatronCommand();
+	// COMMAND_TYPES for commands that are not counted
+	CommandType type = COMMAND_TYPES;
+	CommandStatus status = COMMAND_MALFORMED;
+
+	if( viewEquals( parsedCommand, ADD_PATRON_COMMAND ) ){
+		type = COMMAND_TYPE_PATRON;
+		status = processPatronCommand( tokens );
+	}
+	else if( viewEquals( parsedCommand, ADD_ITEM_COMMAND ) ){
+		type = COMMAND_TYPE_ITEM;
+		status = processItemCommand( tokens );
+	}
+	else if( viewEquals( parsedCommand, BORROW_ITEM_COMMAND ) || viewEquals( parsedCommand, RETURN_ITEM_COMMAND ) ){
+		StringView pid;
+		StringView cid;
+
+		type = viewEquals( parsedCommand, BORROW_ITEM_COMMAND ) ? COMMAND_TYPE_BORROW : COMMAND_TYPE_RETURN;
+
+		if( nextToken( tokens, DEFAULT_WORD_SEPARATORS, &pid ) && nextToken( tokens, DEFAULT_WORD_SEPARATORS, &cid ) && isValidPID( pid ) && isValidCID( cid ) ){
+			PatronKey patronKey = encodePID( pid.start );
+			ItemKey itemKey = encodeCID( cid.start, cid.length );
+
+			lockPatronAndItem( patronKey, itemKey );
+			if( type == COMMAND_TYPE_BORROW ){
+				status = borrowItem( patronKey, itemKey );
 			}
-			else if( strcmp( parsedCommand, ADD_ITEM_COMMAND ) == 0 ){
-				processItemCommand();
+			else{
+				status = returnPatronsItem( patronKey, itemKey );
 			}
-			else if( strcmp( parsedCommand, BORROW_ITEM_COMMAND ) == 0 || strcmp( parsedCommand, RETURN_ITEM_COMMAND ) == 0 ){
-				const char* pid = strtok( 0, DEFAULT_WORD_SEPARATORS );
-				const char* cid = strtok( 0, DEFAULT_WORD_SEPARATORS );
-
-				if( pid != NULL && cid != NULL && isValidPID( pid ) && isValidCID( cid ) ){
-					if( strcmp( parsedCommand, BORROW_ITEM_COMMAND ) == 0 ){
-						borrowItem( pid, cid );	
-					}
-					else{
-						returnPatronsItem( pid, cid );
-					}
-				}
+			unlockPatronAndItem( patronKey, itemKey );
+		}
+	}
+	else if( viewEquals( parsedCommand, DISCARD_ITEM_COMMAND ) ){
+
+		StringView numToDiscard;
+		StringView cid;
+
+		type = COMMAND_TYPE_DISCARD;
+
+		if( nextToken( tokens, DEFAULT_WORD_SEPARATORS, &numToDiscard ) && nextToken( tokens, DEFAULT_WORD_SEPARATORS, &cid ) ){
+			long int nToDiscard = viewToUnsigned( numToDiscard );
+			if( nToDiscard >= ITEM_NUMS_MIN_SIZE && nToDiscard <= ITEM_NUMS_MAX_SIZE && isValidCID( cid ) ){
+				lockLibrary();
+				status = discardCopiesOfItem( nToDiscard, encodeCID( cid.start, cid.length ) );
+				unlockLibrary();
 			}
-			else if( strcmp( parsedCommand, DISCARD_ITEM_COMMAND ) == 0 ){
+		}
+	}
+	else if( viewEquals( parsedCommand, OUT_COMMAND ) || viewEquals( parsedCommand, AVAILABLE_ITEM_COMMAND ) ){
+		StringView uid;
 
-				const char* numToDiscard = strtok( 0, DEFAULT_WORD_SEPARATORS );
-				const char* cid = strtok( 0, DEFAULT_WORD_SEPARATORS );
+		type = viewEquals( parsedCommand, OUT_COMMAND ) ? COMMAND_TYPE_OUT : COMMAND_TYPE_AVAILABLE;
+		if( nextToken( tokens, DEFAULT_WORD_SEPARATORS, &uid ) ){
+			if( isValidCID( uid ) ){
+				ItemKey itemKey = encodeCID( uid.start, uid.length );
 
-				if( numToDiscard != NULL && cid != NULL ){
-					long int nToDiscard = strtoul( numToDiscard, NULL, 10 );
-					if( nToDiscard >= ITEM_NUMS_MIN_SIZE && nToDiscard <= ITEM_NUMS_MAX_SIZE && isValidCID( cid ) ){
-						discardCopiesOfItem( nToDiscard, cid );
-					}
+				lockLibraryShared();
+				if( type == COMMAND_TYPE_OUT ){	
+					status = patronsWithItemOut( itemKey );
+				}
+				else{
+					status = getCopiesAvailable( itemKey );
 				}
+				unlockLibraryShared();
 			}
-			else if( strcmp( parsedCommand, OUT_COMMAND ) == 0 || strcmp( parsedCommand, AVAILABLE_ITEM_COMMAND ) == 0 ){
-				const char* uid = strtok( 0, DEFAULT_WORD_SEPARATORS );
-
-				if( uid != NULL ){
-					if( isValidCID( uid ) ){
-						if( strcmp( parsedCommand, OUT_COMMAND ) == 0 ){	
-							patronsWithItemOut( uid );
-						}
-						else{
-							getCopiesAvailable( uid );
-						}
-					}
-					else if( isValidPID( uid ) ){
-						itemsOutByPatron( uid );
-					}
+			else if( isValidPID( uid ) ){
+				PatronKey patronKey = encodePID( uid.start );
+
+				lockLibraryShared();
+				status = itemsOutByPatron( patronKey );
+				unlockLibraryShared();
+			}
+		}
+	}
+	else if( viewEquals( parsedCommand, SAVE_COMMAND ) || viewEquals( parsedCommand, LOAD_COMMAND ) ){
+		StringView pathToken;
+
+		if( nextToken( tokens, DEFAULT_WORD_SEPARATORS, &pathToken ) && pathToken.length < LINE_MAX_SIZE ){
+			char path[ LINE_MAX_SIZE ];
+
+			memcpy( path, pathToken.start, pathToken.length );
+			path[ pathToken.length ] = '\0';
+
+			lockLibrary();
+			if( viewEquals( parsedCommand, LOAD_COMMAND ) ){
+				if( loadSnapshot( path ) ){
+					journalLoad();
 				}
 			}
+			else if( isJournalFile( path ) ){
+				writeErrorMessage( "%s: in use by the journal, not saved\n", path );
+			}
+			else{
+				saveSnapshot( path );
+			}
+			unlockLibrary();
 		}
 	}
-	if( g_InputFile == NULL ){
-		// if using stdin then we need to print finising statuses of everything
-		printf("\n");
-		printAllListsStatus( );
+	else if( viewEquals( parsedCommand, CHECKPOINT_COMMAND ) ){
+		checkpointJournal();
+	}
+	else if( viewEquals( parsedCommand, STATS_COMMAND ) ){
+		writeCommandStats();
+	}
+
+	if( type != COMMAND_TYPES ){
+		recordCommand( type, status, startTime );
 	}
 }
 
@@ -110,49 +223,73 @@ void processInput(){
 * Processes patron command input line and 
 * calls addPatron function to create a new patron data.
 *
+* @tokens ------------------> Tokenizer positioned after the command word.
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
+*
+*/
+CommandStatus processPatronCommand( Tokenizer* tokens ){
+
+	PatronKey pid;
+	StringView truncatedName;
+
+	CommandStatus status = COMMAND_MALFORMED;
+
+	if( parsePatronCommand( tokens, &pid, &truncatedName ) ){
+		lockLibrary();
+		status = addPatron( pid, truncatedName );
+		unlockLibrary();
+	}
+	return status;
+}
+
+/*
+* parsePatronCommand
+* ----------------------------------
+*  
+* Parses the rest of a patron command input line.
+*
+* @tokens ------------------> Tokenizer positioned after the command word.
+* @pid ---------------------> Set to the encoded PID.
+* @truncatedName -----------> Set to the name, at most NAME_MAX_SIZE-1 chars of the input.
+*
+* @return ------------------> _Bool indicating if the whole command parsed.
 *
 */
-void processPatronCommand(){
+_Bool parsePatronCommand( Tokenizer* tokens, PatronKey* pid, StringView* truncatedName ){
 
-	const char* token = strtok( 0, DEFAULT_WORD_SEPARATORS );
-	char pid[ PID_MAX_SIZE ];
-	char truncatedName[ NAME_MAX_SIZE ];
+	StringView token;
+	_Bool haveToken = nextToken( tokens, DEFAULT_WORD_SEPARATORS, &token );
 
 	uint_least8_t tokensProcessed = 0;
 
-	for( ; tokensProcessed < 3 && token != NULL; tokensProcessed++ ){
+	for( ; tokensProcessed < 3 && haveToken; tokensProcessed++ ){
 		switch( tokensProcessed ){
 			case 0:
 			  {
 				if( isValidPID( token ) ){
-					strncpy( pid, token, PID_MAX_SIZE - 1 );
-					pid[ PID_MAX_SIZE - 1 ] = '\0';
+					*pid = encodePID( token.start );
 				}
 				else{
-					return;
+					return 0;
 				}
-				token = strtok( 0, QUOTE_WORD_SEPARATOR );
+				haveToken = nextToken( tokens, QUOTE_WORD_SEPARATOR, &token );
 				break;
 			  }
 			case 2:
 			  {
-				uint_least8_t nameLength = ( strlen( token ) >= NAME_MAX_SIZE ) ? getSizeToTrimTailTo( token, NAME_MAX_SIZE ) : strlen( token ) + 1;	
-				strncpy( truncatedName, token, nameLength -1 );
-				truncatedName[ nameLength - 1 ] = '\0';
+				*truncatedName = truncateToken( token, NAME_MAX_SIZE );
 			  }
 			default:
 			  {
-				token = strtok( 0, QUOTE_WORD_SEPARATOR );
+				haveToken = nextToken( tokens, QUOTE_WORD_SEPARATOR, &token );
 				break;
 			  }
 		}
 	}
 
-	if( truncatedName != NULL ){
-		addPatron( pid, truncatedName );
-	}
+	// name is the last token processed
+	return tokensProcessed == 3;
 }
 
 /*
@@ -162,83 +299,105 @@ void processPatronCommand(){
 * Processes item command input line and 
 * calls addItem function to create a new item data.
 *
+* @tokens ------------------> Tokenizer positioned after the command word.
 *
-* @return ------------------> None.
+* @return ------------------> How the command ended.
 *
 */
-void processItemCommand(){
+CommandStatus processItemCommand( Tokenizer* tokens ){
+
+	uint_least8_t numCopies;
+	ItemKey cid;
+	StringView truncatedAuthor;
+	StringView truncatedTitle;
 
-	const char* token = strtok( 0, DEFAULT_WORD_SEPARATORS );
-	char cid[ CID_MAX_SIZE ];
-	char truncatedAuthor[ AUTHOR_MAX_SIZE ];
-	char truncatedTitle[ TITLE_MAX_SIZE ];
-	long int numCopies = 0;
+	CommandStatus status = COMMAND_MALFORMED;
+
+	if( parseItemCommand( tokens, &numCopies, &cid, &truncatedAuthor, &truncatedTitle ) ){
+		lockLibrary();
+		status = addItem( numCopies, cid, truncatedAuthor, truncatedTitle );
+		unlockLibrary();
+	}
+	return status;
+}
+
+/*
+* parseItemCommand
+* ----------------------------------
+*  
+* Parses the rest of an item command input line.
+*
+* @tokens ------------------> Tokenizer positioned after the command word.
+* @numCopies ---------------> Set to the number of copies.
+* @cid ---------------------> Set to the encoded CID.
+* @truncatedAuthor ---------> Set to the author, at most AUTHOR_MAX_SIZE-1 chars of the input.
+* @truncatedTitle ----------> Set to the title, at most TITLE_MAX_SIZE-1 chars of the input.
+*
+* @return ------------------> _Bool indicating if the whole command parsed.
+*
+*/
+_Bool parseItemCommand( Tokenizer* tokens, uint_least8_t* numCopies, ItemKey* cid, StringView* truncatedAuthor, StringView* truncatedTitle ){
+
+	StringView token;
+	_Bool haveToken = nextToken( tokens, DEFAULT_WORD_SEPARATORS, &token );
 	uint_least8_t tokensProcessed = 0;
 
-	for( ; tokensProcessed < 6 && token != NULL; tokensProcessed++ ){
+	for( ; tokensProcessed < 6 && haveToken; tokensProcessed++ ){
 	
 		switch( tokensProcessed ){
 			case 0:
 			  {
 			  	// number of copies
-				numCopies = strtoul( token, NULL, 10 );
-				if(!(numCopies >= ITEM_NUMS_MIN_SIZE && numCopies <= ITEM_NUMS_MAX_SIZE) ){
-					return;
+				long int parsedCopies = viewToUnsigned( token );
+				if(!(parsedCopies >= ITEM_NUMS_MIN_SIZE && parsedCopies <= ITEM_NUMS_MAX_SIZE) ){
+					return 0;
 				}
+				*numCopies = parsedCopies;
 
-				token = strtok( 0, DEFAULT_WORD_SEPARATORS  );
+				haveToken = nextToken( tokens, DEFAULT_WORD_SEPARATORS, &token );
 				break;
 			  }
 			case 1:
 			  {
 				// CID
 				if( isValidCID( token ) ){
-
-					strncpy( cid, token, strlen( token ) );
-					cid[ strlen( token ) ] = '\0';
+					*cid = encodeCID( token.start, token.length );
 				}
 				else{
-					return;
+					return 0;
 				}
 			  }
 			case 2:
 			case 4:
 			  {
-				token = strtok( 0, QUOTE_WORD_SEPARATOR);
+				haveToken = nextToken( tokens, QUOTE_WORD_SEPARATOR, &token );
 				break;
 			  }
 			case 3:
 			  {
 			  	// author
-				uint_least8_t authorLength = ( strlen( token ) >= AUTHOR_MAX_SIZE ) ? getSizeToTrimTailTo( token, AUTHOR_MAX_SIZE ) : strlen( token ) + 1;	
-				
-				strncpy( truncatedAuthor, token, authorLength -1 );
-				truncatedAuthor[ authorLength - 1 ] = '\0';
+				*truncatedAuthor = truncateToken( token, AUTHOR_MAX_SIZE );
 
-				token = strtok( 0, QUOTE_WORD_SEPARATOR );
+				haveToken = nextToken( tokens, QUOTE_WORD_SEPARATOR, &token );
 				break;
 			  }
 			case 5:
 			  {
-				uint_least8_t titleLength = ( strlen( token ) >= TITLE_MAX_SIZE ) ? getSizeToTrimTailTo( token, TITLE_MAX_SIZE ) : strlen( token ) + 1;	
+				*truncatedTitle = truncateToken( token, TITLE_MAX_SIZE );
 
-				strncpy( truncatedTitle, token, titleLength -1 );
-				truncatedTitle[ titleLength - 1 ] = '\0';
-
-				token = strtok( 0, QUOTE_WORD_SEPARATOR );
+				haveToken = nextToken( tokens, QUOTE_WORD_SEPARATOR, &token );
 				break;
 			  }
 			default:
 			  {
-				token = strtok( 0, QUOTE_WORD_SEPARATOR );
+				haveToken = nextToken( tokens, QUOTE_WORD_SEPARATOR, &token );
 				break;
 			  }
 		}
 	}
 
-	if( truncatedAuthor != NULL && truncatedTitle != NULL ){
-		addItem( numCopies, cid, truncatedAuthor, truncatedTitle );
-	}
+	// title is the last token processed
+	return tokensProcessed == 6;
 }
 
 
@@ -246,28 +405,29 @@ void processItemCommand(){
 * isValidCID
 * ----------------------------------
 *  
-* Determines if a string is a valid CID.
+* Determines if a token is a valid CID.
 *
-* @cid -------------==------> Char* to be checked.
+* @cid -------------==------> Token to be checked.
 *
 * @return ------------------> uint_least8_t(1 or 0) indicating CID validity.
 *
 */
-uint_least8_t isValidCID( const char* cid ){
+uint_least8_t isValidCID( StringView cid ){
 
-	if( cid == NULL || strlen( cid ) < CID_MIN_SIZE-1 || strlen( cid ) > CID_MAX_SIZE-1 ){
+	if( cid.length < CID_MIN_SIZE-1 || cid.length > CID_MAX_SIZE-1 ){
 		return 0;
 	}
 
-	const char* periodLocationIterator = strchr( cid, PERIOD_WORD_SEPARATOR_CH );
+	const char* cidEnd = cid.start + cid.length;
+	const char* periodLocationIterator = memchr( cid.start, PERIOD_WORD_SEPARATOR_CH, cid.length );
 	if( periodLocationIterator == NULL ){
 		return 0;
 	}
 
-	const char* cidIt = cid;
+	const char* cidIt = cid.start;
 
 	while( cidIt != periodLocationIterator ){
-		if( !isdigit( *cidIt ) ){	
+		if( !isdigit( (unsigned char)*cidIt ) ){	
 			return 0;
 		}
 		++cidIt;
@@ -275,8 +435,8 @@ uint_least8_t isValidCID( const char* cid ){
 
 	cidIt = periodLocationIterator;
 
-	while( cidIt != &cid[ strlen( cid ) ]  ){
-		if( !isdigit( *cidIt ) && *cidIt != '.' ){	
+	while( cidIt != cidEnd ){
+		if( !isdigit( (unsigned char)*cidIt ) && *cidIt != '.' ){	
 			return 0;
 		}
 		++cidIt;
@@ -288,18 +448,18 @@ uint_least8_t isValidCID( const char* cid ){
 * isValidPID
 * ----------------------------------
 *  
-* Determines if a string is a valid PID.
+* Determines if a token is a valid PID.
 *
-* @pid -------------==------> Char* to be checked.
+* @pid -------------==------> Token to be checked.
 *
 * @return ------------------> uint_least8_t(1 or 0) indicating PID validity.
 *
 */
-uint_least8_t isValidPID( const char* pid ){
+uint_least8_t isValidPID( StringView pid ){
 
-	if( pid != NULL && isupper( pid[ 0 ] ) ){
+	if( pid.length >= PID_MAX_SIZE - 1 && isupper( (unsigned char)pid.start[ 0 ] ) ){
 		for( uint_least8_t i = 1; i < PID_MAX_SIZE - 1; ++i ){
-			if( !isdigit( pid[ i ] ) ){
+			if( !isdigit( (unsigned char)pid.start[ i ] ) ){
 				return 0;
 			}
 		}
@@ -308,6 +468,27 @@ uint_least8_t isValidPID( const char* pid ){
 	return 0;
 }
 
+/*
+* truncateToken
+* ----------------------------------
+*  
+* Shortens a token so it fits a string of maxCharsInString
+* including its \0. Tokens that are too long are cut down
+* with getSizeToTrimTailTo.
+*
+* @token -----------==------> Token to shorten.
+* @maxCharsInString -=------> Maximum number of chars token should be, counting \0.
+*
+* @return ------------------> View of the chars to keep.
+*
+*/
+StringView truncateToken( StringView token, uint_least8_t maxCharsInString ){
+
+	if( token.length >= maxCharsInString ){
+		token.length = getSizeToTrimTailTo( token.start, maxCharsInString ) - 1;
+	}
+	return token;
+}
 
 /*
 * getSizeToTrimTailTo
@@ -331,7 +512,7 @@ uint_least8_t getSizeToTrimTailTo( const char* token, uint_least8_t maxCharsInSt
 
 	uint_least8_t lastCharIndex = maxCharsInString - 2;
 
-	while( token[ lastCharIndex ] == ' ' ){
+	while( lastCharIndex > 0 && token[ lastCharIndex ] == ' ' ){
 		--lastCharIndex;
 	}
 
@@ -11,17 +11,26 @@
 * @author Greg Mojonnier
 */
 
+#include "ExecuteCommands.h"
+#include "LinkedDataNodeStructures.h"
+#include "Tokenizer.h"
+#include <stddef.h>
 #include <stdint.h>
 
 // Main input processing function
 void processInput( );
+void processLine( const char* line, size_t length );
+void processCommand( Tokenizer* tokens, StringView parsedCommand );
 
 // These start parsing tokens from where processInput left off after the 1st command token
 // These are pulled out in their own functions due to complexity
-void processPatronCommand();
-void processItemCommand();
+CommandStatus processPatronCommand( Tokenizer* tokens );
+CommandStatus processItemCommand( Tokenizer* tokens );
+_Bool parsePatronCommand( Tokenizer* tokens, PatronKey* pid, StringView* truncatedName );
+_Bool parseItemCommand( Tokenizer* tokens, uint_least8_t* numCopies, ItemKey* cid, StringView* truncatedAuthor, StringView* truncatedTitle );
 
-uint_least8_t isValidCID( const char* cid );
-uint_least8_t isValidPID( const char* pid );
+uint_least8_t isValidCID( StringView cid );
+uint_least8_t isValidPID( StringView pid );
+StringView truncateToken( StringView token, uint_least8_t maxCharsInString );
 uint_least8_t getSizeToTrimTailTo( const char* token, uint_least8_t maxCharsInString );
 #endif
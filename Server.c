@@ -0,0 +1,669 @@
+/*
+* This file contains methods which serve the library's commands
+* over a Unix domain socket. Every socket is non-blocking. Each
+* server thread runs an epoll loop over the clients it accepted
+* from the shared listening socket. A client's output is gathered
+* in its own pending buffer and sent as fast as the client reads
+* it, a client that stops reading stops having its commands run.
+*
+* Memory is only allocated when a client connects or disconnects
+* and then with the library held exclusively, since the allocate
+* library may be in use by a command on another thread.
+*
+*
+* @author Greg Mojonnier
+*/
+
+// sockets, sigaction and friends are POSIX, not part of c99
+#define _POSIX_C_SOURCE 200809L
+
+#include "Server.h"
+#include "SanitizeInput.h"
+#include "OutputWriter.h"
+#include "Journal.h"
+#include "LibraryLocks.h"
+#include "CommandStats.h"
+#include <allocate.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "AllConstants.h"
+
+/*
+* Data Structure: ClientConnection
+* ----------------------------------
+*
+* One connected client, kept in a doubly linked list
+* of the clients of the thread that accepted it.
+*
+* @socket ------------------> Client's socket.
+* @events ------------------> Epoll events currently asked for.
+* @input -------------------> Chars received but not yet processed.
+* @inputStart --------------> Index of first unprocessed char in input.
+* @inputLength -------------> Number of unprocessed chars.
+* @line --------------------> Start of a command line still being received.
+* @lineLength --------------> Number of chars in line.
+* @pending -----------------> Output not yet sent.
+* @pendingStart ------------> Index of first unsent char in pending.
+* @pendingLength -----------> Number of unsent chars.
+* @isFinished --------------> Client has sent everything it will send.
+* @isBroken ----------------> Connection failed, or its output overflowed.
+* @next --------------------> Next client.
+* @previous ----------------> Previous client.
+*
+*/
+typedef struct ClientConnection {
+	int socket;
+	uint32_t events;
+	char input[ SERVER_READ_SIZE ];
+	size_t inputStart;
+	size_t inputLength;
+	char line[ LINE_MAX_SIZE ];
+	size_t lineLength;
+	char pending[ SERVER_PENDING_SIZE ];
+	size_t pendingStart;
+	size_t pendingLength;
+	_Bool isFinished;
+	_Bool isBroken;
+	struct ClientConnection* next;
+	struct ClientConnection* previous;
+} ClientConnection;
+
+/*
+* Data Structure: ServerThread
+* ----------------------------------
+*
+* Everything one server thread works with.
+*
+* @thread ------------------> The thread, unused for the thread runServer was called on.
+* @listener ----------------> Listening socket, shared by every thread.
+* @eventQueue --------------> This thread's epoll instance.
+* @clients -----------------> Clients this thread accepted.
+*
+*/
+typedef struct {
+	pthread_t thread;
+	int listener;
+	int eventQueue;
+	ClientConnection* clients;
+} ServerThread;
+
+// SIGINT and SIGTERM write to this pipe, which every thread watches
+static int s_StopPipe[ 2 ] = { -1, -1 };
+
+/*
+* stopServer
+* ----------------------------------
+*
+* Signal handler which asks every event loop to stop.
+*
+* @signalNumber ------------> Signal caught.
+*
+* @return ------------------> None.
+*
+*/
+static void stopServer( int signalNumber ){
+
+	int savedErrno = errno;
+
+	(void)signalNumber;
+
+	if( write( s_StopPipe[ 1 ], "", 1 ) < 0 ){
+		// the pipe already holds a byte, which is all it takes
+	}
+	errno = savedErrno;
+}
+
+/*
+* getNumServerThreads
+* ----------------------------------
+*
+* Determines how many threads serve clients, one per online processor.
+*
+*
+* @return ------------------> Number of threads, between 1 and SERVER_MAX_THREADS.
+*
+*/
+static int getNumServerThreads(){
+
+	long numProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+
+	if( numProcessors < 1 ){
+		return 1;
+	}
+	return ( numProcessors > SERVER_MAX_THREADS ) ? SERVER_MAX_THREADS : (int)numProcessors;
+}
+
+/*
+* openListeningSocket
+* ----------------------------------
+*
+* Creates the server's socket at socketPath, replacing a socket
+* left there by a server that did not shut down, but nothing else.
+*
+* @socketPath --------------> Path to listen on.
+*
+* @return ------------------> Non-blocking listening socket, or -1 on failure.
+*
+*/
+static int openListeningSocket( const char* socketPath ){
+
+	struct sockaddr_un address;
+	struct stat fileInfo;
+
+	if( strlen( socketPath ) >= sizeof( address.sun_path ) ){
+		fprintf( stderr, "%s: socket path is too long\n", socketPath );
+		return -1;
+	}
+	if( stat( socketPath, &fileInfo ) == 0 && S_ISSOCK( fileInfo.st_mode ) ){
+		unlink( socketPath );
+	}
+
+	int listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+	if( listener < 0 ){
+		perror( "socket" );
+		return -1;
+	}
+
+	memset( &address, 0, sizeof( address ) );
+	address.sun_family = AF_UNIX;
+	strcpy( address.sun_path, socketPath );
+
+	if( bind( listener, (struct sockaddr*)&address, sizeof( address ) ) != 0 || listen( listener, SERVER_LISTEN_BACKLOG ) != 0 || fcntl( listener, F_SETFL, O_NONBLOCK ) != 0 ){
+		perror( socketPath );
+		close( listener );
+		return -1;
+	}
+	return listener;
+}
+
+/*
+* appendClientOutput
+* ----------------------------------
+*
+* OutputSink write for a client, appends flushed output
+* to the client's pending buffer.
+*
+* @context -----------------> ClientConnection the output is for.
+* @chars -------------------> Chars flushed.
+* @length ------------------> Number of chars flushed.
+*
+* @return ------------------> None.
+*
+*/
+static void appendClientOutput( void* context, const char* chars, size_t length ){
+
+	ClientConnection* client = (ClientConnection*)context;
+
+	if( client->pendingStart + client->pendingLength + length > SERVER_PENDING_SIZE ){
+		memmove( client->pending, client->pending + client->pendingStart, client->pendingLength );
+		client->pendingStart = 0;
+	}
+
+	// only possible if a command wrote more than SERVER_OUTPUT_RESERVE
+	if( client->pendingLength + length > SERVER_PENDING_SIZE ){
+		client->isBroken = 1;
+		return;
+	}
+
+	memcpy( client->pending + client->pendingStart + client->pendingLength, chars, length );
+	client->pendingLength += length;
+}
+
+/*
+* hasRoomForCommand
+* ----------------------------------
+*
+* Determines if a client's pending buffer can take the
+* output of another command.
+*
+* @client ------------------> Client to check.
+*
+* @return ------------------> _Bool indicating if another command may run.
+*
+*/
+static _Bool hasRoomForCommand( const ClientConnection* client ){
+	return SERVER_PENDING_SIZE - client->pendingLength >= SERVER_OUTPUT_RESERVE;
+}
+
+/*
+* acceptClients
+* ----------------------------------
+*
+* Accepts every client waiting on the listening socket
+* and starts watching each for commands on this thread.
+*
+* @server ------------------> Thread accepting.
+*
+* @return ------------------> None.
+*
+*/
+static void acceptClients( ServerThread* server ){
+
+	for( ;; ){
+		int clientSocket = accept( server->listener, NULL, NULL );
+
+		if( clientSocket < 0 ){
+			if( errno == EINTR ){
+				continue;
+			}
+			if( errno != EAGAIN && errno != EWOULDBLOCK ){
+				perror( "accept" );
+			}
+			return;
+		}
+
+		lockLibrary();
+		ClientConnection* client = (ClientConnection*) allocate( sizeof( ClientConnection ) );
+		unlockLibrary();
+
+		if( client == NULL ){
+			fputs( "Memory allocation failed!\n", stderr );
+			close( clientSocket );
+			continue;
+		}
+
+		// the buffers are left as they are, only how much of them is used is set
+		client->socket = clientSocket;
+		client->events = EPOLLIN;
+		client->inputStart = client->inputLength = client->lineLength = 0;
+		client->pendingStart = client->pendingLength = 0;
+		client->isFinished = client->isBroken = 0;
+		client->previous = NULL;
+
+		struct epoll_event event = { client->events, { .ptr = client } };
+
+		if( fcntl( clientSocket, F_SETFL, O_NONBLOCK ) != 0 || epoll_ctl( server->eventQueue, EPOLL_CTL_ADD, clientSocket, &event ) != 0 ){
+			perror( "accept" );
+			close( clientSocket );
+			lockLibrary();
+			unallocate( client );
+			unlockLibrary();
+			continue;
+		}
+
+		client->next = server->clients;
+		if( server->clients != NULL ){
+			server->clients->previous = client;
+		}
+		server->clients = client;
+	}
+}
+
+/*
+* closeClient
+* ----------------------------------
+*
+* Disconnects a client and frees it.
+*
+* @server ------------------> Thread the client belongs to.
+* @client ------------------> Client to close.
+*
+* @return ------------------> None.
+*
+*/
+static void closeClient( ServerThread* server, ClientConnection* client ){
+
+	if( client->previous != NULL ){
+		client->previous->next = client->next;
+	}
+	else{
+		server->clients = client->next;
+	}
+	if( client->next != NULL ){
+		client->next->previous = client->previous;
+	}
+
+	// a checkpoint's child may hold a copy of the socket, so closing
+	// it would not be enough to take it out of the event queue
+	epoll_ctl( server->eventQueue, EPOLL_CTL_DEL, client->socket, NULL );
+	close( client->socket );
+	lockLibrary();
+	unallocate( client );
+	unlockLibrary();
+}
+
+/*
+* receiveClientInput
+* ----------------------------------
+*
+* Reads whatever the client has sent into its input buffer.
+* A client which has finished sending has its last line
+* processed even without a \n, as the last line of stdin would be.
+*
+* @client ------------------> Client to read from, with its input buffer empty.
+*
+* @return ------------------> _Bool indicating if any input arrived.
+*
+*/
+static _Bool receiveClientInput( ClientConnection* client ){
+
+	for( ;; ){
+		ssize_t numRead = read( client->socket, client->input, SERVER_READ_SIZE );
+
+		if( numRead > 0 ){
+			client->inputStart = 0;
+			client->inputLength = numRead;
+			return 1;
+		}
+		if( numRead == 0 ){
+			if( client->lineLength > 0 ){
+				processLine( client->line, client->lineLength );
+				client->lineLength = 0;
+			}
+			client->isFinished = 1;
+			return 0;
+		}
+		if( errno == EINTR ){
+			continue;
+		}
+		if( errno != EAGAIN && errno != EWOULDBLOCK ){
+			client->isBroken = 1;
+		}
+		return 0;
+	}
+}
+
+/*
+* processClientLine
+* ----------------------------------
+*
+* Takes the next line, or the next piece of one, out of the
+* client's input buffer and processes it once it is complete.
+* Lines are split the way fgets splits stdin, LINE_MAX_SIZE - 1
+* chars at most. A line received whole is processed where it lies.
+*
+* @client ------------------> Client with input waiting.
+*
+* @return ------------------> None.
+*
+*/
+static void processClientLine( ClientConnection* client ){
+
+	const char* input = client->input + client->inputStart;
+	size_t roomLeft = LINE_MAX_SIZE - 1 - client->lineLength;
+	size_t numToSearch = ( client->inputLength < roomLeft ) ? client->inputLength : roomLeft;
+	const char* newLine = memchr( input, '\n', numToSearch );
+	size_t numToTake = ( newLine != NULL ) ? (size_t)( newLine + 1 - input ) : numToSearch;
+
+	client->inputStart += numToTake;
+	client->inputLength -= numToTake;
+
+	if( client->lineLength == 0 && newLine != NULL ){
+		processLine( input, numToTake );
+		return;
+	}
+
+	memcpy( client->line + client->lineLength, input, numToTake );
+	client->lineLength += numToTake;
+
+	if( newLine != NULL || client->lineLength == LINE_MAX_SIZE - 1 ){
+		processLine( client->line, client->lineLength );
+		client->lineLength = 0;
+	}
+}
+
+/*
+* runClientCommands
+* ----------------------------------
+*
+* Runs the client's commands, with all output and error
+* messages going to its pending buffer, until it has sent no
+* more or its pending buffer is too full to run another.
+*
+* @client ------------------> Client to serve.
+*
+* @return ------------------> _Bool indicating if commands stopped for want of room.
+*
+*/
+static _Bool runClientCommands( ClientConnection* client ){
+
+	OutputSink sink = { appendClientOutput, client, NULL };
+	_Bool isOutOfRoom = 0;
+
+	setOutputSink( &sink );
+
+	while( !client->isFinished && !client->isBroken ){
+		if( !hasRoomForCommand( client ) ){
+			isOutOfRoom = 1;
+			break;
+		}
+		if( client->inputLength == 0 && !receiveClientInput( client ) ){
+			break;
+		}
+		processClientLine( client );
+
+		// one command's output at a time, so the room check stays honest
+		flushOutput();
+	}
+
+	// the client must not see a change answered before it is in the journal
+	commitJournal();
+	setOutputSink( NULL );
+	return isOutOfRoom;
+}
+
+/*
+* sendClientOutput
+* ----------------------------------
+*
+* Sends as much pending output as the client will take.
+*
+* @client ------------------> Client to send to.
+*
+* @return ------------------> None.
+*
+*/
+static void sendClientOutput( ClientConnection* client ){
+
+	while( !client->isBroken && client->pendingLength > 0 ){
+		ssize_t numSent = send( client->socket, client->pending + client->pendingStart, client->pendingLength, MSG_NOSIGNAL );
+
+		if( numSent < 0 ){
+			if( errno == EINTR ){
+				continue;
+			}
+			if( errno != EAGAIN && errno != EWOULDBLOCK ){
+				client->isBroken = 1;
+			}
+			break;
+		}
+		client->pendingStart += numSent;
+		client->pendingLength -= numSent;
+	}
+	if( client->pendingLength == 0 ){
+		client->pendingStart = 0;
+	}
+}
+
+/*
+* serveClient
+* ----------------------------------
+*
+* Runs a client's commands and sends their output, for as long
+* as the client keeps taking its output. Afterwards the client
+* is watched for more commands if it has room for their output
+* and for room to send if output is left over.
+*
+* @server ------------------> Thread the client belongs to.
+* @client ------------------> Client to serve.
+*
+* @return ------------------> _Bool indicating whether the client stays connected.
+*
+*/
+static _Bool serveClient( ServerThread* server, ClientConnection* client ){
+
+	_Bool isOutOfRoom;
+
+	do{
+		isOutOfRoom = runClientCommands( client );
+		sendClientOutput( client );
+	} while( isOutOfRoom && !client->isBroken && client->pendingLength == 0 );
+
+	if( client->isBroken || ( client->isFinished && client->pendingLength == 0 ) ){
+		return 0;
+	}
+
+	uint32_t events = ( !client->isFinished && hasRoomForCommand( client ) ? EPOLLIN : 0 ) | ( client->pendingLength > 0 ? EPOLLOUT : 0 );
+
+	if( events != client->events ){
+		struct epoll_event event = { events, { .ptr = client } };
+
+		if( epoll_ctl( server->eventQueue, EPOLL_CTL_MOD, client->socket, &event ) != 0 ){
+			return 0;
+		}
+		client->events = events;
+	}
+	return 1;
+}
+
+/*
+* runEventLoop
+* ----------------------------------
+*
+* One server thread, serves its clients and accepts new ones
+* until the server is stopped, then disconnects its clients.
+* Between batches of events a finished checkpoint is picked
+* up or a new one started.
+*
+* @argument ----------------> ServerThread to run.
+*
+* @return ------------------> NULL.
+*
+*/
+static void* runEventLoop( void* argument ){
+
+	ServerThread* server = (ServerThread*)argument;
+	struct epoll_event events[ SERVER_MAX_EVENTS ];
+	_Bool isStopping = 0;
+
+	while( !isStopping ){
+		int numEvents = epoll_wait( server->eventQueue, events, SERVER_MAX_EVENTS, SERVER_POLL_TIMEOUT_MS );
+
+		if( numEvents < 0 ){
+			if( errno == EINTR ){
+				continue;
+			}
+			perror( "epoll_wait" );
+			break;
+		}
+
+		for( int i = 0; i < numEvents; ++i ){
+			ClientConnection* client = (ClientConnection*)events[ i ].data.ptr;
+
+			if( client == NULL ){
+				acceptClients( server );
+			}
+			else if( client == (ClientConnection*)s_StopPipe ){
+				isStopping = 1;
+			}
+			else if( !serveClient( server, client ) ){
+				closeClient( server, client );
+			}
+		}
+		pollJournalCheckpoint();
+		pollCommandStats();
+
+		// what the journal reports between commands has no client to go to
+		flushOutput();
+	}
+
+	while( server->clients != NULL ){
+		closeClient( server, server->clients );
+	}
+	return NULL;
+}
+
+/*
+* runServer
+* ----------------------------------
+*
+* Listens on socketPath and serves every client that connects
+* until SIGINT or SIGTERM arrives, on one thread per processor.
+* The calling thread is one of them.
+*
+* @socketPath --------------> Path of the Unix domain socket to create.
+*
+* @return ------------------> _Bool indicating whether the server could start.
+*
+*/
+_Bool runServer( const char* socketPath ){
+
+	int listener = openListeningSocket( socketPath );
+
+	if( listener < 0 ){
+		return 0;
+	}
+
+	if( pipe( s_StopPipe ) != 0 ){
+		perror( "pipe" );
+		close( listener );
+		unlink( socketPath );
+		return 0;
+	}
+	fcntl( s_StopPipe[ 1 ], F_SETFL, O_NONBLOCK );
+
+	struct sigaction stopAction;
+
+	memset( &stopAction, 0, sizeof( stopAction ) );
+	stopAction.sa_handler = stopServer;
+	sigemptyset( &stopAction.sa_mask );
+	sigaction( SIGINT, &stopAction, NULL );
+	sigaction( SIGTERM, &stopAction, NULL );
+
+	ServerThread servers[ SERVER_MAX_THREADS ];
+	int numServers = getNumServerThreads();
+	int numStarted = 0;
+
+	while( numStarted < numServers ){
+		ServerThread* server = &servers[ numStarted ];
+
+		// only one thread is woken for each client connecting, but every one to stop
+		struct epoll_event listenerEvent = { EPOLLIN | EPOLLEXCLUSIVE, { .ptr = NULL } };
+		struct epoll_event stopEvent = { EPOLLIN, { .ptr = s_StopPipe } };
+
+		server->listener = listener;
+		server->clients = NULL;
+		server->eventQueue = epoll_create1( 0 );
+
+		if( server->eventQueue < 0 || epoll_ctl( server->eventQueue, EPOLL_CTL_ADD, listener, &listenerEvent ) != 0
+		    || epoll_ctl( server->eventQueue, EPOLL_CTL_ADD, s_StopPipe[ 0 ], &stopEvent ) != 0 ){
+			perror( "epoll" );
+			if( server->eventQueue >= 0 ){
+				close( server->eventQueue );
+			}
+			break;
+		}
+		if( numStarted > 0 && pthread_create( &server->thread, NULL, runEventLoop, server ) != 0 ){
+			close( server->eventQueue );
+			break;
+		}
+		++numStarted;
+	}
+
+	if( numStarted > 0 ){
+		runEventLoop( &servers[ 0 ] );
+	}
+
+	for( int i = 0; i < numStarted; ++i ){
+		if( i > 0 ){
+			pthread_join( servers[ i ].thread, NULL );
+		}
+		close( servers[ i ].eventQueue );
+	}
+	close( s_StopPipe[ 0 ] );
+	close( s_StopPipe[ 1 ] );
+	close( listener );
+	unlink( socketPath );
+	return numStarted > 0;
+}
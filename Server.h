@@ -0,0 +1,37 @@
+#ifndef SERVER_H
+#define SERVER_H
+/*
+* This file contains methods which serve the library's commands
+* to any number of clients over a Unix domain socket. Each client
+* sends command lines just as they would be typed on stdin and
+* gets back that command's output and error messages. Every
+* thread runs its own epoll loop over the clients it accepted,
+* so a client's commands run in order on one thread while other
+* clients' commands run alongside them, under LibraryLocks.h.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#define SERVER_MAX_THREADS 16
+
+// Most events handled per epoll_wait
+#define SERVER_MAX_EVENTS 64
+
+#define SERVER_LISTEN_BACKLOG 64
+
+// Chars read from a client at a time
+#define SERVER_READ_SIZE 4096
+
+// Output waiting for a client, once less than SERVER_OUTPUT_RESERVE
+// is free no more of its commands run until it reads some, the
+// reserve being more than any one command writes
+#define SERVER_PENDING_SIZE 65536
+#define SERVER_OUTPUT_RESERVE 8192
+
+// Longest the loop sleeps, so a finished checkpoint is noticed while idle
+#define SERVER_POLL_TIMEOUT_MS 1000
+
+// Serves commands on socketPath until SIGINT or SIGTERM
+_Bool runServer( const char* socketPath );
+#endif
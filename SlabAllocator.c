@@ -0,0 +1,190 @@
+/*
+* This file contains methods which hand out the skip list
+* nodes that keep the library's records in order. Nodes are
+* only allocated with the library held exclusively.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "SlabAllocator.h"
+#include <allocate.h>
+
+/*
+* Data Structure: Slab
+* ----------------------------------
+*
+* Header at the start of every slab, objects follow it.
+*
+* @next ------------------> Next slab of the same pool.
+*
+*/
+typedef union _Slab {
+	union _Slab* next;
+	// keeps the objects after the header aligned
+	long double alignment;
+} Slab;
+
+/*
+* Data Structure: SlabPool
+* ----------------------------------
+*
+* Every object of one size class.
+*
+* @objectSize ------------> Size of each object, at least a pointer.
+* @freeList --------------> Objects given back, each holds a pointer to the next.
+* @slabs -----------------> Every slab of this pool.
+* @nextUnused ------------> Next never used object of the newest slab.
+* @slabEnd ---------------> End of the newest slab.
+*
+*/
+typedef struct {
+	size_t objectSize;
+	void* freeList;
+	Slab* slabs;
+	char* nextUnused;
+	char* slabEnd;
+} SlabPool;
+
+#define SLAB_POOL( size ) { ( ( (size) + sizeof( void* ) - 1 ) / sizeof( void* ) ) * sizeof( void* ), NULL, NULL, NULL, NULL }
+
+// one pool per skip list level since nodes only hold the next pointers they use
+static SlabPool s_ListNodePools[ SKIP_LIST_MAX_LEVEL ];
+
+/*
+* slabAllocate
+* ----------------------------------
+*  
+* Hands out an object from the pool. A freed object is
+* reused first, otherwise the newest slab is carved further
+* and a new slab is taken once it runs out.
+*
+* @pool --------------------> Pool to allocate from.
+*
+* @return ------------------> Pointer to the object, or NULL.
+*
+*/
+static void* slabAllocate( SlabPool* pool ){
+
+	if( pool->freeList != NULL ){
+		void* object = pool->freeList;
+		pool->freeList = *(void**)object;
+		return object;
+	}
+
+	if( pool->nextUnused == NULL || pool->nextUnused + pool->objectSize > pool->slabEnd ){
+		Slab* slab = (Slab*) allocate( SLAB_SIZE );
+		if( slab == NULL ){
+			return NULL;
+		}
+		slab->next = pool->slabs;
+		pool->slabs = slab;
+		pool->nextUnused = (char*)( slab + 1 );
+		pool->slabEnd = (char*)slab + SLAB_SIZE;
+	}
+
+	void* object = pool->nextUnused;
+	pool->nextUnused += pool->objectSize;
+	return object;
+}
+
+/*
+* slabFree
+* ----------------------------------
+*  
+* Gives an object back to its pool's free list.
+*
+* @pool --------------------> Pool object came from.
+* @object ------------------> Object to give back.
+*
+* @return ------------------> None.
+*
+*/
+static void slabFree( SlabPool* pool, void* object ){
+
+	if( object == NULL ){
+		return;
+	}
+	*(void**)object = pool->freeList;
+	pool->freeList = object;
+}
+
+/*
+* slabReleaseAll
+* ----------------------------------
+*  
+* Unallocates every slab of a pool and empties it.
+*
+* @pool --------------------> Pool to release.
+*
+* @return ------------------> None.
+*
+*/
+static void slabReleaseAll( SlabPool* pool ){
+
+	Slab* slab = pool->slabs;
+	while( slab != NULL ){
+		Slab* next = slab->next;
+		unallocate( slab );
+		slab = next;
+	}
+	pool->freeList = NULL;
+	pool->slabs = NULL;
+	pool->nextUnused = NULL;
+	pool->slabEnd = NULL;
+}
+
+/*
+* allocateListNode
+* ----------------------------------
+*  
+* Hands out a ListNode with room for level next pointers.
+*
+* @level -------------------> Skip list level of the node, 1 to SKIP_LIST_MAX_LEVEL.
+*
+* @return ------------------> Pointer to the node, or NULL.
+*
+*/
+ListNode* allocateListNode( uint_least8_t level ){
+
+	SlabPool* pool = &s_ListNodePools[ level - 1 ];
+	if( pool->objectSize == 0 ){
+		SlabPool levelPool = SLAB_POOL( sizeof( ListNode ) + sizeof( ListNode* ) * level );
+		*pool = levelPool;
+	}
+	return (ListNode*) slabAllocate( pool );
+}
+
+/*
+* freeListNode
+* ----------------------------------
+*  
+* Gives a ListNode back to the pool for its level.
+*
+* @node --------------------> Node to give back.
+*
+* @return ------------------> None.
+*
+*/
+void freeListNode( ListNode* node ){
+	if( node != NULL ){
+		slabFree( &s_ListNodePools[ node->level - 1 ], node );
+	}
+}
+
+/*
+* releaseAllSlabs
+* ----------------------------------
+*  
+* Gives every slab of every pool back to the allocate library.
+*
+*
+* @return ------------------> None.
+*
+*/
+void releaseAllSlabs(){
+
+	for( uint_least8_t i = 0; i < SKIP_LIST_MAX_LEVEL; ++i ){
+		slabReleaseAll( &s_ListNodePools[ i ] );
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+/*
+* This file contains methods which hand out the skip list
+* nodes that keep the library's records in order.
+* Memory is taken from the allocate library in large slabs,
+* each slab is carved into objects of a single size class and
+* freed objects are kept on a free list for reuse.
+* All slabs are given back at once by releaseAllSlabs.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "LinkedDataNodeStructures.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define SLAB_SIZE 16384
+
+ListNode* allocateListNode( uint_least8_t level );
+void freeListNode( ListNode* node );
+
+// Gives every slab back, any object handed out is invalid afterwards
+void releaseAllSlabs( );
+#endif
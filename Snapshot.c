@@ -0,0 +1,527 @@
+/*
+* This file contains methods which save the whole library,
+* patrons, items and loans, to a binary snapshot file and
+* load it back. Loading maps the file, checks all of it before
+* anything is touched and then rebuilds the lists in one pass.
+*
+*
+* @author Greg Mojonnier
+*/
+
+// mmap, fileno and fsync are POSIX, not part of c99
+#define _POSIX_C_SOURCE 200809L
+
+#include "Snapshot.h"
+#include "ExecuteCommands.h"
+#include "LinkedDataNodeOperations.h"
+#include "RecordStore.h"
+#include "OutputWriter.h"
+#include <allocate.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AllConstants.h"
+
+extern OrderedList g_PatronsList;
+extern OrderedList g_ItemsList;
+
+#define SNAPSHOT_CHECKSUM_SEED 2166136261u
+#define SNAPSHOT_CHECKSUM_PRIME 16777619u
+
+/*
+* Data Structure: SnapshotWriter
+* ----------------------------------
+*
+* File being saved to and the checksum of what has been written so far.
+*
+* @file ------------------> File being saved to.
+* @checksum --------------> Checksum of everything written through writeSnapshotBytes.
+* @failed ----------------> Set once any write fails.
+*
+*/
+typedef struct {
+	FILE* file;
+	uint32_t checksum;
+	_Bool failed;
+} SnapshotWriter;
+
+/*
+* addToChecksum
+* ----------------------------------
+*
+* Adds bytes to an FNV-1a checksum.
+*
+* @checksum ----------------> Checksum so far.
+* @bytes -------------------> Bytes to add.
+* @size --------------------> Number of bytes.
+*
+* @return ------------------> New checksum.
+*
+*/
+static uint32_t addToChecksum( uint32_t checksum, const void* bytes, size_t size ){
+
+	const unsigned char* byte = (const unsigned char*)bytes;
+	const unsigned char* end = byte + size;
+
+	while( byte != end ){
+		checksum = ( checksum ^ *byte++ ) * SNAPSHOT_CHECKSUM_PRIME;
+	}
+	return checksum;
+}
+
+/*
+* writeSnapshotBytes
+* ----------------------------------
+*
+* Writes bytes to the snapshot and adds them to its checksum.
+*
+* @writer ------------------> Snapshot being saved.
+* @bytes -------------------> Bytes to write.
+* @size --------------------> Number of bytes.
+*
+* @return ------------------> None.
+*
+*/
+static void writeSnapshotBytes( SnapshotWriter* writer, const void* bytes, size_t size ){
+
+	writer->checksum = addToChecksum( writer->checksum, bytes, size );
+	if( fwrite( bytes, 1, size, writer->file ) != size ){
+		writer->failed = 1;
+	}
+}
+
+/*
+* syncDirectoryOf
+* ----------------------------------
+*  
+* Fsyncs the directory holding path, so that a file just
+* created or renamed to path is still there after a crash.
+*
+* @path --------------------> File whose directory is synced.
+*
+* @return ------------------> _Bool indicating success or failure, errno tells why.
+*
+*/
+_Bool syncDirectoryOf( const char* path ){
+
+	const char* lastSlash = strrchr( path, '/' );
+	size_t length = ( lastSlash == NULL ) ? 0 : ( lastSlash == path ) ? 1 : (size_t)( lastSlash - path );
+	char directoryPath[ length + sizeof( "." ) ];
+
+	if( lastSlash == NULL ){
+		strcpy( directoryPath, "." );
+	}
+	else{
+		memcpy( directoryPath, path, length );
+		directoryPath[ length ] = '\0';
+	}
+
+	int directory = open( directoryPath, O_RDONLY | O_DIRECTORY );
+
+	if( directory < 0 ){
+		return 0;
+	}
+
+	_Bool isSynced = ( fsync( directory ) == 0 );
+	int error = errno;
+
+	close( directory );
+	errno = error;
+	return isSynced;
+}
+
+/*
+* saveSnapshot
+* ----------------------------------
+*
+* Saves every patron, item and loan to a snapshot file. The
+* snapshot is written next to path and only renamed over it
+* once it is complete, so path is never left half written, and
+* the rename is synced so path cannot go back to what it was.
+*
+* @path --------------------> File to save to.
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+_Bool saveSnapshot( const char* path ){
+
+	SnapshotHeader header;
+	uint_least64_t stringsSize = 0;
+
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) );
+	header.version = SNAPSHOT_VERSION;
+
+	for( ListNode* node = g_PatronsList.head[ 0 ]; node != NULL; node = node->next[ 0 ] ){
+		RecordHandle patron = node->record;
+
+		++header.numPatrons;
+		header.numLoans += g_PatronRecords.numItemsOut[ patron ];
+		stringsSize += HEAP_STRING_LENGTH( PATRON_NAME( patron ) ) + 1;
+	}
+	for( ListNode* node = g_ItemsList.head[ 0 ]; node != NULL; node = node->next[ 0 ] ){
+		RecordHandle item = node->record;
+
+		++header.numItems;
+		stringsSize += HEAP_STRING_LENGTH( ITEM_AUTHOR( item ) ) + 1 + HEAP_STRING_LENGTH( ITEM_TITLE( item ) ) + 1;
+	}
+
+	if( stringsSize > UINT32_MAX ){
+		writeErrorMessage( "%s: library is too large for a snapshot\n", path );
+		return 0;
+	}
+	header.stringsSize = stringsSize;
+
+	// where each item sits in the list, by handle, for saving loans
+	uint32_t* itemIndexes = NULL;
+	if( header.numItems > 0 ){
+		itemIndexes = (uint32_t*) allocate( sizeof( uint32_t ) * g_ItemRecords.numRecords );
+		if( itemIndexes == NULL ){
+			writeOutputString( "Memory allocation failed!\n" );
+			return 0;
+		}
+	}
+
+	char tempPath[ strlen( path ) + sizeof( ".tmp" ) ];
+	strcpy( tempPath, path );
+	strcat( tempPath, ".tmp" );
+
+	SnapshotWriter writer = { fopen( tempPath, "wb" ), SNAPSHOT_CHECKSUM_SEED, 0 };
+	if( writer.file == NULL ){
+		writeErrorMessage( "%s: %s\n", tempPath, strerror( errno ) );
+		if( itemIndexes != NULL ){
+			unallocate( itemIndexes );
+		}
+		return 0;
+	}
+
+	// the real header is written over this once the checksum is known
+	if( fwrite( &header, sizeof( header ), 1, writer.file ) != 1 ){
+		writer.failed = 1;
+	}
+
+	uint32_t stringOffset = 0;
+
+	for( ListNode* node = g_PatronsList.head[ 0 ]; node != NULL; node = node->next[ 0 ] ){
+		RecordHandle patron = node->record;
+		SnapshotPatron record = { g_PatronRecords.pids[ patron ], stringOffset };
+
+		stringOffset += HEAP_STRING_LENGTH( PATRON_NAME( patron ) ) + 1;
+		writeSnapshotBytes( &writer, &record, sizeof( record ) );
+	}
+
+	uint32_t numItems = 0;
+
+	for( ListNode* node = g_ItemsList.head[ 0 ]; node != NULL; node = node->next[ 0 ] ){
+		RecordHandle item = node->record;
+		SnapshotItem record = { g_ItemRecords.cids[ item ], stringOffset, stringOffset + HEAP_STRING_LENGTH( ITEM_AUTHOR( item ) ) + 1, g_ItemRecords.numCopies[ item ] };
+
+		stringOffset = record.titleOffset + HEAP_STRING_LENGTH( ITEM_TITLE( item ) ) + 1;
+		itemIndexes[ item ] = numItems++;
+		writeSnapshotBytes( &writer, &record, sizeof( record ) );
+	}
+
+	uint32_t patronIndex = 0;
+
+	for( ListNode* node = g_PatronsList.head[ 0 ]; node != NULL; node = node->next[ 0 ] ){
+		for( LoanHandle loan = g_PatronRecords.loans[ node->record ]; loan != NO_LOAN; loan = LOAN_RECORD( loan )->nextPatronsLoan ){
+			SnapshotLoan record = { patronIndex, itemIndexes[ LOAN_RECORD( loan )->item ] };
+			writeSnapshotBytes( &writer, &record, sizeof( record ) );
+		}
+		++patronIndex;
+	}
+
+	for( ListNode* node = g_PatronsList.head[ 0 ]; node != NULL; node = node->next[ 0 ] ){
+		const char* name = PATRON_NAME( node->record );
+		writeSnapshotBytes( &writer, name, HEAP_STRING_LENGTH( name ) + 1 );
+	}
+	for( ListNode* node = g_ItemsList.head[ 0 ]; node != NULL; node = node->next[ 0 ] ){
+		const char* author = ITEM_AUTHOR( node->record );
+		const char* title = ITEM_TITLE( node->record );
+		writeSnapshotBytes( &writer, author, HEAP_STRING_LENGTH( author ) + 1 );
+		writeSnapshotBytes( &writer, title, HEAP_STRING_LENGTH( title ) + 1 );
+	}
+
+	if( itemIndexes != NULL ){
+		unallocate( itemIndexes );
+	}
+
+	header.checksum = writer.checksum;
+
+	if( fseek( writer.file, 0, SEEK_SET ) != 0 || fwrite( &header, sizeof( header ), 1, writer.file ) != 1 ){
+		writer.failed = 1;
+	}
+	if( fflush( writer.file ) != 0 || fsync( fileno( writer.file ) ) != 0 ){
+		writer.failed = 1;
+	}
+	if( fclose( writer.file ) != 0 ){
+		writer.failed = 1;
+	}
+
+	if( writer.failed ){
+		writeErrorMessage( "%s: %s\n", tempPath, strerror( errno ) );
+		remove( tempPath );
+		return 0;
+	}
+	if( rename( tempPath, path ) != 0 || !syncDirectoryOf( path ) ){
+		writeErrorMessage( "%s: %s\n", path, strerror( errno ) );
+		remove( tempPath );
+		return 0;
+	}
+	return 1;
+}
+
+/*
+* checkSnapshot
+* ----------------------------------
+*
+* Checks that a mapped snapshot is complete, was saved by this
+* version, is not corrupt and describes a library that could
+* exist: every ID in range and used once, every string offset
+* in range and every loan allowed.
+*
+* @image -------------------> Mapped snapshot file.
+* @size --------------------> Size of the file.
+* @path --------------------> File's path, for error messages.
+*
+* @return ------------------> _Bool indicating if the snapshot can be loaded.
+*
+*/
+static _Bool checkSnapshot( const char* image, size_t size, const char* path ){
+
+	const SnapshotHeader* header = (const SnapshotHeader*)image;
+
+	if( size < sizeof( SnapshotHeader ) || memcmp( header->magic, SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) ) != 0 ){
+		writeErrorMessage( "%s: not a snapshot\n", path );
+		return 0;
+	}
+	if( header->version != SNAPSHOT_VERSION ){
+		writeErrorMessage( "%s: snapshot version %u is not supported\n", path, (unsigned int)header->version );
+		return 0;
+	}
+
+	uint_least64_t expectedSize = sizeof( SnapshotHeader ) + (uint_least64_t)header->numPatrons * sizeof( SnapshotPatron ) + (uint_least64_t)header->numItems * sizeof( SnapshotItem ) + (uint_least64_t)header->numLoans * sizeof( SnapshotLoan ) + header->stringsSize;
+
+	if( expectedSize != size || addToChecksum( SNAPSHOT_CHECKSUM_SEED, image + sizeof( SnapshotHeader ), size - sizeof( SnapshotHeader ) ) != header->checksum ){
+		writeErrorMessage( "%s: snapshot is corrupt\n", path );
+		return 0;
+	}
+
+	const SnapshotPatron* patrons = (const SnapshotPatron*)( header + 1 );
+	const SnapshotItem* items = (const SnapshotItem*)( patrons + header->numPatrons );
+	const SnapshotLoan* loans = (const SnapshotLoan*)( items + header->numItems );
+	const char* strings = (const char*)( loans + header->numLoans );
+
+	// one bit per possible ID to catch IDs used twice, and a loan count per item
+	unsigned char* pidsUsed = (unsigned char*) allocate( PID_KEY_COUNT / 8 + 1 );
+	unsigned char* cidsUsed = (unsigned char*) allocate( CID_KEY_COUNT / 8 + 1 );
+	unsigned char* itemLoans = (unsigned char*) allocate( header->numItems + 1 );
+	_Bool isValid = ( pidsUsed != NULL && cidsUsed != NULL && itemLoans != NULL );
+
+	if( !isValid ){
+		writeOutputString( "Memory allocation failed!\n" );
+	}
+	else{
+		memset( pidsUsed, 0, PID_KEY_COUNT / 8 + 1 );
+		memset( cidsUsed, 0, CID_KEY_COUNT / 8 + 1 );
+		memset( itemLoans, 0, header->numItems + 1 );
+
+		// with the last string terminated every offset in range is too
+		if( header->stringsSize > 0 && strings[ header->stringsSize - 1 ] != '\0' ){
+			isValid = 0;
+		}
+
+		for( uint32_t i = 0; isValid && i < header->numPatrons; ++i ){
+			uint32_t pid = patrons[ i ].pid;
+
+			if( pid >= PID_KEY_COUNT || ( pidsUsed[ pid / 8 ] & ( 1 << pid % 8 ) ) || patrons[ i ].nameOffset >= header->stringsSize ){
+				isValid = 0;
+			}
+			else{
+				pidsUsed[ pid / 8 ] |= 1 << pid % 8;
+			}
+		}
+
+		for( uint32_t i = 0; isValid && i < header->numItems; ++i ){
+			uint32_t cid = items[ i ].cid;
+
+			if( cid >= CID_KEY_COUNT || ( cidsUsed[ cid / 8 ] & ( 1 << cid % 8 ) ) || items[ i ].authorOffset >= header->stringsSize || items[ i ].titleOffset >= header->stringsSize || items[ i ].numCopies > ITEM_NUMS_MAX_SIZE ){
+				isValid = 0;
+			}
+			else{
+				cidsUsed[ cid / 8 ] |= 1 << cid % 8;
+			}
+		}
+
+		// loans are sorted by patron then item, so a patron's loans are all together
+		uint_least8_t patronLoans = 0;
+
+		for( uint32_t i = 0; isValid && i < header->numLoans; ++i ){
+			const SnapshotLoan* loan = &loans[ i ];
+			_Bool samePatron = ( i > 0 && loan->patronIndex == loans[ i - 1 ].patronIndex );
+
+			patronLoans = samePatron ? patronLoans + 1 : 1;
+
+			if( loan->patronIndex >= header->numPatrons || loan->itemIndex >= header->numItems ){
+				isValid = 0;
+			}
+			else if( i > 0 && ( loan->patronIndex < loans[ i - 1 ].patronIndex || ( samePatron && loan->itemIndex <= loans[ i - 1 ].itemIndex ) ) ){
+				isValid = 0;
+			}
+			else if( patronLoans > PATRON_MAX_ITEMS_OUT || ++itemLoans[ loan->itemIndex ] > items[ loan->itemIndex ].numCopies ){
+				isValid = 0;
+			}
+		}
+
+		if( !isValid ){
+			writeErrorMessage( "%s: snapshot is corrupt\n", path );
+		}
+	}
+
+	if( pidsUsed != NULL ){
+		unallocate( pidsUsed );
+	}
+	if( cidsUsed != NULL ){
+		unallocate( cidsUsed );
+	}
+	if( itemLoans != NULL ){
+		unallocate( itemLoans );
+	}
+	return isValid;
+}
+
+/*
+* rebuildFromSnapshot
+* ----------------------------------
+*
+* Replaces everything in the lists with the contents
+* of a snapshot already checked by checkSnapshot.
+*
+* @image -------------------> Mapped snapshot file.
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+static _Bool rebuildFromSnapshot( const char* image ){
+
+	const SnapshotHeader* header = (const SnapshotHeader*)image;
+	const SnapshotPatron* patrons = (const SnapshotPatron*)( header + 1 );
+	const SnapshotItem* items = (const SnapshotItem*)( patrons + header->numPatrons );
+	const SnapshotLoan* loans = (const SnapshotLoan*)( items + header->numItems );
+	const char* strings = (const char*)( loans + header->numLoans );
+
+	ListNode** patronNodes = (ListNode**) allocate( sizeof( ListNode* ) * ( header->numPatrons + 1 ) );
+	ListNode** itemNodes = (ListNode**) allocate( sizeof( ListNode* ) * ( header->numItems + 1 ) );
+	_Bool succeeded = ( patronNodes != NULL && itemNodes != NULL );
+
+	if( succeeded ){
+		deleteAndFreeBothLists();
+	}
+	else{
+		writeOutputString( "Memory allocation failed!\n" );
+	}
+
+	uint32_t numPatrons = 0;
+	uint32_t numItems = 0;
+
+	while( succeeded && numPatrons < header->numPatrons ){
+		const char* name = strings + patrons[ numPatrons ].nameOffset;
+		StringView nameView = { name, strlen( name ) };
+		ListNode* patronNode = createPatronNode( patrons[ numPatrons ].pid, nameView );
+
+		if( patronNode == NULL ){
+			succeeded = 0;
+		}
+		else{
+			patronNodes[ numPatrons++ ] = patronNode;
+		}
+	}
+
+	while( succeeded && numItems < header->numItems ){
+		const char* author = strings + items[ numItems ].authorOffset;
+		const char* title = strings + items[ numItems ].titleOffset;
+		StringView authorView = { author, strlen( author ) };
+		StringView titleView = { title, strlen( title ) };
+		ListNode* itemNode = createItemNode( items[ numItems ].numCopies, items[ numItems ].cid, authorView, titleView );
+
+		if( itemNode == NULL ){
+			succeeded = 0;
+		}
+		else{
+			itemNodes[ numItems++ ] = itemNode;
+		}
+	}
+
+	// whatever was created is linked even if memory ran out part way
+	if( patronNodes != NULL && itemNodes != NULL ){
+		linkPatronNodesInOrder( &g_PatronsList, patronNodes, numPatrons );
+		linkItemNodesInOrder( &g_ItemsList, itemNodes, numItems );
+	}
+
+	for( uint32_t i = 0; succeeded && i < header->numLoans; ++i ){
+		RecordHandle patron = patronNodes[ loans[ i ].patronIndex ]->record;
+		RecordHandle item = itemNodes[ loans[ i ].itemIndex ]->record;
+
+		succeeded = ( createLoan( patron, item ) != NO_LOAN );
+	}
+
+	if( patronNodes != NULL ){
+		unallocate( patronNodes );
+	}
+	if( itemNodes != NULL ){
+		unallocate( itemNodes );
+	}
+	return succeeded;
+}
+
+/*
+* loadSnapshot
+* ----------------------------------
+*
+* Loads a snapshot saved by saveSnapshot in place of
+* everything currently in the lists.
+*
+* @path --------------------> File to load from.
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+_Bool loadSnapshot( const char* path ){
+
+	int file = open( path, O_RDONLY );
+	struct stat fileInfo;
+
+	if( file < 0 || fstat( file, &fileInfo ) != 0 ){
+		writeErrorMessage( "%s: %s\n", path, strerror( errno ) );
+		if( file >= 0 ){
+			close( file );
+		}
+		return 0;
+	}
+	if( fileInfo.st_size < (off_t)sizeof( SnapshotHeader ) ){
+		writeErrorMessage( "%s: not a snapshot\n", path );
+		close( file );
+		return 0;
+	}
+
+	void* image = mmap( NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+	close( file );
+
+	if( image == MAP_FAILED ){
+		writeErrorMessage( "%s: %s\n", path, strerror( errno ) );
+		return 0;
+	}
+
+	_Bool succeeded = checkSnapshot( (const char*)image, fileInfo.st_size, path );
+	if( succeeded ){
+		succeeded = rebuildFromSnapshot( (const char*)image );
+	}
+
+	munmap( image, fileInfo.st_size );
+	return succeeded;
+}
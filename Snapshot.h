@@ -0,0 +1,103 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+/*
+* This file contains methods which save the whole library,
+* patrons, items and loans, to a binary snapshot file and
+* load it back. Records in the file refer to each other and
+* to their strings by index and offset, never by pointer, so a
+* snapshot is mapped and rebuilt in one linear pass.
+*
+* Layout, all numbers in the saving machine's byte order:
+*     SnapshotHeader
+*     SnapshotPatron[ numPatrons ]  in patron list order
+*     SnapshotItem[ numItems ]      in item list order
+*     SnapshotLoan[ numLoans ]      by patron, then item
+*     char strings[ stringsSize ]   \0 terminated strings
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include <stdint.h>
+
+#define SNAPSHOT_MAGIC "LIBSNAP"
+#define SNAPSHOT_VERSION 1
+
+/*
+* Data Structure: SnapshotHeader
+* ----------------------------------
+*
+* Start of every snapshot file.
+*
+* @magic -----------------> SNAPSHOT_MAGIC, \0 terminated.
+* @version ---------------> SNAPSHOT_VERSION of the program that saved it.
+* @numPatrons ------------> Number of SnapshotPatrons.
+* @numItems --------------> Number of SnapshotItems.
+* @numLoans --------------> Number of SnapshotLoans.
+* @stringsSize -----------> Number of chars of strings.
+* @checksum --------------> FNV-1a hash of everything after the header.
+*
+*/
+typedef struct {
+	char magic[ 8 ];
+	uint32_t version;
+	uint32_t numPatrons;
+	uint32_t numItems;
+	uint32_t numLoans;
+	uint32_t stringsSize;
+	uint32_t checksum;
+} SnapshotHeader;
+
+/*
+* Data Structure: SnapshotPatron
+* ----------------------------------
+*
+* @pid -------------------> Encoded PID.
+* @nameOffset ------------> Offset of name within strings.
+*
+*/
+typedef struct {
+	uint32_t pid;
+	uint32_t nameOffset;
+} SnapshotPatron;
+
+/*
+* Data Structure: SnapshotItem
+* ----------------------------------
+*
+* @cid -------------------> Encoded CID.
+* @authorOffset ----------> Offset of author within strings.
+* @titleOffset -----------> Offset of title within strings.
+* @numCopies -------------> Number of copies, checked out or not.
+*
+*/
+typedef struct {
+	uint32_t cid;
+	uint32_t authorOffset;
+	uint32_t titleOffset;
+	uint32_t numCopies;
+} SnapshotItem;
+
+/*
+* Data Structure: SnapshotLoan
+* ----------------------------------
+*
+* @patronIndex -----------> Index of the patron within the SnapshotPatrons.
+* @itemIndex -------------> Index of the item within the SnapshotItems.
+*
+*/
+typedef struct {
+	uint32_t patronIndex;
+	uint32_t itemIndex;
+} SnapshotLoan;
+
+// Both report what went wrong on stderr
+_Bool saveSnapshot( const char* path );
+
+// On success everything in the lists is replaced by the snapshot,
+// on failure the lists are left alone unless memory ran out part way
+_Bool loadSnapshot( const char* path );
+
+// Makes a file just created or renamed to path survive a crash
+_Bool syncDirectoryOf( const char* path );
+#endif
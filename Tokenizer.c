@@ -0,0 +1,118 @@
+/*
+* This file contains methods which split input into tokens
+* without copying or modifying it.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "Tokenizer.h"
+#include <limits.h>
+#include <string.h>
+
+/*
+* initTokenizer
+* ----------------------------------
+*  
+* Starts tokenizing input.
+*
+* @tokens ------------------> Tokenizer to start.
+* @input -------------------> Chars to tokenize, not modified.
+* @length ------------------> Number of chars in input.
+*
+* @return ------------------> None.
+*
+*/
+void initTokenizer( Tokenizer* tokens, const char* input, size_t length ){
+	tokens->next = input;
+	tokens->end = input + length;
+}
+
+/*
+* nextToken
+* ----------------------------------
+*  
+* Finds the next token the way strtok would. Leading separators
+* are skipped, the token runs up to the next separator and that
+* one separator is consumed along with the token.
+*
+* @tokens ------------------> Tokenizer to read from.
+* @separators --------------> Chars that separate tokens.
+* @token -------------------> Set to the token found.
+*
+* @return ------------------> _Bool indicating if a token was found.
+*
+*/
+_Bool nextToken( Tokenizer* tokens, const char* separators, StringView* token ){
+
+	const char* it = tokens->next;
+
+	while( it != tokens->end && strchr( separators, *it ) != NULL && *it != '\0' ){
+		++it;
+	}
+	if( it == tokens->end || *it == '\0' ){
+		tokens->next = tokens->end;
+		return 0;
+	}
+
+	token->start = it;
+	while( it != tokens->end && *it != '\0' && strchr( separators, *it ) == NULL ){
+		++it;
+	}
+	token->length = it - token->start;
+
+	// consume the separator that ended the token
+	tokens->next = ( it == tokens->end ) ? it : it + 1;
+	return 1;
+}
+
+/*
+* viewEquals
+* ----------------------------------
+*  
+* Determines if a view holds exactly the chars of string.
+*
+* @view --------------------> View to check.
+* @string ------------------> \0 terminated string to check against.
+*
+* @return ------------------> _Bool indicating if they match.
+*
+*/
+_Bool viewEquals( StringView view, const char* string ){
+	return strlen( string ) == view.length && memcmp( view.start, string, view.length ) == 0;
+}
+
+/*
+* viewToUnsigned
+* ----------------------------------
+*  
+* Reads a number from the start of a view the way strtoul
+* would with base 10, stopping at the first non digit.
+*
+* @view --------------------> View to read.
+*
+* @return ------------------> Number read, ULONG_MAX if it overflows or is negative.
+*
+*/
+unsigned long int viewToUnsigned( StringView view ){
+
+	const char* it = view.start;
+	const char* end = view.start + view.length;
+	_Bool negative = 0;
+	unsigned long int value = 0;
+
+	if( it != end && ( *it == '+' || *it == '-' ) ){
+		negative = ( *it == '-' );
+		++it;
+	}
+
+	while( it != end && *it >= '0' && *it <= '9' ){
+		if( value > ( ULONG_MAX - ( *it - '0' ) ) / 10 ){
+			return ULONG_MAX;
+		}
+		value = value * 10 + ( *it - '0' );
+		++it;
+	}
+
+	return ( negative && value != 0 ) ? ULONG_MAX : value;
+}
@@ -0,0 +1,50 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+/*
+* This file contains methods which split input into tokens
+* without copying or modifying it. Tokens are handed out as
+* StringViews pointing into the input. Splitting follows the
+* same rules as strtok, but all state lives in the Tokenizer
+* so any number of inputs can be tokenized at once.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include <stddef.h>
+
+/*
+* Data Structure: StringView
+* ----------------------------------
+*
+* Chars of a string that is not \0 terminated.
+*
+* @start -----------------> First char.
+* @length ----------------> Number of chars.
+*
+*/
+typedef struct {
+	const char* start;
+	size_t length;
+} StringView;
+
+/*
+* Data Structure: Tokenizer
+* ----------------------------------
+*
+* Position within the input being tokenized.
+*
+* @next ------------------> Next char to read.
+* @end -------------------> One past the last char of the input.
+*
+*/
+typedef struct {
+	const char* next;
+	const char* end;
+} Tokenizer;
+
+void initTokenizer( Tokenizer* tokens, const char* input, size_t length );
+_Bool nextToken( Tokenizer* tokens, const char* separators, StringView* token );
+_Bool viewEquals( StringView view, const char* string );
+unsigned long int viewToUnsigned( StringView view );
+#endif
@@ -0,0 +1,179 @@
+/*
+* This file contains methods that maintain a direct-indexed
+* table from an encoded UID to the handle of that UID's record.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "UIDIndex.h"
+#include "OutputWriter.h"
+#include <allocate.h>
+#include <string.h>
+
+/*
+* findIndexedRecord
+* ----------------------------------
+*
+* Finds the record stored under the encoded UID.
+*
+* @index -------------------> Index to look the UID up in.
+* @key ---------------------> Encoded UID.
+*
+* @return ------------------> Handle of the record matching UID, or NO_RECORD.
+*
+*/
+RecordHandle findIndexedRecord( const UIDIndex* index, uint_least32_t key ){
+
+	if( index == NULL || index->pages == NULL || key >= index->numKeys ){
+		return NO_RECORD;
+	}
+
+	RecordHandle* page = index->pages[ key >> UID_INDEX_PAGE_BITS ];
+	if( page == NULL ){
+		return NO_RECORD;
+	}
+	return page[ key & ( UID_INDEX_PAGE_SIZE - 1 ) ];
+}
+
+/*
+* setIndexedRecord
+* ----------------------------------
+*
+* Stores a record's handle under the encoded UID, allocating
+* the top level table and the UID's page if needed.
+* Passing NO_RECORD removes the UID from the index.
+*
+* @index -------------------> Index to store the handle in.
+* @key ---------------------> Encoded UID.
+* @record ------------------> Handle to store, or NO_RECORD to remove.
+*
+* @return ------------------> _Bool indicating success or failure.
+*
+*/
+_Bool setIndexedRecord( UIDIndex* index, uint_least32_t key, RecordHandle record ){
+
+	if( index == NULL || key >= index->numKeys ){
+		return 0;
+	}
+
+	uint_least32_t numPages = ( index->numKeys + UID_INDEX_PAGE_SIZE - 1 ) >> UID_INDEX_PAGE_BITS;
+
+	if( index->pages == NULL ){
+		if( record == NO_RECORD ){
+			return 1;
+		}
+		index->pages = (RecordHandle**) allocate( sizeof( RecordHandle* ) * numPages );
+		if( index->pages == NULL ){
+			writeOutputString( "Memory allocation failed!\n" );
+			return 0;
+		}
+		memset( index->pages, 0, sizeof( RecordHandle* ) * numPages );
+	}
+
+	RecordHandle** page = &index->pages[ key >> UID_INDEX_PAGE_BITS ];
+
+	if( *page == NULL ){
+		if( record == NO_RECORD ){
+			return 1;
+		}
+		*page = (RecordHandle*) allocate( sizeof( RecordHandle ) * UID_INDEX_PAGE_SIZE );
+		if( *page == NULL ){
+			writeOutputString( "Memory allocation failed!\n" );
+			return 0;
+		}
+		for( uint_least32_t i = 0; i < UID_INDEX_PAGE_SIZE; ++i ){
+			(*page)[ i ] = NO_RECORD;
+		}
+	}
+
+	(*page)[ key & ( UID_INDEX_PAGE_SIZE - 1 ) ] = record;
+	return 1;
+}
+
+/*
+* freeUIDIndex
+* ----------------------------------
+*
+* Unallocates every page and the top level table.
+* The records themselves belong to the RecordStore and are left alone.
+*
+* @index -------------------> Index to free.
+*
+* @return ------------------> None.
+*
+*/
+void freeUIDIndex( UIDIndex* index ){
+
+	if( index == NULL || index->pages == NULL ){
+		return;
+	}
+
+	uint_least32_t numPages = ( index->numKeys + UID_INDEX_PAGE_SIZE - 1 ) >> UID_INDEX_PAGE_BITS;
+
+	for( uint_least32_t i = 0; i < numPages; ++i ){
+		if( index->pages[ i ] != NULL ){
+			unallocate( index->pages[ i ] );
+		}
+	}
+	unallocate( index->pages );
+	index->pages = NULL;
+}
+
+/*
+* encodePID
+* ----------------------------------
+*
+* Packs a valid PID into a dense integer key. The letter
+* selects a block of 10000 keys and the 4 digits select
+* the key within that block.
+*
+* @pid ---------------------> PID already checked by isValidPID.
+*
+* @return ------------------> Encoded PID.
+*
+*/
+PatronKey encodePID( const char* pid ){
+
+	uint_least32_t key = 0;
+
+	for( uint_least8_t i = 1; i < PID_MAX_SIZE - 1; ++i ){
+		key = key * 10 + ( pid[ i ] - '0' );
+	}
+	return ( pid[ 0 ] - 'A' ) * PID_DIGITS_KEY_COUNT + key;
+}
+
+/*
+* encodeCID
+* ----------------------------------
+*
+* Packs a valid CID into a 20 bit integer key. Each half
+* is read as a number and kept to 10 bits, the left
+* half goes in the high bits.
+*
+* @cid ---------------------> CID already checked by isValidCID.
+* @length ------------------> Number of chars in cid.
+*
+* @return ------------------> Encoded CID.
+*
+*/
+ItemKey encodeCID( const char* cid, size_t length ){
+
+	const char* end = cid + length;
+	uint_least16_t leftCID = 0;
+	uint_least16_t rightCID = 0;
+
+	while( *cid != PERIOD_WORD_SEPARATOR_CH ){
+		leftCID = leftCID * 10 + ( *cid - '0' );
+		++cid;
+	}
+	++cid;
+
+	while( cid != end && *cid >= '0' && *cid <= '9' ){
+		rightCID = rightCID * 10 + ( *cid - '0' );
+		++cid;
+	}
+	uint_least16_t halfMask = ( 1 << CID_HALF_BITS ) - 1;
+
+	return ( (ItemKey)( leftCID & halfMask ) << CID_HALF_BITS ) | ( rightCID & halfMask );
+}
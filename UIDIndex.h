@@ -0,0 +1,58 @@
+#ifndef UID_INDEX_H
+#define UID_INDEX_H
+/*
+* This file contains methods that maintain a direct-indexed
+* table from an encoded UID to the handle of that UID's record.
+* The table is split into pages which are only allocated once a
+* UID falling in them is inserted, so a sparse table stays small.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "LinkedDataNodeStructures.h"
+#include "AllConstants.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define UID_INDEX_PAGE_BITS 8
+#define UID_INDEX_PAGE_SIZE ( 1 << UID_INDEX_PAGE_BITS )
+
+/*
+* Data Structure: UIDIndex
+* ----------------------------------
+*
+* Two level table mapping an encoded UID to its RecordHandle.
+*
+* @pages -----------------> Top level table of pages, NULL until first insert.
+* @numKeys ---------------> Number of possible encoded UIDs.
+*
+*/
+typedef struct {
+	RecordHandle** pages;
+	uint_least32_t numKeys;
+} UIDIndex;
+
+// Pull the printable parts back out of an encoded UID,
+// these are only used when formatting output
+#define PID_KEY_LETTER( key ) ( (char)( 'A' + (key) / PID_DIGITS_KEY_COUNT ) )
+#define PID_KEY_NUMBER( key ) ( (unsigned int)( (key) % PID_DIGITS_KEY_COUNT ) )
+#define CID_KEY_LEFT( key ) ( (unsigned int)( (key) >> CID_HALF_BITS ) )
+#define CID_KEY_RIGHT( key ) ( (unsigned int)( (key) & ( ( 1 << CID_HALF_BITS ) - 1 ) ) )
+
+#define PID_FORMAT "%c%04u"
+#define PID_FORMAT_ARGS( key ) PID_KEY_LETTER( key ), PID_KEY_NUMBER( key )
+#define CID_FORMAT "%u.%u"
+#define CID_FORMAT_ARGS( key ) CID_KEY_LEFT( key ), CID_KEY_RIGHT( key )
+
+// Functions to look up, insert and remove a UID's record
+RecordHandle findIndexedRecord( const UIDIndex* index, uint_least32_t key );
+_Bool setIndexedRecord( UIDIndex* index, uint_least32_t key, RecordHandle record );
+void freeUIDIndex( UIDIndex* index );
+
+// Encodes a valid PID(1 uppercase char, 4 digits) into 0 to PID_KEY_COUNT-1
+PatronKey encodePID( const char* pid );
+
+// Encodes a valid CID(digits.digits) of length chars into 0 to CID_KEY_COUNT-1
+ItemKey encodeCID( const char* cid, size_t length );
+#endif
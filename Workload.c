@@ -0,0 +1,615 @@
+/*
+* This file contains methods which make up synthetic library
+* workloads. Records are numbered from 0 and each number is
+* spread over its UID space by multiplying with a stride prime
+* to the space's size, so UIDs look random yet never repeat.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include "Workload.h"
+#include "AllConstants.h"
+#include <allocate.h>
+#include <math.h>
+
+// Prime to WORKLOAD_MAX_PATRONS and WORKLOAD_MAX_ITEMS respectively
+#define PATRON_STRIDE 7919u
+#define ITEM_STRIDE 999983u
+
+// Percent of queries asking after an item, the rest ask after a patron
+#define AVAILABLE_QUERY_PERCENT 40
+#define OUT_ITEM_QUERY_PERCENT 30
+
+// The top 1 in this many items are stocked with extra copies
+#define POPULAR_ITEM_DIVISOR 100
+
+#define NUM_INVALID_KINDS 6
+
+static const char* const s_FirstNames[] = {
+	"Ada", "Alan", "Barbara", "Claude", "Dennis", "Edsger", "Frances", "Grace",
+	"John", "Ken", "Leslie", "Margaret", "Niklaus", "Radia", "Sophie", "Tony"
+};
+static const char* const s_LastNames[] = {
+	"Allen", "Backus", "Dijkstra", "Hamilton", "Hoare", "Hopper", "Kernighan", "Knuth",
+	"Lamport", "Liskov", "Perlman", "Ritchie", "Shannon", "Thompson", "Turing", "Wirth"
+};
+static const char* const s_TitleWords[] = {
+	"Art", "Garden", "History", "Journey", "Letters", "Light", "Machine", "Night",
+	"Ocean", "River", "Road", "Secret", "Silent", "Stone", "Summer", "Winter"
+};
+
+#define NUM_WORDS( words ) ( sizeof( words ) / sizeof( words[ 0 ] ) )
+
+/*
+* Data Structure: WorkloadState
+* ----------------------------------
+*
+* Everything generateWorkload tracks while writing commands.
+*
+* @options ---------------> Shape of the workload.
+* @random ----------------> State of the random numbers.
+* @popularity ------------> Zipf CDF, popularity[ r ] is the chance an item ranked r or better is picked.
+* @itemCopies ------------> Copies of each item.
+* @itemCopiesOut ---------> Copies of each item on loan.
+* @patronItems -----------> PATRON_MAX_ITEMS_OUT slots per patron of the items it has out.
+* @patronItemsOut --------> Items each patron has out.
+* @loanPatrons -----------> Patron of every loan made and not yet returned.
+* @loanItems -------------> Item of every such loan.
+* @numLoans --------------> Number of such loans.
+*
+*/
+typedef struct {
+	const WorkloadOptions* options;
+	uint_least64_t random;
+	double* popularity;
+	uint_least8_t* itemCopies;
+	uint_least8_t* itemCopiesOut;
+	uint_least32_t* patronItems;
+	uint_least8_t* patronItemsOut;
+	uint_least32_t* loanPatrons;
+	uint_least32_t* loanItems;
+	uint_least64_t numLoans;
+} WorkloadState;
+
+/*
+* setWorkloadDefaults
+* ----------------------------------
+*  
+* Fills options with a mid sized library that borrows a
+* little more than it returns.
+*
+* @options -----------------> Options to fill.
+*
+* @return ------------------> None.
+*
+*/
+void setWorkloadDefaults( WorkloadOptions* options ){
+	options->numPatrons = WORKLOAD_DEFAULT_PATRONS;
+	options->numItems = WORKLOAD_DEFAULT_ITEMS;
+	options->numCommands = WORKLOAD_DEFAULT_COMMANDS;
+	options->zipfSkew = WORKLOAD_DEFAULT_ZIPF_SKEW;
+	options->borrowWeight = WORKLOAD_DEFAULT_BORROW_WEIGHT;
+	options->returnWeight = WORKLOAD_DEFAULT_RETURN_WEIGHT;
+	options->queryWeight = WORKLOAD_DEFAULT_QUERY_WEIGHT;
+	options->invalidRatio = WORKLOAD_DEFAULT_INVALID_RATIO;
+	options->seed = WORKLOAD_DEFAULT_SEED;
+}
+
+/*
+* areWorkloadOptionsValid
+* ----------------------------------
+*  
+* Checks every option is in range.
+*
+* @options -----------------> Options to check.
+*
+* @return ------------------> _Bool indicating the options can be generated.
+*
+*/
+_Bool areWorkloadOptionsValid( const WorkloadOptions* options ){
+
+	_Bool isValid = 1;
+
+	if( options->numPatrons < 1 || options->numPatrons > WORKLOAD_MAX_PATRONS ){
+		fprintf( stderr, "Patrons must be 1 to %d\n", WORKLOAD_MAX_PATRONS );
+		isValid = 0;
+	}
+	if( options->numItems < 1 || options->numItems > WORKLOAD_MAX_ITEMS ){
+		fprintf( stderr, "Items must be 1 to %d\n", WORKLOAD_MAX_ITEMS );
+		isValid = 0;
+	}
+	if( !( options->zipfSkew >= 0.0 ) ){
+		fputs( "Zipf skew must not be negative\n", stderr );
+		isValid = 0;
+	}
+	if( options->borrowWeight + options->returnWeight + options->queryWeight == 0 ){
+		fputs( "Command mix must have a weight above 0\n", stderr );
+		isValid = 0;
+	}
+	if( !( options->invalidRatio >= 0.0 && options->invalidRatio <= 1.0 ) ){
+		fputs( "Invalid command ratio must be 0 to 1\n", stderr );
+		isValid = 0;
+	}
+	return isValid;
+}
+
+/*
+* nextRandom
+* ----------------------------------
+*  
+* Steps a splitmix64 generator.
+*
+* @state -------------------> Generator state.
+*
+* @return ------------------> 64 random bits.
+*
+*/
+static uint_least64_t nextRandom( uint_least64_t* state ){
+
+	uint_least64_t bits = ( *state += 0x9E3779B97F4A7C15ull );
+	bits = ( bits ^ ( bits >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+	bits = ( bits ^ ( bits >> 27 ) ) * 0x94D049BB133111EBull;
+	return bits ^ ( bits >> 31 );
+}
+
+/*
+* randomBelow
+* ----------------------------------
+*  
+* Picks a number below limit, scaling rather than taking
+* a remainder so no number is favoured noticeably.
+*
+* @state -------------------> Generator state.
+* @limit -------------------> One past the highest number wanted.
+*
+* @return ------------------> 0 to limit - 1.
+*
+*/
+static uint_least32_t randomBelow( uint_least64_t* state, uint_least32_t limit ){
+	return (uint_least32_t)( ( ( nextRandom( state ) >> 32 ) * limit ) >> 32 );
+}
+
+/*
+* randomFraction
+* ----------------------------------
+*  
+* Picks a fraction from 0 up to but not including 1.
+*
+* @state -------------------> Generator state.
+*
+* @return ------------------> The fraction.
+*
+*/
+static double randomFraction( uint_least64_t* state ){
+	return ( nextRandom( state ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+/*
+* writePID
+* ----------------------------------
+*  
+* Writes the PID of patron number patron.
+*
+* @file --------------------> File to write to.
+* @patron ------------------> 0 to WORKLOAD_MAX_PATRONS - 1.
+*
+* @return ------------------> None.
+*
+*/
+static void writePID( FILE* file, uint_least32_t patron ){
+
+	uint_least32_t key = (uint_least32_t)( ( (uint_least64_t)patron * PATRON_STRIDE ) % WORKLOAD_MAX_PATRONS );
+	fprintf( file, "%c%04u", (char)( 'A' + key / PID_DIGITS_KEY_COUNT ), (unsigned int)( key % PID_DIGITS_KEY_COUNT ) );
+}
+
+/*
+* writeCID
+* ----------------------------------
+*  
+* Writes the CID of item number item.
+*
+* @file --------------------> File to write to.
+* @item --------------------> 0 to WORKLOAD_MAX_ITEMS - 1.
+*
+* @return ------------------> None.
+*
+*/
+static void writeCID( FILE* file, uint_least32_t item ){
+
+	uint_least32_t key = (uint_least32_t)( ( (uint_least64_t)item * ITEM_STRIDE ) % WORKLOAD_MAX_ITEMS );
+	fprintf( file, "%u.%u", (unsigned int)( key / 1000 ), (unsigned int)( key % 1000 ) );
+}
+
+/*
+* writePatronFile
+* ----------------------------------
+*  
+* Writes a patron command for every patron.
+*
+* @state -------------------> Workload being generated.
+* @file --------------------> File to write to.
+*
+* @return ------------------> None.
+*
+*/
+static void writePatronFile( WorkloadState* state, FILE* file ){
+
+	for( uint_least32_t patron = 0; patron < state->options->numPatrons; ++patron ){
+		fputs( ADD_PATRON_COMMAND " ", file );
+		writePID( file, patron );
+		fprintf( file, "  \"%s %s\"\n", s_FirstNames[ randomBelow( &state->random, NUM_WORDS( s_FirstNames ) ) ],
+		         s_LastNames[ randomBelow( &state->random, NUM_WORDS( s_LastNames ) ) ] );
+	}
+}
+
+/*
+* writeItemFile
+* ----------------------------------
+*  
+* Writes an item command for every item. Most items have
+* one to three copies, a few have more and the most popular
+* items, the ones ranked first, have the most.
+*
+* @state -------------------> Workload being generated.
+* @file --------------------> File to write to.
+*
+* @return ------------------> None.
+*
+*/
+static void writeItemFile( WorkloadState* state, FILE* file ){
+
+	for( uint_least32_t item = 0; item < state->options->numItems; ++item ){
+		uint_least8_t copies = 1 + randomBelow( &state->random, 3 );
+		if( item < state->options->numItems / POPULAR_ITEM_DIVISOR ){
+			copies = 10 + randomBelow( &state->random, 21 );
+		}
+		else if( randomBelow( &state->random, 20 ) == 0 ){
+			copies = 5 + randomBelow( &state->random, 16 );
+		}
+		state->itemCopies[ item ] = copies;
+
+		fprintf( file, ADD_ITEM_COMMAND " %u ", (unsigned int)copies );
+		writeCID( file, item );
+		fprintf( file, "  \"%s %s\"  \"The %s of %s\"\n", s_FirstNames[ randomBelow( &state->random, NUM_WORDS( s_FirstNames ) ) ],
+		         s_LastNames[ randomBelow( &state->random, NUM_WORDS( s_LastNames ) ) ],
+		         s_TitleWords[ randomBelow( &state->random, NUM_WORDS( s_TitleWords ) ) ],
+		         s_TitleWords[ randomBelow( &state->random, NUM_WORDS( s_TitleWords ) ) ] );
+	}
+}
+
+/*
+* buildPopularity
+* ----------------------------------
+*  
+* Fills in the Zipf CDF, the item ranked r being
+* picked in proportion to 1 / ( r + 1 )^zipfSkew.
+*
+* @state -------------------> Workload being generated.
+*
+* @return ------------------> None.
+*
+*/
+static void buildPopularity( WorkloadState* state ){
+
+	uint_least32_t numItems = state->options->numItems;
+	double total = 0.0;
+
+	for( uint_least32_t rank = 0; rank < numItems; ++rank ){
+		total += 1.0 / pow( rank + 1.0, state->options->zipfSkew );
+		state->popularity[ rank ] = total;
+	}
+	for( uint_least32_t rank = 0; rank < numItems; ++rank ){
+		state->popularity[ rank ] /= total;
+	}
+}
+
+/*
+* pickItem
+* ----------------------------------
+*  
+* Picks an item by popularity. Items are ranked by number,
+* which writeCID already scatters over the CIDs.
+*
+* @state -------------------> Workload being generated.
+*
+* @return ------------------> Number of the item.
+*
+*/
+static uint_least32_t pickItem( WorkloadState* state ){
+
+	double chance = randomFraction( &state->random );
+	uint_least32_t low = 0;
+	uint_least32_t high = state->options->numItems - 1;
+
+	while( low < high ){
+		uint_least32_t middle = low + ( high - low ) / 2;
+		if( state->popularity[ middle ] < chance ){
+			low = middle + 1;
+		}
+		else{
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+* writeBorrow
+* ----------------------------------
+*  
+* Writes a borrow of a popular item by any patron and
+* records the loan when the library would make it.
+*
+* @state -------------------> Workload being generated.
+* @file --------------------> File to write to.
+*
+* @return ------------------> None.
+*
+*/
+static void writeBorrow( WorkloadState* state, FILE* file ){
+
+	uint_least32_t patron = randomBelow( &state->random, state->options->numPatrons );
+	uint_least32_t item = pickItem( state );
+
+	fputs( BORROW_ITEM_COMMAND " ", file );
+	writePID( file, patron );
+	fputc( ' ', file );
+	writeCID( file, item );
+	fputc( '\n', file );
+
+	uint_least32_t* patronItems = state->patronItems + (uint_least64_t)patron * PATRON_MAX_ITEMS_OUT;
+	uint_least8_t itemsOut = state->patronItemsOut[ patron ];
+
+	if( itemsOut == PATRON_MAX_ITEMS_OUT || state->itemCopiesOut[ item ] == state->itemCopies[ item ] ){
+		return;
+	}
+	for( uint_least8_t i = 0; i < itemsOut; ++i ){
+		if( patronItems[ i ] == item ){
+			return;
+		}
+	}
+
+	patronItems[ itemsOut ] = item;
+	++state->patronItemsOut[ patron ];
+	++state->itemCopiesOut[ item ];
+	state->loanPatrons[ state->numLoans ] = patron;
+	state->loanItems[ state->numLoans ] = item;
+	++state->numLoans;
+}
+
+/*
+* writeReturn
+* ----------------------------------
+*  
+* Writes the return of a loan made earlier, or a borrow
+* if nothing is on loan.
+*
+* @state -------------------> Workload being generated.
+* @file --------------------> File to write to.
+*
+* @return ------------------> None.
+*
+*/
+static void writeReturn( WorkloadState* state, FILE* file ){
+
+	if( state->numLoans == 0 ){
+		writeBorrow( state, file );
+		return;
+	}
+
+	uint_least64_t loan = ( nextRandom( &state->random ) >> 1 ) % state->numLoans;
+	uint_least32_t patron = state->loanPatrons[ loan ];
+	uint_least32_t item = state->loanItems[ loan ];
+
+	fputs( RETURN_ITEM_COMMAND " ", file );
+	writePID( file, patron );
+	fputc( ' ', file );
+	writeCID( file, item );
+	fputc( '\n', file );
+
+	--state->numLoans;
+	state->loanPatrons[ loan ] = state->loanPatrons[ state->numLoans ];
+	state->loanItems[ loan ] = state->loanItems[ state->numLoans ];
+
+	uint_least32_t* patronItems = state->patronItems + (uint_least64_t)patron * PATRON_MAX_ITEMS_OUT;
+	uint_least8_t itemsOut = --state->patronItemsOut[ patron ];
+	for( uint_least8_t i = 0; i < itemsOut; ++i ){
+		if( patronItems[ i ] == item ){
+			patronItems[ i ] = patronItems[ itemsOut ];
+			break;
+		}
+	}
+	--state->itemCopiesOut[ item ];
+}
+
+/*
+* writeQuery
+* ----------------------------------
+*  
+* Writes an available or out query of a popular item,
+* or an out query of any patron.
+*
+* @state -------------------> Workload being generated.
+* @file --------------------> File to write to.
+*
+* @return ------------------> None.
+*
+*/
+static void writeQuery( WorkloadState* state, FILE* file ){
+
+	uint_least32_t kind = randomBelow( &state->random, 100 );
+
+	if( kind < AVAILABLE_QUERY_PERCENT ){
+		fputs( AVAILABLE_ITEM_COMMAND " ", file );
+		writeCID( file, pickItem( state ) );
+	}
+	else if( kind < AVAILABLE_QUERY_PERCENT + OUT_ITEM_QUERY_PERCENT ){
+		fputs( OUT_COMMAND " ", file );
+		writeCID( file, pickItem( state ) );
+	}
+	else{
+		fputs( OUT_COMMAND " ", file );
+		writePID( file, randomBelow( &state->random, state->options->numPatrons ) );
+	}
+	fputc( '\n', file );
+}
+
+/*
+* writeInvalidCommand
+* ----------------------------------
+*  
+* Writes a command the library turns away, either one
+* that does not parse or one naming a record that does not
+* exist. Records past the last one generated stand in for
+* missing ones while the UID space has room.
+*
+* @state -------------------> Workload being generated.
+* @file --------------------> File to write to.
+*
+* @return ------------------> None.
+*
+*/
+static void writeInvalidCommand( WorkloadState* state, FILE* file ){
+
+	const WorkloadOptions* options = state->options;
+	uint_least32_t patron = randomBelow( &state->random, options->numPatrons );
+	uint_least32_t item = pickItem( state );
+
+	switch( randomBelow( &state->random, NUM_INVALID_KINDS ) ){
+		case 0:
+			fputs( "renew ", file );
+			writePID( file, patron );
+			fputc( ' ', file );
+			writeCID( file, item );
+			break;
+		case 1:
+			fputs( BORROW_ITEM_COMMAND " a123 ", file );
+			writeCID( file, item );
+			break;
+		case 2:
+			fputs( AVAILABLE_ITEM_COMMAND " 12x.3", file );
+			break;
+		case 3:
+			fputs( BORROW_ITEM_COMMAND " ", file );
+			writePID( file, patron );
+			break;
+		case 4:
+			fputs( OUT_COMMAND " ", file );
+			if( options->numPatrons < WORKLOAD_MAX_PATRONS ){
+				writePID( file, options->numPatrons + randomBelow( &state->random, WORKLOAD_MAX_PATRONS - options->numPatrons ) );
+			}
+			else{
+				fputs( "A12", file );
+			}
+			break;
+		default:
+			fputs( RETURN_ITEM_COMMAND " ", file );
+			writePID( file, patron );
+			fputc( ' ', file );
+			if( options->numItems < WORKLOAD_MAX_ITEMS ){
+				writeCID( file, options->numItems + randomBelow( &state->random, WORKLOAD_MAX_ITEMS - options->numItems ) );
+			}
+			else{
+				fputs( "1.", file );
+			}
+			break;
+	}
+	fputc( '\n', file );
+}
+
+/*
+* writeCommandFile
+* ----------------------------------
+*  
+* Writes every command, mixed by the options' weights.
+*
+* @state -------------------> Workload being generated.
+* @file --------------------> File to write to.
+*
+* @return ------------------> None.
+*
+*/
+static void writeCommandFile( WorkloadState* state, FILE* file ){
+
+	const WorkloadOptions* options = state->options;
+	uint_least32_t totalWeight = options->borrowWeight + options->returnWeight + options->queryWeight;
+
+	for( uint_least64_t command = 0; command < options->numCommands; ++command ){
+		if( randomFraction( &state->random ) < options->invalidRatio ){
+			writeInvalidCommand( state, file );
+			continue;
+		}
+
+		uint_least32_t kind = randomBelow( &state->random, totalWeight );
+		if( kind < options->borrowWeight ){
+			writeBorrow( state, file );
+		}
+		else if( kind < options->borrowWeight + options->returnWeight ){
+			writeReturn( state, file );
+		}
+		else{
+			writeQuery( state, file );
+		}
+	}
+}
+
+/*
+* generateWorkload
+* ----------------------------------
+*  
+* Writes a patron file, an item file and a command stream.
+*
+* @options -----------------> Shape of the workload, already checked by areWorkloadOptionsValid.
+* @patronsFile -------------> File to write the patrons to.
+* @itemsFile ---------------> File to write the items to.
+* @commandsFile ------------> File to write the commands to.
+*
+* @return ------------------> _Bool indicating every file was written in full.
+*
+*/
+_Bool generateWorkload( const WorkloadOptions* options, FILE* patronsFile, FILE* itemsFile, FILE* commandsFile ){
+
+	WorkloadState state = { options, options->seed, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0 };
+	size_t numPatronSlots = (size_t)options->numPatrons * PATRON_MAX_ITEMS_OUT;
+
+	state.popularity = (double*) allocate( sizeof( double ) * options->numItems );
+	state.itemCopies = (uint_least8_t*) allocate( options->numItems );
+	state.itemCopiesOut = (uint_least8_t*) allocate( options->numItems );
+	state.patronItems = (uint_least32_t*) allocate( sizeof( uint_least32_t ) * numPatronSlots );
+	state.patronItemsOut = (uint_least8_t*) allocate( options->numPatrons );
+	state.loanPatrons = (uint_least32_t*) allocate( sizeof( uint_least32_t ) * numPatronSlots );
+	state.loanItems = (uint_least32_t*) allocate( sizeof( uint_least32_t ) * numPatronSlots );
+
+	_Bool isWritten = 0;
+
+	if( state.popularity == NULL || state.itemCopies == NULL || state.itemCopiesOut == NULL || state.patronItems == NULL
+	    || state.patronItemsOut == NULL || state.loanPatrons == NULL || state.loanItems == NULL ){
+		fputs( "Memory allocation failed!\n", stderr );
+	}
+	else{
+		for( uint_least32_t item = 0; item < options->numItems; ++item ){
+			state.itemCopiesOut[ item ] = 0;
+		}
+		for( uint_least32_t patron = 0; patron < options->numPatrons; ++patron ){
+			state.patronItemsOut[ patron ] = 0;
+		}
+
+		buildPopularity( &state );
+		writePatronFile( &state, patronsFile );
+		writeItemFile( &state, itemsFile );
+		writeCommandFile( &state, commandsFile );
+
+		isWritten = ( fflush( patronsFile ) == 0 && fflush( itemsFile ) == 0 && fflush( commandsFile ) == 0
+		              && !ferror( patronsFile ) && !ferror( itemsFile ) && !ferror( commandsFile ) );
+	}
+
+	void* buffers[] = { state.popularity, state.itemCopies, state.itemCopiesOut, state.patronItems,
+	                    state.patronItemsOut, state.loanPatrons, state.loanItems };
+	for( size_t i = 0; i < sizeof( buffers ) / sizeof( buffers[ 0 ] ); ++i ){
+		if( buffers[ i ] != NULL ){
+			unallocate( buffers[ i ] );
+		}
+	}
+	return isWritten;
+}
@@ -0,0 +1,71 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+/*
+* This file contains methods which make up synthetic library
+* workloads: a patron file, an item file and a stream of commands
+* in the same formats project1 reads. Item popularity follows a
+* Zipf distribution, and the generator tracks the loans it makes,
+* so most returns match an earlier borrow and busy items run out
+* of copies the way they would in a real library.
+* The same seed always makes the same files.
+*
+*
+* @author Greg Mojonnier
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define WORKLOAD_DEFAULT_PATRONS 10000
+#define WORKLOAD_DEFAULT_ITEMS 50000
+#define WORKLOAD_DEFAULT_COMMANDS 1000000
+#define WORKLOAD_DEFAULT_ZIPF_SKEW 0.99
+#define WORKLOAD_DEFAULT_BORROW_WEIGHT 40
+#define WORKLOAD_DEFAULT_RETURN_WEIGHT 30
+#define WORKLOAD_DEFAULT_QUERY_WEIGHT 30
+#define WORKLOAD_DEFAULT_INVALID_RATIO 0.01
+#define WORKLOAD_DEFAULT_SEED 1
+
+// Most distinct PIDs, a capital letter and 4 digits
+#define WORKLOAD_MAX_PATRONS 260000
+
+// Most distinct CIDs that fit in 7 chars, up to 999.999
+#define WORKLOAD_MAX_ITEMS 1000000
+
+/*
+* Data Structure: WorkloadOptions
+* ----------------------------------
+*
+* Shape of a workload, setWorkloadDefaults fills in the defaults.
+*
+* @numPatrons ------------> Patrons in the patron file.
+* @numItems --------------> Items in the item file.
+* @numCommands -----------> Commands in the command stream.
+* @zipfSkew --------------> Zipf exponent of item popularity, 0 is uniform.
+* @borrowWeight ----------> Relative share of borrows.
+* @returnWeight ----------> Relative share of returns.
+* @queryWeight -----------> Relative share of available and out queries.
+* @invalidRatio ----------> Share of commands that are malformed or name no record.
+* @seed ------------------> Seed of the random numbers.
+*
+*/
+typedef struct {
+	uint_least32_t numPatrons;
+	uint_least32_t numItems;
+	uint_least64_t numCommands;
+	double zipfSkew;
+	unsigned int borrowWeight;
+	unsigned int returnWeight;
+	unsigned int queryWeight;
+	double invalidRatio;
+	uint_least64_t seed;
+} WorkloadOptions;
+
+void setWorkloadDefaults( WorkloadOptions* options );
+
+// Checks options are in range, printing what is not to stderr
+_Bool areWorkloadOptionsValid( const WorkloadOptions* options );
+
+// Writes all three files, returns 0 on a write or allocation failure
+_Bool generateWorkload( const WorkloadOptions* options, FILE* patronsFile, FILE* itemsFile, FILE* commandsFile );
+#endif
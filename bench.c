@@ -0,0 +1,779 @@
+/**
+*
+* This is a program to measure how fast the library runs a
+* workload. It generates a patron file, an item file and a command
+* stream with Workload.h, or replays a recorded session given to
+* it, then loads the files and runs every command in process the
+* way project1 would with them on stdin, timing each one. Results
+* are written as JSON so runs of different versions can be compared.
+* The output of a run can be saved, and a later run checked against
+* it byte for byte, final status listing included. Error messages are
+* only counted, so the output is exactly what project1 would write to
+* stdout and a recorded session's stdout can be checked as well.
+*
+* Author: Greg Mojonnier
+*
+*/
+
+// fork and clock_gettime are POSIX, not part of c99
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "SanitizeInput.h"
+#include "BulkLoad.h"
+#include "CommandStats.h"
+#include "ExecuteCommands.h"
+#include "LinkedDataNodeOperations.h"
+#include "UIDIndex.h"
+#include "RecordStore.h"
+#include "OutputWriter.h"
+#include "LatencyHistogram.h"
+#include "Tokenizer.h"
+#include "Workload.h"
+#include "AllConstants.h"
+
+// Prefix of the generated files when -w is not given
+#define BENCH_DEFAULT_PREFIX "bench"
+
+// Version of the results' layout, bumped whenever a field changes meaning
+#define BENCH_RESULTS_VERSION 2
+
+// Chars of the expected output read at a time
+#define BENCH_COMPARE_SIZE 65536
+
+// The same globals project1.c defines, the library's commands use them
+FILE* g_InputFile = NULL;
+OrderedList g_PatronsList = { { NULL }, 0 };
+OrderedList g_ItemsList = { { NULL }, 0 };
+UIDIndex g_PatronsIndex = { NULL, PID_KEY_COUNT };
+UIDIndex g_ItemsIndex = { NULL, CID_KEY_COUNT };
+
+// Kinds of command timed separately, invalid is every line the parser turns away
+typedef enum {
+	BENCH_BORROW,
+	BENCH_RETURN,
+	BENCH_AVAILABLE,
+	BENCH_OUT_ITEM,
+	BENCH_OUT_PATRON,
+	BENCH_INVALID,
+	BENCH_COMMAND_TYPES
+} BenchCommandType;
+
+static const char* const s_CommandTypeNames[ BENCH_COMMAND_TYPES ] = {
+	"borrow", "return", "available", "out_item", "out_patron", "invalid"
+};
+
+static LatencyHistogram s_Latencies[ BENCH_COMMAND_TYPES ];
+static LatencyHistogram s_AllLatencies;
+
+// Every char the commands write to the output, and every char of their error messages
+static unsigned long long s_OutputSize = 0;
+static unsigned long long s_ErrorSize = 0;
+
+// Output is copied to s_SavedOutput and compared with s_ExpectedOutput, either may be NULL
+static FILE* s_SavedOutput = NULL;
+static FILE* s_ExpectedOutput = NULL;
+
+// Offset of the first char differing from s_ExpectedOutput, -1 while none has,
+// and how many lines of output came before it
+static long long s_FirstDifference = -1;
+static unsigned long long s_NumMatchingLines = 0;
+
+/*
+* compareOutput
+* ----------------------------------
+*  
+* Compares output with the next chars of s_ExpectedOutput,
+* noting where the first difference is.
+*
+* @chars -------------------> Output flushed.
+* @length ------------------> Number of chars flushed.
+*
+* @return ------------------> None.
+*
+*/
+static void compareOutput( const char* chars, size_t length ){
+
+	static char s_Expected[ BENCH_COMPARE_SIZE ];
+	unsigned long long offset = s_OutputSize;
+
+	while( length > 0 && s_FirstDifference < 0 ){
+		size_t numToCompare = ( length < BENCH_COMPARE_SIZE ) ? length : BENCH_COMPARE_SIZE;
+		size_t numRead = fread( s_Expected, 1, numToCompare, s_ExpectedOutput );
+
+		for( size_t i = 0; i < numToCompare; ++i ){
+			if( i == numRead || chars[ i ] != s_Expected[ i ] ){
+				s_FirstDifference = offset + i;
+				break;
+			}
+			if( chars[ i ] == '\n' ){
+				++s_NumMatchingLines;
+			}
+		}
+		chars += numToCompare;
+		length -= numToCompare;
+		offset += numToCompare;
+	}
+}
+
+/*
+* handleOutput
+* ----------------------------------
+*  
+* OutputSink which keeps output off the terminal, so
+* writing it never counts against the library. It is only
+* counted unless it is being saved or compared.
+*
+* @context -----------------> Unused.
+* @chars -------------------> Output flushed.
+* @length ------------------> Number of chars flushed.
+*
+* @return ------------------> None.
+*
+*/
+static void handleOutput( void* context, const char* chars, size_t length ){
+
+	(void)context;
+
+	if( s_SavedOutput != NULL ){
+		fwrite( chars, 1, length, s_SavedOutput );
+	}
+	if( s_ExpectedOutput != NULL ){
+		compareOutput( chars, length );
+	}
+	s_OutputSize += length;
+}
+
+/*
+* handleError
+* ----------------------------------
+*  
+* OutputSink writeError which counts error messages, keeping
+* them out of the output as project1 keeps them off stdout.
+*
+* @context -----------------> Unused.
+* @chars -------------------> Error message.
+* @length ------------------> Number of chars in message.
+*
+* @return ------------------> None.
+*
+*/
+static void handleError( void* context, const char* chars, size_t length ){
+
+	(void)context;
+	(void)chars;
+
+	s_ErrorSize += length;
+}
+
+/*
+* getNanoseconds
+* ----------------------------------
+*  
+* Reads the monotonic clock.
+*
+*
+* @return ------------------> Nanoseconds since some fixed point.
+*
+*/
+static uint_least64_t getNanoseconds(){
+
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (uint_least64_t)now.tv_sec * 1000000000u + (uint_least64_t)now.tv_nsec;
+}
+
+/*
+* getPeakMemory
+* ----------------------------------
+*  
+* Reads the most memory the process has had resident.
+*
+*
+* @return ------------------> Peak resident set size in kilobytes.
+*
+*/
+static long getPeakMemory(){
+
+	struct rusage usage;
+	getrusage( RUSAGE_SELF, &usage );
+	return usage.ru_maxrss;
+}
+
+/*
+* classifyCommand
+* ----------------------------------
+*  
+* Works out which kind of command a line is, the same
+* way SanitizeInput decides what to do with it.
+*
+* @line --------------------> Chars of the line.
+* @length ------------------> Number of chars in line.
+*
+* @return ------------------> Kind of the command.
+*
+*/
+static BenchCommandType classifyCommand( const char* line, size_t length ){
+
+	Tokenizer tokens;
+	StringView command;
+	StringView first;
+	StringView second;
+
+	initTokenizer( &tokens, line, length );
+	if( !nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &command ) || !nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &first ) ){
+		return BENCH_INVALID;
+	}
+
+	if( viewEquals( command, BORROW_ITEM_COMMAND ) || viewEquals( command, RETURN_ITEM_COMMAND ) ){
+		if( !nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &second ) || !isValidPID( first ) || !isValidCID( second ) ){
+			return BENCH_INVALID;
+		}
+		return viewEquals( command, BORROW_ITEM_COMMAND ) ? BENCH_BORROW : BENCH_RETURN;
+	}
+	if( viewEquals( command, AVAILABLE_ITEM_COMMAND ) && isValidCID( first ) ){
+		return BENCH_AVAILABLE;
+	}
+	if( viewEquals( command, OUT_COMMAND ) ){
+		if( isValidCID( first ) ){
+			return BENCH_OUT_ITEM;
+		}
+		if( isValidPID( first ) ){
+			return BENCH_OUT_PATRON;
+		}
+	}
+	return BENCH_INVALID;
+}
+
+/*
+* generateWorkloadFiles
+* ----------------------------------
+*  
+* Generates the workload from a child process, so the
+* memory the generator uses never shows in the peak measured
+* for the library.
+*
+* @options -----------------> Shape of the workload.
+* @paths -------------------> Patron, item and command file paths.
+*
+* @return ------------------> _Bool indicating all three files were written.
+*
+*/
+static _Bool generateWorkloadFiles( const WorkloadOptions* options, const char* paths[ 3 ] ){
+
+	fflush( stdout );
+	fflush( stderr );
+
+	pid_t child = fork();
+	if( child < 0 ){
+		perror( "fork" );
+		return 0;
+	}
+
+	if( child == 0 ){
+		FILE* files[ 3 ];
+		_Bool isOpen = 1;
+
+		for( int i = 0; i < 3; ++i ){
+			files[ i ] = fopen( paths[ i ], "w" );
+			if( files[ i ] == NULL ){
+				perror( paths[ i ] );
+				isOpen = 0;
+			}
+		}
+
+		_Bool isWritten = isOpen && generateWorkload( options, files[ 0 ], files[ 1 ], files[ 2 ] );
+		for( int i = 0; i < 3; ++i ){
+			if( files[ i ] != NULL && fclose( files[ i ] ) != 0 ){
+				perror( paths[ i ] );
+				isWritten = 0;
+			}
+		}
+		_exit( isWritten ? EXIT_SUCCESS : EXIT_FAILURE );
+	}
+
+	int status;
+	while( waitpid( child, &status, 0 ) < 0 ){
+		if( errno != EINTR ){
+			perror( "waitpid" );
+			return 0;
+		}
+	}
+	return WIFEXITED( status ) && WEXITSTATUS( status ) == EXIT_SUCCESS;
+}
+
+/*
+* loadLibrary
+* ----------------------------------
+*  
+* Loads the patron and item files as project1 does.
+*
+* @patronsPath -------------> Path of the patron file.
+* @itemsPath ---------------> Path of the item file.
+*
+* @return ------------------> _Bool indicating both files could be opened.
+*
+*/
+static _Bool loadLibrary( const char* patronsPath, const char* itemsPath ){
+
+	FILE* files[] = { fopen( patronsPath, "r" ), fopen( itemsPath, "r" ) };
+	_Bool isOpen = 1;
+
+	if( files[ 0 ] == NULL ){
+		perror( patronsPath );
+		isOpen = 0;
+	}
+	if( files[ 1 ] == NULL ){
+		perror( itemsPath );
+		isOpen = 0;
+	}
+	if( isOpen ){
+		bulkLoadFiles( files, 2 );
+	}
+	for( int i = 0; i < 2; ++i ){
+		if( files[ i ] != NULL ){
+			fclose( files[ i ] );
+		}
+	}
+	return isOpen;
+}
+
+/*
+* nextQuoted
+* ----------------------------------
+*  
+* Finds the next string in double quotes, as the
+* generator writes names, authors and titles.
+*
+* @tokens ------------------> Tokenizer, moved past the string.
+* @quoted ------------------> Set to the chars between the quotes.
+*
+* @return ------------------> _Bool indicating a quoted string was found.
+*
+*/
+static _Bool nextQuoted( Tokenizer* tokens, StringView* quoted ){
+
+	const char* open = memchr( tokens->next, '"', tokens->end - tokens->next );
+	const char* close = ( open == NULL ) ? NULL : memchr( open + 1, '"', tokens->end - open - 1 );
+
+	if( close == NULL ){
+		return 0;
+	}
+	quoted->start = open + 1;
+	quoted->length = close - open - 1;
+	tokens->next = close + 1;
+	return 1;
+}
+
+/*
+* checkLoadedRecords
+* ----------------------------------
+*  
+* Reads the generated patron and item files back and checks
+* each record was loaded with the PID or CID, copies and strings
+* the generator wrote, so a generator writing lines the parser
+* reads differently cannot go unnoticed.
+*
+* @patronsPath -------------> Path of the patron file.
+* @itemsPath ---------------> Path of the item file.
+*
+* @return ------------------> _Bool indicating every record matched.
+*
+*/
+static _Bool checkLoadedRecords( const char* patronsPath, const char* itemsPath ){
+
+	const char* paths[] = { patronsPath, itemsPath };
+	char line[ LINE_MAX_SIZE ];
+
+	for( int i = 0; i < 2; ++i ){
+		FILE* file = fopen( paths[ i ], "r" );
+		unsigned long lineNumber = 0;
+
+		if( file == NULL ){
+			perror( paths[ i ] );
+			return 0;
+		}
+
+		while( fgets( line, LINE_MAX_SIZE, file ) != NULL ){
+			Tokenizer tokens;
+			StringView command, copies, uid, first, second;
+			_Bool isLoaded = 0;
+
+			++lineNumber;
+			initTokenizer( &tokens, line, strlen( line ) );
+			nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &command );
+
+			if( i == 0 && nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &uid ) && isValidPID( uid ) && nextQuoted( &tokens, &first ) ){
+				RecordHandle patron = findPatron( encodePID( uid.start ) );
+
+				isLoaded = ( patron != NO_RECORD && viewEquals( first, PATRON_NAME( patron ) ) );
+			}
+			else if( i == 1 && nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &copies ) && nextToken( &tokens, DEFAULT_WORD_SEPARATORS, &uid ) &&
+			         isValidCID( uid ) && nextQuoted( &tokens, &first ) && nextQuoted( &tokens, &second ) ){
+				RecordHandle item = findItem( encodeCID( uid.start, uid.length ) );
+
+				isLoaded = ( item != NO_RECORD && g_ItemRecords.numCopies[ item ] == viewToUnsigned( copies ) &&
+				             viewEquals( first, ITEM_AUTHOR( item ) ) && viewEquals( second, ITEM_TITLE( item ) ) );
+			}
+
+			if( !isLoaded ){
+				fprintf( stderr, "%s: line %lu was not loaded as it was generated\n", paths[ i ], lineNumber );
+				fclose( file );
+				return 0;
+			}
+		}
+		fclose( file );
+	}
+	return 1;
+}
+
+/*
+* runCommands
+* ----------------------------------
+*  
+* Runs every command of a file through processLine, timing
+* each. Lines are read before their clock starts, and split
+* the same way processInput splits them.
+*
+* @commandsPath ------------> Path of the command file.
+*
+* @return ------------------> _Bool indicating the file could be read.
+*
+*/
+static _Bool runCommands( const char* commandsPath ){
+
+	FILE* commandsFile = fopen( commandsPath, "r" );
+	if( commandsFile == NULL ){
+		perror( commandsPath );
+		return 0;
+	}
+
+	char line[ LINE_MAX_SIZE ];
+
+	while( fgets( line, LINE_MAX_SIZE, commandsFile ) != NULL ){
+		size_t length = strlen( line );
+		BenchCommandType type = classifyCommand( line, length );
+
+		uint_least64_t start = getNanoseconds();
+		processLine( line, length );
+		uint_least64_t latency = getNanoseconds() - start;
+
+		recordLatency( &s_Latencies[ type ], latency );
+		recordLatency( &s_AllLatencies, latency );
+	}
+
+	_Bool isRead = !ferror( commandsFile );
+	if( !isRead ){
+		perror( commandsPath );
+	}
+	fclose( commandsFile );
+	return isRead;
+}
+
+/*
+* writeLatencies
+* ----------------------------------
+*  
+* Writes one histogram's summary as a JSON object.
+*
+* @file --------------------> File to write to.
+* @histogram ---------------> Histogram to summarize.
+*
+* @return ------------------> None.
+*
+*/
+static void writeLatencies( FILE* file, const LatencyHistogram* histogram ){
+	fprintf( file, "{ \"count\": %llu, \"mean\": %llu, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu }",
+	         (unsigned long long)histogram->count, (unsigned long long)getLatencyMean( histogram ),
+	         (unsigned long long)getLatencyPercentile( histogram, 50.0 ), (unsigned long long)getLatencyPercentile( histogram, 99.0 ),
+	         (unsigned long long)getLatencyPercentile( histogram, 99.9 ), (unsigned long long)histogram->max );
+}
+
+/*
+* writeJSONString
+* ----------------------------------
+*  
+* Writes a string as a JSON string, quoted and escaped.
+*
+* @file --------------------> File to write to.
+* @string ------------------> String to write.
+*
+* @return ------------------> None.
+*
+*/
+static void writeJSONString( FILE* file, const char* string ){
+
+	fputc( '"', file );
+	for( ; *string != '\0'; ++string ){
+		unsigned char ch = (unsigned char)*string;
+		if( ch == '"' || ch == '\\' ){
+			fputc( '\\', file );
+			fputc( ch, file );
+		}
+		else if( ch < 0x20 ){
+			fprintf( file, "\\u%04x", ch );
+		}
+		else{
+			fputc( ch, file );
+		}
+	}
+	fputc( '"', file );
+}
+
+/*
+* writeResults
+* ----------------------------------
+*  
+* Writes everything measured as one JSON object. Times
+* are in nanoseconds unless their name says otherwise.
+*
+* @file --------------------> File to write to.
+* @options -----------------> Shape of the workload, NULL if it was not generated.
+* @paths -------------------> Patron, item and command file paths.
+* @startupTime -------------> Time taken to load the patron and item files.
+* @startupMemory -----------> Peak resident kilobytes once they were loaded.
+* @runTime -----------------> Time taken to read and run every command.
+* @statusTime --------------> Time taken to list the final status of everything.
+* @expectedPath ------------> File output was compared with, or NULL.
+*
+* @return ------------------> None.
+*
+*/
+static void writeResults( FILE* file, const WorkloadOptions* options, const char* paths[ 3 ], uint_least64_t startupTime, long startupMemory,
+                          uint_least64_t runTime, uint_least64_t statusTime, const char* expectedPath ){
+
+	double commandSeconds = s_AllLatencies.total / 1e9;
+
+	fprintf( file, "{\n  \"version\": %d,\n  \"workload\": {\n    \"patron_file\": ", BENCH_RESULTS_VERSION );
+	writeJSONString( file, paths[ 0 ] );
+	fputs( ",\n    \"item_file\": ", file );
+	writeJSONString( file, paths[ 1 ] );
+	fputs( ",\n    \"command_file\": ", file );
+	writeJSONString( file, paths[ 2 ] );
+	if( options != NULL ){
+		fprintf( file, ",\n    \"patrons\": %lu,\n    \"items\": %lu,\n    \"commands\": %llu,\n    \"zipf_skew\": %g,\n"
+		         "    \"mix\": { \"borrow\": %u, \"return\": %u, \"query\": %u },\n    \"invalid_ratio\": %g,\n    \"seed\": %llu",
+		         (unsigned long)options->numPatrons, (unsigned long)options->numItems, (unsigned long long)options->numCommands,
+		         options->zipfSkew, options->borrowWeight, options->returnWeight, options->queryWeight,
+		         options->invalidRatio, (unsigned long long)options->seed );
+	}
+	fprintf( file, "\n  },\n  \"startup_ns\": %llu,\n  \"startup_rss_kb\": %ld,\n  \"peak_rss_kb\": %ld,\n"
+	         "  \"commands\": %llu,\n  \"run_ns\": %llu,\n  \"status_ns\": %llu,\n  \"commands_per_second\": %.0f,\n"
+	         "  \"output\": {\n    \"bytes\": %llu,\n    \"error_bytes\": %llu",
+	         (unsigned long long)startupTime, startupMemory, getPeakMemory(),
+	         (unsigned long long)s_AllLatencies.count, (unsigned long long)runTime, (unsigned long long)statusTime,
+	         ( commandSeconds > 0.0 ) ? s_AllLatencies.count / commandSeconds : 0.0, s_OutputSize, s_ErrorSize );
+	if( expectedPath != NULL ){
+		fputs( ",\n    \"expected_file\": ", file );
+		writeJSONString( file, expectedPath );
+		fprintf( file, ",\n    \"matches_expected\": %s,\n    \"first_difference\": %lld",
+		         ( s_FirstDifference < 0 ) ? "true" : "false", s_FirstDifference );
+	}
+	fputs( "\n  },\n  \"latency_ns\": {\n    \"all\": ", file );
+	writeLatencies( file, &s_AllLatencies );
+	for( int type = 0; type < BENCH_COMMAND_TYPES; ++type ){
+		fprintf( file, ",\n    \"%s\": ", s_CommandTypeNames[ type ] );
+		writeLatencies( file, &s_Latencies[ type ] );
+	}
+	fputs( "\n  }\n}\n", file );
+}
+
+/*
+* parseMix
+* ----------------------------------
+*  
+* Reads a borrow,return,query mix such as 40,30,30.
+*
+* @mix ---------------------> Text of the mix.
+* @options -----------------> Options to set the weights of.
+*
+* @return ------------------> _Bool indicating the mix was three numbers.
+*
+*/
+static _Bool parseMix( const char* mix, WorkloadOptions* options ){
+
+	unsigned int weights[ 3 ];
+	int numRead = 0;
+
+	if( sscanf( mix, "%u,%u,%u%n", &weights[ 0 ], &weights[ 1 ], &weights[ 2 ], &numRead ) != 3 || mix[ numRead ] != '\0' ){
+		return 0;
+	}
+	options->borrowWeight = weights[ 0 ];
+	options->returnWeight = weights[ 1 ];
+	options->queryWeight = weights[ 2 ];
+	return 1;
+}
+
+int main( int argc, char *argv[] ){
+
+	WorkloadOptions options;
+	const char* prefix = BENCH_DEFAULT_PREFIX;
+	const char* resultsPath = NULL;
+	const char* savedPath = NULL;
+	const char* expectedPath = NULL;
+	_Bool isUsable = 1;
+	int firstFileArg = 1;
+
+	setWorkloadDefaults( &options );
+
+	// options come before the files, each takes a value
+	while( firstFileArg + 1 < argc && argv[ firstFileArg ][ 0 ] == '-' ){
+		const char* option = argv[ firstFileArg ];
+		const char* value = argv[ firstFileArg + 1 ];
+
+		if( strcmp( option, "-p" ) == 0 ){
+			options.numPatrons = strtoul( value, NULL, 10 );
+		}
+		else if( strcmp( option, "-i" ) == 0 ){
+			options.numItems = strtoul( value, NULL, 10 );
+		}
+		else if( strcmp( option, "-n" ) == 0 ){
+			options.numCommands = strtoull( value, NULL, 10 );
+		}
+		else if( strcmp( option, "-z" ) == 0 ){
+			options.zipfSkew = strtod( value, NULL );
+		}
+		else if( strcmp( option, "-m" ) == 0 ){
+			isUsable = parseMix( value, &options ) && isUsable;
+		}
+		else if( strcmp( option, "-e" ) == 0 ){
+			options.invalidRatio = strtod( value, NULL );
+		}
+		else if( strcmp( option, "-r" ) == 0 ){
+			options.seed = strtoull( value, NULL, 10 );
+		}
+		else if( strcmp( option, "-w" ) == 0 ){
+			prefix = value;
+		}
+		else if( strcmp( option, "-o" ) == 0 ){
+			resultsPath = value;
+		}
+		else if( strcmp( option, "-s" ) == 0 ){
+			savedPath = value;
+		}
+		else if( strcmp( option, "-d" ) == 0 ){
+			expectedPath = value;
+		}
+		else{
+			break;
+		}
+		firstFileArg += 2;
+	}
+
+	// Either generate a workload, or replay patron_file item_file command_file
+	int numFileArgs = argc - firstFileArg;
+	if( !isUsable || ( numFileArgs != 0 && numFileArgs != 3 ) ){
+		fputs( "usuage:  bench [-p patrons] [-i items] [-n commands] [-z zipf_skew] [-m borrow,return,query]\n"
+		       "               [-e invalid_ratio] [-r seed] [-w file_prefix] [-o results_file]\n"
+		       "               [-s save_output_file] [-d expected_output_file]\n"
+		       "         bench [-o results_file] [-s save_output_file] [-d expected_output_file]\n"
+		       "               patron_file item_file command_file\n", stderr );
+		return( EXIT_FAILURE );
+	}
+
+	char generatedPaths[ 3 ][ LINE_MAX_SIZE ];
+	const char* paths[ 3 ];
+	const WorkloadOptions* generatedOptions = NULL;
+
+	if( numFileArgs == 3 ){
+		for( int i = 0; i < 3; ++i ){
+			paths[ i ] = argv[ firstFileArg + i ];
+		}
+	}
+	else{
+		const char* suffixes[] = { "patrons", "items", "commands" };
+		for( int i = 0; i < 3; ++i ){
+			int length = snprintf( generatedPaths[ i ], LINE_MAX_SIZE, "%s.%s", prefix, suffixes[ i ] );
+			if( length < 0 || length >= LINE_MAX_SIZE ){
+				fprintf( stderr, "%s: name too long\n", prefix );
+				return( EXIT_FAILURE );
+			}
+			paths[ i ] = generatedPaths[ i ];
+		}
+		if( !areWorkloadOptionsValid( &options ) || !generateWorkloadFiles( &options, paths ) ){
+			return( EXIT_FAILURE );
+		}
+		generatedOptions = &options;
+	}
+
+	FILE* resultsFile = stdout;
+	if( resultsPath != NULL && ( resultsFile = fopen( resultsPath, "w" ) ) == NULL ){
+		perror( resultsPath );
+		return( EXIT_FAILURE );
+	}
+	if( savedPath != NULL && ( s_SavedOutput = fopen( savedPath, "w" ) ) == NULL ){
+		perror( savedPath );
+		return( EXIT_FAILURE );
+	}
+	if( expectedPath != NULL && ( s_ExpectedOutput = fopen( expectedPath, "r" ) ) == NULL ){
+		perror( expectedPath );
+		return( EXIT_FAILURE );
+	}
+
+	// the library's output never reaches the terminal
+	OutputSink sink = { handleOutput, NULL, handleError };
+	setOutputSink( &sink );
+
+	uint_least64_t start = getNanoseconds();
+	if( !loadLibrary( paths[ 0 ], paths[ 1 ] ) ){
+		return( EXIT_FAILURE );
+	}
+	flushOutput();
+	uint_least64_t startupTime = getNanoseconds() - start;
+	long startupMemory = getPeakMemory();
+
+	if( generatedOptions != NULL && !checkLoadedRecords( paths[ 0 ], paths[ 1 ] ) ){
+		return( EXIT_FAILURE );
+	}
+
+	start = getNanoseconds();
+	if( !runCommands( paths[ 2 ] ) ){
+		return( EXIT_FAILURE );
+	}
+	flushOutput();
+	uint_least64_t runTime = getNanoseconds() - start;
+
+	// as processInput finishes when reading stdin
+	unsigned long long statusOffset = s_OutputSize;
+	start = getNanoseconds();
+	writeOutputChar( '\n' );
+	printAllListsStatus();
+	flushOutput();
+	uint_least64_t statusTime = getNanoseconds() - start;
+
+	_Bool isOutputExpected = 1;
+	if( s_ExpectedOutput != NULL ){
+		// expected output running on past ours differs too
+		if( s_FirstDifference < 0 && fgetc( s_ExpectedOutput ) != EOF ){
+			s_FirstDifference = s_OutputSize;
+		}
+		if( s_FirstDifference >= 0 ){
+			fprintf( stderr, "%s: output differs at byte %lld, line %llu, in %s\n", expectedPath, s_FirstDifference, s_NumMatchingLines + 1,
+			         ( (unsigned long long)s_FirstDifference < statusOffset ) ? "the commands' output" : "the final status listing" );
+			isOutputExpected = 0;
+		}
+		fclose( s_ExpectedOutput );
+	}
+	if( s_SavedOutput != NULL && fclose( s_SavedOutput ) != 0 ){
+		perror( savedPath );
+		return( EXIT_FAILURE );
+	}
+
+	writeResults( resultsFile, generatedOptions, paths, startupTime, startupMemory, runTime, statusTime, expectedPath );
+	setOutputSink( NULL );
+	deleteAndFreeBothLists();
+	freeCommandStats();
+
+	if( fclose( resultsFile ) != 0 ){
+		perror( resultsPath != NULL ? resultsPath : "stdout" );
+		return( EXIT_FAILURE );
+	}
+	return( isOutputExpected ? EXIT_SUCCESS : EXIT_FAILURE );
+}
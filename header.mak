@@ -12,5 +12,5 @@
 ALLOCDIR =	/usr/local/pub/wrc/courses/sp1/allocate
 CC =		gcc
 CFLAGS =	-ggdb -std=c99 -I$(ALLOCDIR)
-LIBFLAGS =	-L$(ALLOCDIR) -lallocate
+LIBFLAGS =	-L$(ALLOCDIR) -lallocate -lpthread -lm
 CLIBFLAGS =	$(LIBFLAGS)
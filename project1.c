@@ -11,53 +11,127 @@
 *
 */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <allocate.h>
 #include "SanitizeInput.h"
+#include "BulkLoad.h"
 #include "LinkedDataNodeOperations.h"
+#include "UIDIndex.h"
+#include "OutputWriter.h"
+#include "Snapshot.h"
+#include "Journal.h"
+#include "Server.h"
+#include "CommandStats.h"
+#include "AllConstants.h"
 
 // Global variables to reduce program size from passing
-// around ListNode pointers between functions
+// around list pointers between functions
 FILE* g_InputFile = NULL; 
-ListNode* g_PatronsHead = NULL;
-ListNode* g_ItemsHead = NULL;
+OrderedList g_PatronsList = { { NULL }, 0 };
+OrderedList g_ItemsList = { { NULL }, 0 };
+UIDIndex g_PatronsIndex = { NULL, PID_KEY_COUNT };
+UIDIndex g_ItemsIndex = { NULL, CID_KEY_COUNT };
 
-int main( int argc, char *argv[] ){
-
-	// User must supply patron_file and item_file
-	if( argc != 3 ){
-		fputs( "usuage:  project1 patron_file item_file\n", stderr );
-		return( EXIT_FAILURE );
-	}
+/*
+* loadInitialFiles
+* ----------------------------------
+*  
+* Opens the initial patron and item files and loads them.
+*
+* @patronsPath -------------> Path of the patron file.
+* @itemsPath ---------------> Path of the item file.
+*
+* @return ------------------> _Bool indicating if both files could be opened.
+*
+*/
+static _Bool loadInitialFiles( const char* patronsPath, const char* itemsPath ){
 
-	FILE* initialPatronsFile = fopen( argv[ 1 ], "r" );
-	FILE* initialItemsFile = fopen( argv[ 2 ], "r" );
+	FILE* initialPatronsFile = fopen( patronsPath, "r" );
+	FILE* initialItemsFile = fopen( itemsPath, "r" );
 	_Bool isEitherInputFileNull = 0;
 
 	if( initialPatronsFile == NULL ){
-		perror( argv[ 1 ] );
+		perror( patronsPath );
 		isEitherInputFileNull = 1;
 	}
 	if( initialItemsFile == NULL ){
-		perror( argv[ 2 ] );
+		perror( itemsPath );
 		isEitherInputFileNull = 1;
 	}
 	if( isEitherInputFileNull ){
-		return( EXIT_FAILURE );
+		return 0;
 	}
 
-	g_InputFile = initialPatronsFile;
-	processInput();
+	// both files are parsed at once, patrons are still loaded first
+	FILE* initialFiles[] = { initialPatronsFile, initialItemsFile };
+	bulkLoadFiles( initialFiles, 2 );
 	fclose( initialPatronsFile );
-
-	g_InputFile = initialItemsFile;
-	processInput();
 	fclose( initialItemsFile );
+	return 1;
+}
 
-	g_InputFile = NULL;
-	processInput();
+int main( int argc, char *argv[] ){
+
+	const char* journalPath = NULL;
+	const char* socketPath = NULL;
+	long groupSize = JOURNAL_DEFAULT_GROUP_SIZE;
+	long statsInterval = 0;
+	int firstFileArg = 1;
+
+	// options come before the files, each takes a value
+	while( firstFileArg + 1 < argc && argv[ firstFileArg ][ 0 ] == '-' ){
+		if( strcmp( argv[ firstFileArg ], "-j" ) == 0 ){
+			journalPath = argv[ firstFileArg + 1 ];
+		}
+		else if( strcmp( argv[ firstFileArg ], "-s" ) == 0 ){
+			socketPath = argv[ firstFileArg + 1 ];
+		}
+		else if( strcmp( argv[ firstFileArg ], "-g" ) == 0 ){
+			groupSize = strtol( argv[ firstFileArg + 1 ], NULL, 10 );
+		}
+		else if( strcmp( argv[ firstFileArg ], "-t" ) == 0 ){
+			statsInterval = strtol( argv[ firstFileArg + 1 ], NULL, 10 );
+		}
+		else{
+			break;
+		}
+		firstFileArg += 2;
+	}
+
+	// User must supply patron_file and item_file, or a snapshot saved earlier
+	int numFileArgs = argc - firstFileArg;
+	if( ( numFileArgs != 1 && numFileArgs != 2 ) || groupSize < 1 || groupSize > UINT_LEAST32_MAX || statsInterval < 0 || statsInterval > UINT_LEAST32_MAX ){
+		fputs( "usuage:  project1 [-s socket_file] [-j journal_file] [-g fsync_group_size] [-t stats_interval_seconds] patron_file item_file\n"
+		       "         project1 [-s socket_file] [-j journal_file] [-g fsync_group_size] [-t stats_interval_seconds] snapshot_file\n", stderr );
+		return( EXIT_FAILURE );
+	}
+	setCommandStatsInterval( statsInterval );
+
+	_Bool isLoaded = ( numFileArgs == 1 ) ? loadSnapshot( argv[ firstFileArg ] ) : loadInitialFiles( argv[ firstFileArg ], argv[ firstFileArg + 1 ] );
+
+	// the journal holds every change made since the files were written
+	if( !isLoaded || ( journalPath != NULL && !openJournal( journalPath, groupSize ) ) ){
+		flushOutput();
+		return( EXIT_FAILURE );
+	}
+
+	_Bool isServed = 1;
+
+	// with a socket, commands come from its clients instead of stdin
+	if( socketPath != NULL ){
+		flushOutput();
+		isServed = runServer( socketPath );
+	}
+	else{
+		g_InputFile = NULL;
+		processInput();
+	}
+	closeJournal();
+	flushOutput();
 
 	deleteAndFreeBothLists();
+	freeCommandStats();
 
-	return( EXIT_SUCCESS );
+	return( isServed ? EXIT_SUCCESS : EXIT_FAILURE );
 }
-